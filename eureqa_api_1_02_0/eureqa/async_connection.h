@@ -0,0 +1,444 @@
+#ifndef EUREQA_ASYNC_CONNECTION_H
+#define EUREQA_ASYNC_CONNECTION_H
+
+#include <deque>
+#include <string>
+#include <vector>
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/lexical_cast.hpp>
+#include <eureqa/connection.h>
+
+namespace eureqa
+{
+// called when an asynchronous command finishes, true if it was sent and answered
+typedef boost::function<void (bool)> completion_handler;
+
+// asynchronous/non-blocking network interface with a eureqa server
+//
+// commands are queued and sent one at a time in the order they are issued,
+// the eureqa protocol only allows a single outstanding request per socket;
+// handlers run on whichever thread is running the io_service
+//
+// like the boost::asio sockets it wraps, an async_connection is not thread safe,
+// issue commands from the io_service thread (or post them there) and keep the
+// connection, and any object passed by reference, alive until its handler runs
+class async_connection
+{
+protected:
+    // a queued command and the state of its request/response exchange
+    struct operation
+    {
+        int cmd_; // command code, or zero when connecting
+        bool has_argument_; // command is followed by a fixed int argument
+        int argument_;
+        bool has_packet_; // command is followed by a size/data packet
+        std::string request_;
+        bool reads_result_; // response is a command_result rather than a packet
+        int result_value_;
+        int packet_size_;
+        boost::function<void (const char*, std::size_t)> decode_; // stores the response packet
+        completion_handler handler_;
+
+        operation() : cmd_(0), has_argument_(false), argument_(0), has_packet_(false),
+            reads_result_(true), result_value_(result_success), packet_size_(0) { }
+    };
+    typedef boost::shared_ptr<operation> operation_ptr;
+
+    boost::asio::io_service& io_service_;
+    boost::asio::ip::tcp::socket socket_;
+    boost::asio::ip::tcp::resolver resolver_;
+    std::deque<operation_ptr> queue_;
+    std::vector<char> receive_buffer_; // shared by every response, only ever grows
+    bool busy_; // front of the queue has been started
+    command_result last_result_;
+    int encoding_;
+
+public:
+    // all i/o and handlers run on the caller supplied io_service
+    async_connection(boost::asio::io_service& io_service);
+    virtual ~async_connection() { disconnect(); }
+
+    // basic connection information
+    bool is_connected() const { return socket_.is_open(); }
+    command_result last_result() const { return last_result_; }
+    boost::asio::io_service& get_io_service() { return io_service_; }
+
+    // packet encoding used for commands queued from now on
+    int encoding() const { return encoding_; }
+    void set_encoding(int encoding) { encoding_ = encoding; }
+
+    // number of commands queued or in flight
+    int pending() const { return (int)queue_.size(); }
+
+    // opens a network connection to a eureqa server
+    void async_connect(std::string hostname, completion_handler handler) { async_connect(hostname, default_port_tcp, handler); }
+    void async_connect(std::string hostname, int port, completion_handler handler);
+    void disconnect();
+
+    // send server the data set over the network
+    // or tell it to load it from a network file
+    void async_send_data_set(const eureqa::data_set& data, completion_handler handler);
+    void async_send_data_location(std::string path, completion_handler handler);
+
+    // send server the search options
+    void async_send_options(const eureqa::search_options& options, completion_handler handler);
+
+    // send server individuals to insert into its population
+    void async_send_individuals(const std::vector<eureqa::solution_info>& individuals, completion_handler handler);
+
+    // query server for information on the search progress
+    void async_query_progress(eureqa::search_progress& progress, completion_handler handler);
+
+    // query server for its system information
+    void async_query_server_info(eureqa::server_info& info, completion_handler handler);
+
+    // query server for random individuals from its population
+    void async_query_individuals(std::vector<eureqa::solution_info>& individuals, int count, completion_handler handler);
+
+    // query the servers local solution frontier
+    void async_query_frontier(eureqa::solution_frontier& front, completion_handler handler);
+
+    // tell server to start/pause/end searching
+    void async_start_search(completion_handler handler) { async_command(commands::start_search, handler); }
+    void async_pause_search(completion_handler handler) { async_command(commands::pause_search, handler); }
+    void async_end_search(completion_handler handler) { async_command(commands::end_search, handler); }
+
+    // calculate the solution info on the server
+    void async_calc_solution_info(std::vector<eureqa::solution_info>& individuals, completion_handler handler);
+
+    // returns are a short description of the connection
+    std::string summary() const;
+    std::string remote_address() const;
+
+protected:
+    void async_command(int cmd, completion_handler handler);
+
+    template<typename T> static void deserialize(const char* data, std::size_t size, const char* name, T* val) { decode_packet(data, size, name, *val); }
+
+    void enqueue(operation_ptr op);
+    void start(operation_ptr op);
+    void finish(operation_ptr op, bool success);
+    void connect_next(operation_ptr op, boost::asio::ip::tcp::resolver::iterator endpoint_iterator);
+
+    void handle_resolve(operation_ptr op, const boost::system::error_code& error, boost::asio::ip::tcp::resolver::iterator endpoint_iterator);
+    void handle_connect(operation_ptr op, const boost::system::error_code& error, boost::asio::ip::tcp::resolver::iterator endpoint_iterator);
+    void handle_write(operation_ptr op, const boost::system::error_code& error);
+    void handle_result_value(operation_ptr op, const boost::system::error_code& error);
+    void handle_packet_size(operation_ptr op, const boost::system::error_code& error);
+    void handle_packet(operation_ptr op, const boost::system::error_code& error);
+};
+
+/*---------------------------------------------------------------------------
+    implementions:
+*--------------------------------------------------------------------------*/
+
+inline
+async_connection::async_connection(boost::asio::io_service& io_service) :
+    io_service_(io_service),
+    socket_(io_service),
+    resolver_(io_service),
+    busy_(false),
+    encoding_(default_encoding)
+{ }
+
+inline
+void async_connection::disconnect()
+{
+    boost::system::error_code ignored;
+    resolver_.cancel();
+    socket_.close(ignored);
+}
+
+inline
+void async_connection::async_connect(std::string hostname, int port, completion_handler handler)
+{
+    // queued like any other command, the server greets a new connection with a command result
+    operation_ptr op(new operation());
+    op->request_ = hostname;
+    op->argument_ = port;
+    op->handler_ = handler;
+    enqueue(op);
+}
+
+inline
+void async_connection::async_send_data_set(const eureqa::data_set& data, completion_handler handler)
+{
+    operation_ptr op(new operation());
+    op->cmd_ = commands::send_data_set;
+    op->has_packet_ = true;
+    op->handler_ = handler;
+
+    // serialize the data set now, so the caller is free to modify it
+    encode_packet(encoding_, data, "data_set", op->request_);
+    enqueue(op);
+}
+
+inline
+void async_connection::async_send_data_location(std::string path, completion_handler handler)
+{
+    operation_ptr op(new operation());
+    op->cmd_ = commands::send_data_location;
+    op->has_packet_ = true;
+    op->request_ = path;
+    op->handler_ = handler;
+    enqueue(op);
+}
+
+inline
+void async_connection::async_send_options(const eureqa::search_options& options, completion_handler handler)
+{
+    operation_ptr op(new operation());
+    op->cmd_ = commands::send_options;
+    op->has_packet_ = true;
+    encode_packet(encoding_, options, "search_options", op->request_);
+    op->handler_ = handler;
+    enqueue(op);
+}
+
+inline
+void async_connection::async_send_individuals(const std::vector<eureqa::solution_info>& individuals, completion_handler handler)
+{
+    operation_ptr op(new operation());
+    op->cmd_ = commands::send_individuals;
+    op->has_packet_ = true;
+    encode_packet(encoding_, individuals, "vector_solution_info", op->request_);
+    op->handler_ = handler;
+    enqueue(op);
+}
+
+inline
+void async_connection::async_query_progress(eureqa::search_progress& progress, completion_handler handler)
+{
+    operation_ptr op(new operation());
+    op->cmd_ = commands::query_progress;
+    op->reads_result_ = false;
+    op->decode_ = boost::bind(&async_connection::deserialize<eureqa::search_progress>, _1, _2, "search_progress", &progress);
+    op->handler_ = handler;
+    enqueue(op);
+}
+
+inline
+void async_connection::async_query_server_info(eureqa::server_info& info, completion_handler handler)
+{
+    operation_ptr op(new operation());
+    op->cmd_ = commands::query_server_info;
+    op->reads_result_ = false;
+    op->decode_ = boost::bind(&async_connection::deserialize<eureqa::server_info>, _1, _2, "server_info", &info);
+    op->handler_ = handler;
+    enqueue(op);
+}
+
+inline
+void async_connection::async_query_individuals(std::vector<eureqa::solution_info>& individuals, int count, completion_handler handler)
+{
+    operation_ptr op(new operation());
+    op->cmd_ = commands::query_individuals;
+    op->has_argument_ = true;
+    op->argument_ = count;
+    op->reads_result_ = false;
+    op->decode_ = boost::bind(&async_connection::deserialize<std::vector<eureqa::solution_info> >, _1, _2, "vector_solution_info", &individuals);
+    op->handler_ = handler;
+    enqueue(op);
+}
+
+inline
+void async_connection::async_query_frontier(eureqa::solution_frontier& front, completion_handler handler)
+{
+    operation_ptr op(new operation());
+    op->cmd_ = commands::query_frontier;
+    op->reads_result_ = false;
+    op->decode_ = boost::bind(&async_connection::deserialize<eureqa::solution_frontier>, _1, _2, "solution_frontier", &front);
+    op->handler_ = handler;
+    enqueue(op);
+}
+
+inline
+void async_connection::async_calc_solution_info(std::vector<eureqa::solution_info>& individuals, completion_handler handler)
+{
+    operation_ptr op(new operation());
+    op->cmd_ = commands::calc_solution_info;
+    op->has_packet_ = true;
+    encode_packet(encoding_, individuals, "vector_solution_info", op->request_);
+    op->reads_result_ = false;
+    op->decode_ = boost::bind(&async_connection::deserialize<std::vector<eureqa::solution_info> >, _1, _2, "vector_solution_info", &individuals);
+    op->handler_ = handler;
+    enqueue(op);
+}
+
+inline
+void async_connection::async_command(int cmd, completion_handler handler)
+{
+    operation_ptr op(new operation());
+    op->cmd_ = cmd;
+    op->handler_ = handler;
+    enqueue(op);
+}
+
+inline
+std::string async_connection::remote_address() const
+{
+    boost::system::error_code error;
+    return socket_.remote_endpoint(error).address().to_string();
+}
+
+inline
+std::string async_connection::summary() const
+{
+    std::ostringstream os;
+    if (!is_connected())
+    {
+        os << "Disconnected";
+    }
+    else
+    {
+        os << "Connected to " << remote_address();
+        if (!queue_.empty()) { os << ", " << queue_.size() << " pending"; }
+    }
+    return os.str();
+}
+
+inline
+void async_connection::enqueue(operation_ptr op)
+{
+    queue_.push_back(op);
+    if (!busy_) { start(queue_.front()); }
+}
+
+inline
+void async_connection::start(operation_ptr op)
+{
+    busy_ = true;
+
+    // connecting resolves the hostname held in the request and the port held in the argument
+    if (op->cmd_ == 0)
+    {
+        disconnect();
+        boost::asio::ip::tcp::resolver::query query(op->request_, boost::lexical_cast<std::string>(op->argument_));
+        resolver_.async_resolve(query, boost::bind(&async_connection::handle_resolve, this, op,
+            boost::asio::placeholders::error, boost::asio::placeholders::iterator));
+        return;
+    }
+    if (!is_connected())
+    {
+        // fail from the io_service rather than from inside the caller's enqueue
+        io_service_.post(boost::bind(&async_connection::finish, this, op, false));
+        return;
+    }
+
+    // write the command-code, then either the fixed argument or the packet size and data
+    std::vector<boost::asio::const_buffer> request;
+    request.push_back(boost::asio::buffer(&op->cmd_, sizeof(int)));
+    if (op->has_argument_) { request.push_back(boost::asio::buffer(&op->argument_, sizeof(int))); }
+    if (op->has_packet_)
+    {
+        op->packet_size_ = (int)op->request_.length();
+        request.push_back(boost::asio::buffer(&op->packet_size_, sizeof(int)));
+        request.push_back(boost::asio::buffer(op->request_));
+    }
+    boost::asio::async_write(socket_, request, boost::asio::transfer_all(),
+        boost::bind(&async_connection::handle_write, this, op, boost::asio::placeholders::error));
+}
+
+inline
+void async_connection::finish(operation_ptr op, bool success)
+{
+    if (!success) { disconnect(); }
+
+    // the handler may queue more commands, which start right away if the queue was empty
+    queue_.pop_front();
+    busy_ = false;
+    if (op->handler_) { op->handler_(success); }
+    if (!busy_ && !queue_.empty()) { start(queue_.front()); }
+}
+
+inline
+void async_connection::connect_next(operation_ptr op, boost::asio::ip::tcp::resolver::iterator endpoint_iterator)
+{
+    boost::system::error_code ignored;
+    socket_.close(ignored);
+    boost::asio::ip::tcp::endpoint endpoint = *endpoint_iterator;
+    socket_.async_connect(endpoint, boost::bind(&async_connection::handle_connect, this, op,
+        boost::asio::placeholders::error, ++endpoint_iterator));
+}
+
+inline
+void async_connection::handle_resolve(operation_ptr op, const boost::system::error_code& error, boost::asio::ip::tcp::resolver::iterator endpoint_iterator)
+{
+    if (error || endpoint_iterator == boost::asio::ip::tcp::resolver::iterator()) { finish(op, false); return; }
+    connect_next(op, endpoint_iterator);
+}
+
+inline
+void async_connection::handle_connect(operation_ptr op, const boost::system::error_code& error, boost::asio::ip::tcp::resolver::iterator endpoint_iterator)
+{
+    // try the remaining endpoints one at a time
+    if (error && error != boost::asio::error::operation_aborted && endpoint_iterator != boost::asio::ip::tcp::resolver::iterator())
+    {
+        connect_next(op, endpoint_iterator);
+        return;
+    }
+    if (error) { finish(op, false); return; }
+    handle_write(op, error);
+}
+
+inline
+void async_connection::handle_write(operation_ptr op, const boost::system::error_code& error)
+{
+    if (error) { finish(op, false); return; }
+
+    // responses are either a result code and message, or a lone packet
+    if (op->reads_result_)
+    {
+        boost::asio::async_read(socket_, boost::asio::buffer(&op->result_value_, sizeof(int)), boost::asio::transfer_all(),
+            boost::bind(&async_connection::handle_result_value, this, op, boost::asio::placeholders::error));
+    }
+    else
+    {
+        handle_result_value(op, error);
+    }
+}
+
+inline
+void async_connection::handle_result_value(operation_ptr op, const boost::system::error_code& error)
+{
+    if (error) { finish(op, false); return; }
+    boost::asio::async_read(socket_, boost::asio::buffer(&op->packet_size_, sizeof(int)), boost::asio::transfer_all(),
+        boost::bind(&async_connection::handle_packet_size, this, op, boost::asio::placeholders::error));
+}
+
+inline
+void async_connection::handle_packet_size(operation_ptr op, const boost::system::error_code& error)
+{
+    if (error || op->packet_size_ < 0) { finish(op, false); return; }
+
+    // only one response is read at a time, so they all share the receive buffer
+    if ((int)receive_buffer_.size() < op->packet_size_) { receive_buffer_.resize(op->packet_size_); }
+    if (op->packet_size_ == 0) { handle_packet(op, error); return; }
+    boost::asio::async_read(socket_, boost::asio::buffer(&receive_buffer_[0], op->packet_size_), boost::asio::transfer_all(),
+        boost::bind(&async_connection::handle_packet, this, op, boost::asio::placeholders::error));
+}
+
+inline
+void async_connection::handle_packet(operation_ptr op, const boost::system::error_code& error)
+{
+    if (error) { finish(op, false); return; }
+
+    const char* data = receive_buffer_.empty() ? "" : &receive_buffer_[0];
+    if (op->reads_result_)
+    {
+        last_result_ = command_result(op->result_value_, std::string(data, op->packet_size_));
+        finish(op, true);
+        return;
+    }
+
+    // a malformed packet fails the command instead of throwing from the io_service
+    try { op->decode_(data, op->packet_size_); }
+    catch (const boost::archive::archive_exception&) { finish(op, false); return; }
+    finish(op, true);
+}
+
+} // namespace eureqa
+
+#endif // EUREQA_ASYNC_CONNECTION_H
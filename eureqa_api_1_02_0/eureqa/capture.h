@@ -0,0 +1,164 @@
+#ifndef EUREQA_CAPTURE_H
+#define EUREQA_CAPTURE_H
+
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <boost/version.hpp>
+#include <boost/asio/buffer.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/typeof/typeof.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+namespace eureqa
+{
+// kinds of record in a capture file
+namespace capture_kinds
+{
+static const int connect  = 1; // the connection was opened, the payload is "hostname:port"
+static const int sent     = 2; // bytes written to the server, one or more whole commands
+static const int received = 3; // bytes read from the server, one or more whole responses
+}
+
+// a capture file is the magic string followed by records, each a header and its payload
+// integers are in host byte order, as they are on the wire
+static const char capture_magic[8] = { 'E', 'Q', 'C', 'A', 'P', '0', '1', '\n' };
+
+struct capture_header
+{
+    boost::int32_t kind_;
+    boost::int32_t size_; // of the payload
+    boost::int64_t time_us_; // since recording started, when the first byte was sent or received
+};
+
+// writes what a connection sends and receives to a capture file
+//
+// consecutive writes, or reads, are appended to the same record, so a record
+// holds a command or response, or a pipelined batch of them, as it crossed the wire;
+// payloads go straight to the file and the size is filled in when the record closes
+class capture_writer
+{
+protected:
+    std::ofstream file_;
+    boost::posix_time::ptime start_;
+    int kind_; // of the open record, 0 if none
+    std::streampos header_at_;
+    capture_header header_;
+
+public:
+    capture_writer(std::string path);
+    ~capture_writer() { close_record(); }
+
+    bool is_open() const { return file_.is_open() && file_.good(); }
+    void connected(std::string hostname, int port);
+    template<typename ConstBufferSequence> void append(int kind, const ConstBufferSequence& buffers);
+    void append(int kind, const char* data, std::size_t size);
+    void close_record();
+};
+
+// reads a capture file record by record
+class capture_reader
+{
+protected:
+    std::ifstream file_;
+
+public:
+    capture_reader(std::string path);
+    bool is_open() const { return file_.is_open() && file_.good(); }
+
+    // the next record, false at the end of the file or a truncated record
+    bool next(capture_header& header, std::string& payload);
+};
+
+/*---------------------------------------------------------------------------
+    implementions:
+*--------------------------------------------------------------------------*/
+inline
+capture_writer::capture_writer(std::string path) :
+    file_(path.c_str(), std::ios_base::out|std::ios_base::binary|std::ios_base::trunc),
+    start_(boost::posix_time::microsec_clock::universal_time()),
+    kind_(0)
+{
+    file_.write(capture_magic, sizeof(capture_magic));
+}
+
+inline
+void capture_writer::connected(std::string hostname, int port)
+{
+    // in the form connection::parse_address reads, with ipv6 addresses in brackets
+    std::ostringstream os;
+    if (hostname.find(':') != std::string::npos && hostname.compare(0, 5, "unix:") != 0) { os << '[' << hostname << "]:" << port; }
+    else { os << hostname << ':' << port; }
+    std::string address = os.str();
+    close_record();
+    append(capture_kinds::connect, address.data(), address.size());
+    close_record();
+}
+
+template<typename ConstBufferSequence>
+inline
+void capture_writer::append(int kind, const ConstBufferSequence& buffers)
+{
+    #if BOOST_VERSION >= 106600
+    for (BOOST_AUTO(i, boost::asio::buffer_sequence_begin(buffers)); i != boost::asio::buffer_sequence_end(buffers); ++i)
+    #else
+    for (typename ConstBufferSequence::const_iterator i = buffers.begin(); i != buffers.end(); ++i)
+    #endif
+    {
+        boost::asio::const_buffer buffer(*i);
+        append(kind, boost::asio::buffer_cast<const char*>(buffer), boost::asio::buffer_size(buffer));
+    }
+}
+
+inline
+void capture_writer::append(int kind, const char* data, std::size_t size)
+{
+    if (!file_.is_open()) { return; }
+    if (kind != kind_)
+    {
+        // start a record, its size is written when it closes
+        close_record();
+        kind_ = kind;
+        header_.kind_ = kind;
+        header_.size_ = 0;
+        header_.time_us_ = (boost::posix_time::microsec_clock::universal_time() - start_).total_microseconds();
+        header_at_ = file_.tellp();
+        file_.write((const char*)&header_, sizeof(header_));
+    }
+    file_.write(data, size);
+    header_.size_ += (boost::int32_t)size;
+}
+
+inline
+void capture_writer::close_record()
+{
+    if (kind_ == 0) { return; }
+    kind_ = 0;
+    std::streampos end = file_.tellp();
+    file_.seekp(header_at_);
+    file_.write((const char*)&header_, sizeof(header_));
+    file_.seekp(end);
+    file_.flush();
+}
+
+inline
+capture_reader::capture_reader(std::string path) :
+    file_(path.c_str(), std::ios_base::in|std::ios_base::binary)
+{
+    char magic[sizeof(capture_magic)];
+    if (!file_.read(magic, sizeof(magic)) || std::memcmp(magic, capture_magic, sizeof(magic)) != 0) { file_.close(); }
+}
+
+inline
+bool capture_reader::next(capture_header& header, std::string& payload)
+{
+    if (!file_.is_open() || !file_.read((char*)&header, sizeof(header))) { return false; }
+    if (header.size_ < 0) { return false; }
+    payload.resize(header.size_);
+    return header.size_ == 0 || file_.read(&payload[0], header.size_);
+}
+
+} // namespace eureqa
+
+#endif // EUREQA_CAPTURE_H
@@ -0,0 +1,376 @@
+#ifndef EUREQA_CLUSTER_H
+#define EUREQA_CLUSTER_H
+
+#include <string>
+#include <vector>
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <eureqa/session.h>
+
+namespace eureqa
+{
+// one search fanned out over several servers
+//
+// every command goes to all the servers at once, on a thread per server, and
+// the cluster waits for them all; the queries are aggregated, and every solution
+// received is merged into the first member's frontier, so a single frontier
+// holds the best of the whole cluster and seeds any server that reconnects
+//
+// a server whose command fails while others succeed is dropped and the rest
+// carry on; a command only fails if it fails on every server
+//
+//   eureqa::session first(conn);
+//   eureqa::cluster servers(first);
+//   servers.connect(hostnames);
+//   servers.send_data_set(data);
+//   servers.send_options(options);
+//   servers.start_search();
+//   while (servers.query_progress(progress)) { ... }
+class cluster
+{
+protected:
+    struct member
+    {
+        boost::shared_ptr<eureqa::connection> conn_; // owned, except for the first member
+        boost::shared_ptr<eureqa::session> owned_;
+        eureqa::session* session_;
+        bool active_; // connected and not dropped
+        eureqa::command_result result_; // the server's reply to the last command, an error if it gave none
+        eureqa::search_progress progress_;
+        eureqa::solution_arena arena_;
+
+        member(eureqa::session& s) : session_(&s), active_(false) { }
+        member(boost::shared_ptr<eureqa::connection> conn, boost::shared_ptr<eureqa::session> s) : conn_(conn), owned_(s), session_(s.get()), active_(false) { }
+
+        bool query_progress() { return session_->query_progress(progress_); }
+        bool query_frontier() { return session_->query_frontier(arena_); }
+    };
+
+    std::vector<member> members_;
+    std::vector<std::string> hostnames_;
+    boost::mutex mutex_; // held while members are added or removed, for cancel()
+
+public:
+    cluster(eureqa::session& first);
+
+    // connects to every server and begins a new session on each, a hostname may
+    // end in :port to use a port other than the default, or be a "unix:path";
+    // true if any of them connected, the others are left out until the next connect()
+    bool connect(const std::vector<std::string>& hostnames, int port = default_port_tcp);
+    bool connect(std::string hostname, int port = default_port_tcp);
+
+    // ends the sessions on every server
+    void disconnect();
+
+    // tests if any server is connected, or will reconnect on its next command
+    bool is_connected() const;
+
+    // makes the commands in flight on another thread fail promptly
+    void cancel();
+
+    // how lost connections are restored, on every server
+    void set_policy(const reconnect_policy& policy);
+
+    // where data sets are sent by reference, for every server including those connected later
+    void set_shared_directory(std::string dir);
+
+    // commands, sent to every server concurrently
+    bool send_data_set(const eureqa::data_set& data);
+    bool send_data_location(std::string path);
+    bool send_options(const eureqa::search_options& options);
+    bool start_search();
+    bool pause_search();
+    bool end_search();
+
+    // queries every server concurrently and aggregates the replies:
+    // evaluations, speeds and population sizes are summed over the servers,
+    // generations are those of the server furthest along, and the solution
+    // is the fittest one received
+    bool query_progress(eureqa::search_progress& progress);
+
+    // the pareto front of the frontiers of all the servers
+    bool query_frontier(eureqa::solution_frontier& front);
+    bool query_frontier(eureqa::solution_arena& front);
+
+    // the merged frontier of everything received so far
+    eureqa::solution_frontier& frontier() { return members_[0].session_->frontier(); }
+    const eureqa::solution_frontier& frontier() const { return members_[0].session_->frontier(); }
+
+    // the servers, including those dropped
+    int size() const { return (int)members_.size(); }
+    int active() const;
+    bool is_active(int i) const { return members_[i].active_; }
+    std::string hostname(int i) const { return hostnames_[i]; }
+    eureqa::command_result last_result(int i) const { return members_[i].result_; }
+    eureqa::session& member_session(int i) { return *members_[i].session_; }
+
+protected:
+    bool fan_out(boost::function<bool (member&)> call);
+    static bool on_session(member& m, const boost::function<bool (eureqa::session&)>& call) { return call(*m.session_); }
+    static void run(member* m, const boost::function<bool (member&)>* call, char* result);
+    static void record(member& m, bool succeeded);
+    void merge(const eureqa::solution_info& soln) { if (!soln.text_.empty()) { frontier().add(soln); } }
+};
+
+/*---------------------------------------------------------------------------
+    implementions:
+*--------------------------------------------------------------------------*/
+inline
+cluster::cluster(eureqa::session& first)
+{
+    members_.push_back(member(first));
+    hostnames_.push_back(std::string());
+}
+
+inline
+bool cluster::connect(const std::vector<std::string>& hostnames, int port)
+{
+    if (hostnames.empty()) { return false; }
+    disconnect();
+
+    // the extra servers share the first one's settings
+    eureqa::session& first = *members_[0].session_;
+    {
+        boost::mutex::scoped_lock lock(mutex_);
+        hostnames_ = hostnames;
+        for (int i=1; i<(int)hostnames.size(); ++i)
+        {
+            boost::shared_ptr<eureqa::connection> conn(new eureqa::connection());
+            conn->set_shared_directory(first.conn().shared_directory());
+            conn->set_instrumented(first.conn().instrumented());
+            boost::shared_ptr<eureqa::session> s(new eureqa::session(*conn, first.policy()));
+            members_.push_back(member(conn, s));
+        }
+    }
+
+    // connect to them all at once, a server that cannot be reached is left out
+    for (int i=0; i<(int)members_.size(); ++i) { members_[i].active_ = true; }
+    std::vector<char> results(members_.size(), 0);
+    boost::thread_group threads;
+    std::vector<boost::function<bool (member&)> > calls;
+    for (int i=0; i<(int)members_.size(); ++i)
+    {
+        std::string host;
+        int host_port = port;
+        eureqa::connection::parse_address(hostnames_[i], host, host_port);
+        calls.push_back(boost::bind(&cluster::on_session, _1, boost::function<bool (eureqa::session&)>(
+            boost::bind(&eureqa::session::connect, _1, host, host_port))));
+    }
+    for (int i=1; i<(int)members_.size(); ++i) { threads.create_thread(boost::bind(&cluster::run, &members_[i], &calls[i], &results[i])); }
+    run(&members_[0], &calls[0], &results[0]);
+    threads.join_all();
+
+    bool any = false;
+    for (int i=0; i<(int)members_.size(); ++i)
+    {
+        members_[i].active_ = results[i] != 0;
+        any = any || members_[i].active_;
+    }
+    return any;
+}
+
+inline
+bool cluster::connect(std::string hostname, int port)
+{
+    return connect(std::vector<std::string>(1, hostname), port);
+}
+
+inline
+void cluster::disconnect()
+{
+    boost::mutex::scoped_lock lock(mutex_);
+    for (int i=0; i<(int)members_.size(); ++i) { members_[i].session_->disconnect(); }
+    members_.erase(members_.begin() + 1, members_.end());
+    members_[0].active_ = false;
+    hostnames_.resize(1);
+}
+
+inline
+bool cluster::is_connected() const
+{
+    for (int i=0; i<(int)members_.size(); ++i)
+    {
+        if (members_[i].active_ && members_[i].session_->is_connected()) { return true; }
+    }
+    return false;
+}
+
+inline
+void cluster::cancel()
+{
+    boost::mutex::scoped_lock lock(mutex_);
+    for (int i=0; i<(int)members_.size(); ++i) { members_[i].session_->cancel(); }
+}
+
+inline
+void cluster::set_policy(const reconnect_policy& policy)
+{
+    for (int i=0; i<(int)members_.size(); ++i) { members_[i].session_->set_policy(policy); }
+}
+
+inline
+void cluster::set_shared_directory(std::string dir)
+{
+    // connect() hands the first member's directory on to the others
+    for (int i=0; i<(int)members_.size(); ++i) { members_[i].session_->conn().set_shared_directory(dir); }
+}
+
+inline
+int cluster::active() const
+{
+    int n = 0;
+    for (int i=0; i<(int)members_.size(); ++i) { n += members_[i].active_ ? 1 : 0; }
+    return n;
+}
+
+inline
+bool cluster::send_data_set(const eureqa::data_set& data)
+{
+    return fan_out(boost::bind(&cluster::on_session, _1, boost::function<bool (eureqa::session&)>(
+        boost::bind(&eureqa::session::send_data_set, _1, boost::cref(data)))));
+}
+
+inline
+bool cluster::send_data_location(std::string path)
+{
+    return fan_out(boost::bind(&cluster::on_session, _1, boost::function<bool (eureqa::session&)>(
+        boost::bind(&eureqa::session::send_data_location, _1, path))));
+}
+
+inline
+bool cluster::send_options(const eureqa::search_options& options)
+{
+    return fan_out(boost::bind(&cluster::on_session, _1, boost::function<bool (eureqa::session&)>(
+        boost::bind(&eureqa::session::send_options, _1, boost::cref(options)))));
+}
+
+inline
+bool cluster::start_search()
+{
+    return fan_out(boost::bind(&cluster::on_session, _1, boost::function<bool (eureqa::session&)>(
+        boost::bind(&eureqa::session::start_search, _1))));
+}
+
+inline
+bool cluster::pause_search()
+{
+    return fan_out(boost::bind(&cluster::on_session, _1, boost::function<bool (eureqa::session&)>(
+        boost::bind(&eureqa::session::pause_search, _1))));
+}
+
+inline
+bool cluster::end_search()
+{
+    return fan_out(boost::bind(&cluster::on_session, _1, boost::function<bool (eureqa::session&)>(
+        boost::bind(&eureqa::session::end_search, _1))));
+}
+
+inline
+bool cluster::query_progress(eureqa::search_progress& progress)
+{
+    if (!fan_out(boost::bind(&member::query_progress, _1))) { return false; }
+
+    progress = eureqa::search_progress();
+    bool has_solution = false;
+    for (int i=0; i<(int)members_.size(); ++i)
+    {
+        if (!members_[i].active_) { continue; }
+        const eureqa::search_progress& p = members_[i].progress_;
+        if (p.generations_ >= progress.generations_)
+        {
+            progress.generations_ = p.generations_;
+            progress.generations_per_sec_ = p.generations_per_sec_;
+        }
+        progress.evaluations_ += p.evaluations_;
+        progress.evaluations_per_sec_ += p.evaluations_per_sec_;
+        progress.total_population_size_ += p.total_population_size_;
+        if (!p.solution_.text_.empty() && (!has_solution || p.solution_.fitness_ > progress.solution_.fitness_))
+        {
+            progress.solution_ = p.solution_;
+            has_solution = true;
+        }
+        if (i > 0) { merge(p.solution_); } // the first member's session has added its own
+    }
+    return true;
+}
+
+inline
+bool cluster::query_frontier(eureqa::solution_frontier& front)
+{
+    if (!fan_out(boost::bind(&member::query_frontier, _1))) { return false; }
+
+    front.clear();
+    for (int i=0; i<(int)members_.size(); ++i)
+    {
+        if (!members_[i].active_) { continue; }
+        members_[i].arena_.add_to(front);
+        if (i > 0) { members_[i].arena_.add_to(frontier()); }
+    }
+    return true;
+}
+
+inline
+bool cluster::query_frontier(eureqa::solution_arena& front)
+{
+    // a single server decodes straight into the caller's arena
+    if (members_.size() == 1) { return members_[0].session_->query_frontier(front); }
+
+    eureqa::solution_frontier merged;
+    if (!query_frontier(merged)) { return false; }
+    front.clear();
+    for (int i=0; i<merged.size(); ++i) { front.allocate() = merged[i]; }
+    return true;
+}
+
+inline
+bool cluster::fan_out(boost::function<bool (member&)> call)
+{
+    // a lone server is called on this thread, and its exceptions are the caller's
+    std::vector<int> live;
+    for (int i=0; i<(int)members_.size(); ++i) { if (members_[i].active_) { live.push_back(i); } }
+    if (live.empty()) { return false; }
+    if (live.size() == 1)
+    {
+        bool succeeded = call(members_[live[0]]);
+        record(members_[live[0]], succeeded);
+        return succeeded;
+    }
+
+    std::vector<char> results(members_.size(), 0);
+    boost::thread_group threads;
+    for (int j=1; j<(int)live.size(); ++j) { threads.create_thread(boost::bind(&cluster::run, &members_[live[j]], &call, &results[live[j]])); }
+    run(&members_[live[0]], &call, &results[live[0]]);
+    threads.join_all();
+
+    // drop the servers that failed, unless they all did
+    int succeeded = 0;
+    for (int j=0; j<(int)live.size(); ++j) { succeeded += results[live[j]] ? 1 : 0; }
+    if (succeeded == 0) { return false; }
+    for (int j=0; j<(int)live.size(); ++j)
+    {
+        member& m = members_[live[j]];
+        if (!results[live[j]]) { m.active_ = false; m.session_->disconnect(); }
+    }
+    return true;
+}
+
+inline
+void cluster::run(member* m, const boost::function<bool (member&)>* call, char* result)
+{
+    try { *result = (*call)(*m) ? 1 : 0; }
+    catch (const std::exception&) { *result = 0; }
+    record(*m, *result != 0);
+}
+
+inline
+void cluster::record(member& m, bool succeeded)
+{
+    m.result_ = succeeded ? m.session_->conn().last_result() : eureqa::command_result(result_error, "no reply");
+}
+
+} // namespace eureqa
+
+#endif // EUREQA_CLUSTER_H
@@ -3,17 +3,36 @@
 
 #include <string>
 #include <vector>
+#include <map>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+#include <utility>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
 #include <boost/asio.hpp>
 #include <boost/array.hpp>
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
 #include <boost/archive/xml_iarchive.hpp>
 #include <boost/archive/xml_oarchive.hpp>
 #include <boost/serialization/vector.hpp>
+#include <eureqa/packet.h>
 #include <eureqa/data_set.h>
 #include <eureqa/server_info.h>
 #include <eureqa/search_progress.h>
 #include <eureqa/search_options.h>
 #include <eureqa/solution_frontier.h>
+#include <eureqa/solution_arena.h>
+#include <eureqa/xml_codec.h>
+#include <eureqa/capture.h>
 
+// default packet encoding, connections can switch or negotiate at runtime
 #define EUREQA_USE_XML
 
 namespace eureqa
@@ -21,7 +40,16 @@ namespace eureqa
 // default connection options
 static const int default_port_tcp = 22112;
 static const int default_port_multicast = 30002;
-static boost::asio::io_service default_io_service;
+
+// the io_service for connections constructed on one, a single object however many
+// translation units include this; whoever uses it runs it
+inline boost::asio::io_service& process_io_service() { static boost::asio::io_service io_service; return io_service; }
+static boost::asio::io_service& default_io_service = process_io_service();
+#ifdef EUREQA_USE_XML
+static const int default_encoding = encodings::xml;
+#else
+static const int default_encoding = encodings::binary;
+#endif
 
 // response codes
 static const int result_success = 0;
@@ -42,6 +70,13 @@ static const int start_search       = 301;
 static const int pause_search       = 302;
 static const int end_search         = 303;
 static const int calc_solution_info = 401;
+
+// message layout of each command, for code that relays commands it does not interpret
+bool is_known(int cmd);
+bool has_argument(int cmd); // followed by a fixed int argument
+bool has_packet(int cmd); // followed by a size/data packet
+bool returns_packet(int cmd); // answered with a lone packet rather than a command_result
+const char* name(int cmd); // as the constant is named, "unknown" if it is not one
 }
 
 // info sent back from the server after non-query commands
@@ -60,12 +95,114 @@ public:
 inline
 std::ostream& operator <<(std::ostream& os, const command_result& r) { return os << r.message(); }
 
+// limits on how long each connect, write and read may take, in milliseconds
+// zero waits indefinitely; a write or read that times out disconnects
+struct connection_deadlines
+{
+    int connect_ms_;
+    int write_ms_;
+    int read_ms_;
+    connection_deadlines(int connect_ms = 10000, int write_ms = 0, int read_ms = 0) :
+        connect_ms_(connect_ms), write_ms_(write_ms), read_ms_(read_ms) { }
+};
+
+// counts of values in power-of-two buckets, cheap enough to update on every command
+// bucket 0 counts values below 1, bucket i values in [2^(i-1), 2^i), the last one everything above
+struct log2_histogram
+{
+    static const int buckets = 40;
+    unsigned long counts_[buckets];
+    unsigned long count_;
+    double sum_;
+    double max_;
+    log2_histogram() : count_(0), sum_(0), max_(0) { std::fill(counts_, counts_+buckets, 0ul); }
+    void add(double value);
+    void add(const log2_histogram& other); // the values of both
+    double mean() const { return (count_ > 0) ? sum_/count_ : 0.0; }
+
+    // upper bound of the bucket holding the fraction p of the values, at most max_
+    double percentile(double p) const;
+};
+
+// what each command costs, the times are in microseconds
+// for send_data_set the serialize time is the pass that sizes the packet,
+// the data set is serialized again as it is written
+struct command_statistics
+{
+    log2_histogram serialize_us_; // encoding the request, for commands that carry a packet
+    log2_histogram write_us_; // writing the request to the socket
+    log2_histogram first_byte_us_; // from the end of the write until the response starts to arrive
+    log2_histogram decode_us_; // decoding the response, for queries
+    log2_histogram bytes_out_;
+    log2_histogram bytes_in_;
+    unsigned long calls() const { return write_us_.count_; }
+    void add(const command_statistics& other);
+};
+
+// counters for tuning the deadlines
+struct connection_statistics
+{
+    int connects_; // successful connects
+    int connect_failures_; // including timeouts
+    double last_connect_ms_; // time to connect of the last successful connect
+    double total_connect_ms_;
+    int connect_timeouts_;
+    int write_timeouts_;
+    int read_timeouts_;
+    connection_statistics() : connects_(0), connect_failures_(0), last_connect_ms_(0), total_connect_ms_(0),
+        connect_timeouts_(0), write_timeouts_(0), read_timeouts_(0) { }
+    double mean_connect_ms() const { return (connects_ > 0) ? total_connect_ms_/connects_ : 0.0; }
+
+    // totals of both, such as the connections to several servers
+    void add(const connection_statistics& other);
+
+    // by command code, only recorded while the connection is instrumented
+    // commands batched by a pipeline are not recorded
+    std::map<int, command_statistics> commands_;
+};
+
 // synchronous/blocking network interface with a eureqa server
 class connection
 {
+    friend class pipeline;
+
 protected:
+    boost::scoped_ptr<boost::asio::io_service> own_io_service_; // unless one is passed in
+    boost::asio::io_service& io_service_;
     boost::asio::ip::tcp::socket socket_;
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+    boost::scoped_ptr<boost::asio::local::stream_protocol::socket> local_socket_; // used instead of socket_ for "unix:" hosts
+#endif
+    boost::mutex socket_mutex_; // held while the sockets are opened, closed or replaced, for cancel()
     command_result last_result_;
+    int encoding_;
+    std::string hostname_;
+    int port_;
+    std::vector<char> receive_buffer_; // reused by every response, only ever grows
+    int received_bytes_;
+    connection_deadlines deadlines_;
+    connection_statistics statistics_;
+    bool instrumented_;
+
+    // the command being timed for statistics_.commands_
+    struct command_sample
+    {
+        int cmd_; // 0 when none
+        bool awaiting_response_; // written, and nothing read since
+        double serialize_us_;
+        double write_us_;
+        double first_byte_us_;
+        double decode_us_;
+        std::size_t bytes_out_;
+        std::size_t bytes_in_;
+        boost::posix_time::ptime written_;
+        command_sample() : cmd_(0), awaiting_response_(false) { }
+    };
+    command_sample sample_;
+    double pending_serialize_us_; // taken by the next command to begin
+    boost::scoped_ptr<capture_writer> capture_; // while recording
+    std::string shared_directory_; // data sets are sent by reference through files here
+    int spills_; // data set files written, names them uniquely
     
 public:
     // default constructor
@@ -75,17 +212,74 @@ public:
     virtual ~connection() { disconnect(); }
     
     // basic connection information
-    bool is_connected() const { return socket_.is_open(); }
+    bool is_connected() const { return socket_.is_open() || is_local(); }
     command_result last_result() const { return last_result_; }
 
-    // opens a network connection to a eureqa server
+    // opens a network connection to a eureqa server,
+    // or with a hostname of "unix:path" a local socket, such as one served by eureqa_broker
     bool connect(std::string hostname, int port = default_port_tcp);
-    void disconnect() { socket_.close(); }
+    void disconnect() { close_socket(); }
+
+    // splits an address given as "host", "host:port", "[ipv6]:port", a bare ipv6 address or "unix:path"
+    // into what connect() takes, port is left as it is unless the address gives one
+    static void parse_address(const std::string& address, std::string& host, int& port);
+
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+    // takes over an open local socket, such as one end of a socket pair whose other
+    // end a mock_server in this process serves, and reads the server's greeting
+    bool adopt(boost::asio::local::stream_protocol::socket::native_handle_type handle);
+#endif
+
+    // makes a call blocked on another thread fail promptly, leaving the connection closed
+    // the only member that may be called while another thread is using the connection,
+    // it also stops the connection's io_service
+    void cancel();
+
+    // packet encoding used for commands sent to the server
+    // responses are decoded in whichever encoding the server replies with
+    int encoding() const { return encoding_; }
+    void set_encoding(int encoding) { encoding_ = encoding; }
+
+    // probes whether the server accepts the preferred encoding and falls back to xml if not
+    // reconnects if the server dropped the connection over the probe
+    bool negotiate_encoding(int preferred = encodings::binary);
+
+    // per-operation deadlines, the connect deadline covers racing every resolved address
+    // waiting on a deadline runs the connection's io_service, so one passed in
+    // to the constructor must not be run by another thread at the same time
+    const connection_deadlines& deadlines() const { return deadlines_; }
+    void set_deadlines(const connection_deadlines& deadlines) { deadlines_ = deadlines; }
+
+    // time-to-connect and timeout counts since the connection was created,
+    // and per-command times and sizes while instrumented
+    const connection_statistics& statistics() const { return statistics_; }
+    void reset_statistics() { statistics_ = connection_statistics(); }
+
+    // records statistics().commands_, off by default
+    // it reads the clock a few times per command and does not allocate once each command has been seen
+    bool instrumented() const { return instrumented_; }
+    void set_instrumented(bool instrumented) { instrumented_ = instrumented; sample_ = command_sample(); }
+
+    // writes every command sent and response received, with timestamps, to a capture file
+    // which eureqa_replay plays back against a server or decodes offline
+    // recording continues across reconnects until stop_recording()
+    bool start_recording(std::string path);
+    void stop_recording() { capture_.reset(); }
+    bool is_recording() const { return capture_.get() != 0; }
 
     // send server the data set over the network
     // or tell it to load it from a network file
     bool send_data_set(const eureqa::data_set& data);
     bool send_data_location(std::string path);
+
+    // sends data sets by reference: send_data_set() writes each one to a file in a
+    // directory the server can also read, such as on a shared or the same filesystem,
+    // and sends only its path; one the server cannot load is sent over the network
+    // as usual, and an empty directory, the default, always sends them that way
+    // the server parses the file as text, so this pays off when the network is the
+    // slow part, not for a server on the same host with the binary encoding
+    std::string shared_directory() const { return shared_directory_; }
+    void set_shared_directory(std::string dir) { shared_directory_ = dir; }
     
     // send server the search options
     bool send_options(const eureqa::search_options& options);
@@ -104,9 +298,11 @@ public:
     // query server for random individuals from its population
     bool query_individuals(eureqa::solution_info& soln);
     bool query_individuals(std::vector<eureqa::solution_info>& individuals, int count);
+    bool query_individuals(eureqa::solution_arena& individuals, int count);
     
     // query the servers local solution frontier
     bool query_frontier(eureqa::solution_frontier& front);
+    bool query_frontier(eureqa::solution_arena& front);
     
     // tell server to start/pause/end searching
     bool start_search();
@@ -124,14 +320,72 @@ public:
     
 protected:
     bool connect_socket(std::string hostname, int port);
+    bool connect_local(std::string path);
+    bool is_local() const;
+
+    // all socket i/o goes through these, a failed write or read disconnects
+    template<typename ConstBufferSequence> bool write_buffers(const ConstBufferSequence& buffers);
+    template<typename MutableBufferSequence> bool read_buffers(const MutableBufferSequence& buffers);
+    template<typename Stream, typename ConstBufferSequence> bool write_stream(Stream& stream, const ConstBufferSequence& buffers);
+    template<typename Stream, typename MutableBufferSequence> bool read_stream(Stream& stream, const MutableBufferSequence& buffers);
+
+    // writes the data set to the shared directory and has the server load it,
+    // false if either fails; the file is removed once the server has answered
+    bool send_data_reference(const eureqa::data_set& data);
+
+    // per-command statistics, a sample begins with the command's write and ends
+    // once its response has been read or decoded, a failure discards it
+    void begin_sample(int cmd);
+    void end_sample();
+    void discard_sample() { sample_.cmd_ = 0; }
+    template<typename T> void encode_request(const T& val, const char* name, std::string& packet);
+    static boost::posix_time::ptime now() { return boost::posix_time::microsec_clock::universal_time(); }
+    static double elapsed_us(boost::posix_time::ptime since, boost::posix_time::ptime until) { return (double)(until - since).total_microseconds(); }
+
+    // state of the asynchronous operations behind a deadline
+    struct deadline_state
+    {
+        int operations_; // operations still to complete, not counting the timer
+        bool timer_pending_;
+        bool expired_;
+        bool finished_; // the caller has its result, the rest can be cancelled
+        bool cancelled_; // by cancel() from another thread
+        boost::system::error_code error_;
+        int winner_; // index of the first socket to connect
+        deadline_state(int operations) : operations_(operations), timer_pending_(false), expired_(false),
+            finished_(false), cancelled_(false), winner_(-1) { }
+    };
+    void run_to_deadline(deadline_state& state, int deadline_ms, boost::function<void ()> cancel);
+    static void handle_timer(deadline_state* state, const boost::system::error_code& error);
+    static void handle_transfer(deadline_state* state, const boost::system::error_code& error);
+    static void handle_race(deadline_state* state, int i, const boost::system::error_code& error);
+    void close_socket();
+    typedef boost::shared_ptr<boost::asio::ip::tcp::socket> socket_ptr;
+    static void close_losers(std::vector<socket_ptr>* sockets, const deadline_state* state);
 
     template<typename T> bool write_fixed(const T& val);
     template<typename T> bool write_command_fixed(int cmd, const T& val);
     bool write_command(int cmd);
     bool write_command_packet(int cmd, const void* buf, int num_bytes);
     bool write_command_packet(int cmd, const std::string& s);
+    template<typename T> bool stream_command_packet(int cmd, const T& val, const char* name);
+    
+    // adapts write_buffers to the SyncWriteStream concept for socket_streambuf
+    struct buffer_writer
+    {
+        connection& conn_;
+        buffer_writer(connection& conn) : conn_(conn) { }
+        template<typename ConstBufferSequence>
+        std::size_t write_some(const ConstBufferSequence& buffers, boost::system::error_code& error)
+        {
+            if (!conn_.write_buffers(buffers)) { error = boost::asio::error::not_connected; return 0; }
+            return boost::asio::buffer_size(buffers);
+        }
+    };
     
     template<typename T> bool read_fixed(T& val);
+    bool read_packet();
+    template<typename T> void decode_received(const char* name, T& val);
     bool read_packet(std::vector<char>& buf);
     bool read_packet(std::string& s);
     bool read_response();
@@ -141,47 +395,201 @@ protected:
 /*---------------------------------------------------------------------------
     implementions:
 *--------------------------------------------------------------------------*/
+namespace commands
+{
+inline
+const char* name(int cmd)
+{
+    switch (cmd)
+    {
+    case send_data_set: return "send_data_set";
+    case send_data_location: return "send_data_location";
+    case send_options: return "send_options";
+    case send_individuals: return "send_individuals";
+    case query_progress: return "query_progress";
+    case query_server_info: return "query_server_info";
+    case query_individuals: return "query_individuals";
+    case query_frontier: return "query_frontier";
+    case start_search: return "start_search";
+    case pause_search: return "pause_search";
+    case end_search: return "end_search";
+    case calc_solution_info: return "calc_solution_info";
+    default: return "unknown";
+    }
+}
+
+inline
+bool is_known(int cmd)
+{
+    return has_packet(cmd) || has_argument(cmd) || returns_packet(cmd)
+        || cmd == start_search || cmd == pause_search || cmd == end_search;
+}
+
+inline
+bool has_argument(int cmd)
+{
+    return cmd == query_individuals;
+}
+
+inline
+bool has_packet(int cmd)
+{
+    return cmd == send_data_set || cmd == send_data_location || cmd == send_options
+        || cmd == send_individuals || cmd == calc_solution_info;
+}
+
+inline
+bool returns_packet(int cmd)
+{
+    return cmd == query_progress || cmd == query_server_info || cmd == query_individuals
+        || cmd == query_frontier || cmd == calc_solution_info;
+}
+}
+
 
 inline 
 connection::connection() : 
-    socket_(default_io_service)
+    own_io_service_(new boost::asio::io_service),
+    io_service_(*own_io_service_),
+    socket_(io_service_),
+    encoding_(default_encoding),
+    port_(default_port_tcp),
+    received_bytes_(0),
+    instrumented_(false),
+    pending_serialize_us_(0),
+    spills_(0)
 { }
 
 inline
 connection::connection(std::string hostname, int port) :
-    socket_(default_io_service)
+    own_io_service_(new boost::asio::io_service),
+    io_service_(*own_io_service_),
+    socket_(io_service_),
+    encoding_(default_encoding),
+    port_(default_port_tcp),
+    received_bytes_(0),
+    instrumented_(false),
+    pending_serialize_us_(0),
+    spills_(0)
 {
     connect(hostname, port);
 }
 
 inline 
 connection::connection(boost::asio::io_service& io_service) : 
-    socket_(io_service)
+    io_service_(io_service),
+    socket_(io_service_),
+    encoding_(default_encoding),
+    port_(default_port_tcp),
+    received_bytes_(0),
+    instrumented_(false),
+    pending_serialize_us_(0),
+    spills_(0)
 { }
 
+inline
+void connection::parse_address(const std::string& address, std::string& host, int& port)
+{
+    host = address;
+    if (address.compare(0, 5, "unix:") == 0) { return; }
+    if (!address.empty() && address[0] == '[')
+    {
+        std::string::size_type bracket = address.find(']');
+        if (bracket == std::string::npos) { return; }
+        host = address.substr(1, bracket - 1);
+        if (address.compare(bracket + 1, 1, ":") == 0) { port = std::atoi(address.c_str() + bracket + 2); }
+        return;
+    }
+    // more than one colon is an ipv6 address without a port
+    std::string::size_type colon = address.find(':');
+    if (colon == std::string::npos || colon != address.rfind(':')) { return; }
+    host = address.substr(0, colon);
+    port = std::atoi(address.c_str() + colon + 1);
+}
+
 inline
 bool connection::connect(std::string hostname, int port)
 {
-    if (!connect_socket(hostname, port)) { return false; }
+    hostname_ = hostname;
+    port_ = port;
+    if (hostname.compare(0, 5, "unix:") == 0)
+    {
+        if (!connect_local(hostname.substr(5))) { return false; }
+    }
+    else if (!connect_socket(hostname, port)) { return false; }
+    if (capture_) { capture_->connected(hostname, port); }
     if (!read_response()) { return false; }
     return true;
 }
 
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+inline
+bool connection::adopt(boost::asio::local::stream_protocol::socket::native_handle_type handle)
+{
+    close_socket();
+    hostname_ = "unix:";
+    port_ = 0;
+    boost::system::error_code error;
+    {
+        boost::mutex::scoped_lock lock(socket_mutex_);
+        local_socket_.reset(new boost::asio::local::stream_protocol::socket(io_service_));
+        local_socket_->assign(boost::asio::local::stream_protocol(), handle, error);
+    }
+    if (error) { close_socket(); ++statistics_.connect_failures_; return false; }
+    ++statistics_.connects_;
+    if (capture_) { capture_->connected(hostname_, port_); }
+    return read_response();
+}
+#endif
+
+inline
+bool connection::start_recording(std::string path)
+{
+    capture_.reset(new capture_writer(path));
+    if (!capture_->is_open()) { capture_.reset(); return false; }
+    if (is_connected()) { capture_->connected(hostname_, port_); }
+    return true;
+}
+
+inline
+bool connection::negotiate_encoding(int preferred)
+{
+    encoding_ = preferred;
+    if (preferred == encodings::xml) { return true; }
+    
+    // ask the server to evaluate an empty list of individuals in the preferred encoding,
+    // it is accepted if the server answers in kind
+    std::string packet;
+    encode_packet(preferred, std::vector<eureqa::solution_info>(), "vector_solution_info", packet);
+    bool accepted = false;
+    if (write_command_packet(commands::calc_solution_info, packet) && read_packet(packet))
+    {
+        try
+        {
+            std::vector<eureqa::solution_info> individuals;
+            decode_packet(packet, "vector_solution_info", individuals);
+            accepted = (packet_encoding(packet) == preferred);
+        }
+        catch (const boost::archive::archive_exception&) { accepted = false; }
+    }
+    discard_sample(); // a probe, not a real calc_solution_info
+    if (accepted) { return true; }
+    
+    // fall back to xml, which every server understands
+    encoding_ = encodings::xml;
+    if (!is_connected()) { return connect(hostname_, port_); }
+    return true;
+}
+
 inline
 bool connection::send_data_set(const eureqa::data_set& data)
 {
-    // serialize the data set
-    #ifdef EUREQA_USE_XML
-    std::ostringstream ss;
-    boost::archive::xml_oarchive ar(ss);
-    #else
-    std::ostringstream ss(std::ios_base::out|std::ios_base::binary);
-    boost::archive::binary_oarchive ar(ss);
-    #endif
-    ar & boost::serialization::make_nvp("data_set", data );
+    if (!shared_directory_.empty() && is_connected() && send_data_reference(data)) { return true; }
+    if (!is_connected()) { return false; }
     
-    // send a command-code, packet size, and data packet
-    if (!write_command_packet(commands::send_data_set, ss.str())) { return false; }
+    // stream the data set to the server as it is serialized,
+    // large data sets are never copied into a packet
+    if (!stream_command_packet(commands::send_data_set, data, "data_set")) { return false; }
     if (!read_response()) { return false; }
     return true;
 }
@@ -194,21 +602,33 @@ bool connection::send_data_location(std::string path)
     return true;
 }
 
+inline
+bool connection::send_data_reference(const eureqa::data_set& data)
+{
+    // a name no other upload uses, so a server that does not share the directory
+    // cannot find an older file of the same name and must fail to load it
+    std::ostringstream os;
+    os << shared_directory_;
+    if (shared_directory_[shared_directory_.size()-1] != '/' && shared_directory_[shared_directory_.size()-1] != '\\') { os << '/'; }
+    os << "eureqa_data_" << std::hex << (unsigned long)std::time(0) << '_' << (const void*)this << '_' << std::dec << ++spills_ << ".txt";
+    std::string path = os.str();
+    
+    bool loaded = data.export_ascii(path)
+        && send_data_location(path)
+        && last_result_.value() == result_success;
+    std::remove(path.c_str());
+    return loaded;
+}
+
 inline
 bool connection::send_options(const eureqa::search_options& options)
 {
-    // serialize the data set
-    #ifdef EUREQA_USE_XML
-    std::ostringstream ss;
-    boost::archive::xml_oarchive ar(ss);
-    #else
-    std::ostringstream ss(std::ios_base::out|std::ios_base::binary);
-    boost::archive::binary_oarchive ar(ss);
-    #endif
-    ar << boost::serialization::make_nvp("search_options", options );
+    // serialize the search options
+    std::string packet;
+    encode_request(options, "search_options", packet);
     
     // send a command-code, packet size, and data packet
-    if (!write_command_packet(commands::send_options, ss.str())) { return false; }
+    if (!write_command_packet(commands::send_options, packet)) { return false; }
     if (!read_response()) { return false; }
     return true;
 }
@@ -229,13 +649,12 @@ bool connection::send_individuals(eureqa::solution_info soln)
 inline
 bool connection::send_individuals(const std::vector<solution_info>& individuals)
 {
-    // serialize the data set
-    std::ostringstream ss;
-    boost::archive::xml_oarchive ar(ss);
-    ar << boost::serialization::make_nvp("vector_solution_info", individuals );
+    // serialize the individuals
+    std::string packet;
+    encode_request(individuals, "vector_solution_info", packet);
     
     // send a command-code, packet size, and data packet
-    if (!write_command_packet(commands::send_individuals, ss.str())) { return false; }
+    if (!write_command_packet(commands::send_individuals, packet)) { return false; }
     if (!read_response()) { return false; }
     return true;
 }
@@ -247,13 +666,10 @@ bool connection::query_progress(eureqa::search_progress& progress)
     if (!write_command(commands::query_progress)) { return false; }
     
     // read packet
-    std::string s;
-    if (!read_packet(s)) { return false; }
+    if (!read_packet()) { return false; }
     
-    // serialize store
-    std::istringstream ss(s);
-    boost::archive::xml_iarchive ar(ss);
-    ar >> boost::serialization::make_nvp("search_progress", progress );
+    // serialize store, decoding in place into the existing object
+    decode_received("search_progress", progress);
     return true;
 }
 
@@ -264,13 +680,10 @@ bool connection::query_server_info(eureqa::server_info& info)
     if (!write_command(commands::query_server_info)) { return false; }
     
     // read packet
-    std::string s;
-    if (!read_packet(s)) { return false; }
+    if (!read_packet()) { return false; }
     
-    // serialize store
-    std::istringstream ss(s);
-    boost::archive::xml_iarchive ar(ss);
-    ar >> boost::serialization::make_nvp("server_info", info );
+    // serialize store, decoding in place into the existing object
+    decode_received("server_info", info);
     return true;
 }
 
@@ -291,13 +704,24 @@ bool connection::query_individuals(std::vector<solution_info>& individuals, int
     if (!write_command_fixed(commands::query_individuals, count)) { return false; }
     
     // read packet
-    std::string s;
-    if (!read_packet(s)) { return false; }
+    if (!read_packet()) { return false; }
     
     // serialize
-    std::istringstream ss(s);
-    boost::archive::xml_iarchive ar(ss);
-    ar >> boost::serialization::make_nvp("vector_solution_info", individuals );
+    decode_received("vector_solution_info", individuals);
+    return true;
+}
+
+inline
+bool connection::query_individuals(eureqa::solution_arena& individuals, int count)
+{
+    // request individuals
+    if (!write_command_fixed(commands::query_individuals, count)) { return false; }
+    
+    // read packet
+    if (!read_packet()) { return false; }
+    
+    // serialize, reusing the arena's solutions
+    decode_received("vector_solution_info", individuals);
     return true;
 }
 
@@ -308,13 +732,25 @@ bool connection::query_frontier(eureqa::solution_frontier& frontier)
     if (!write_command(commands::query_frontier)) { return false; }
     
     // read packet
-    std::string packet;
-    if (!read_packet(packet)) { return false; }
+    if (!read_packet()) { return false; }
     
     // serialize store
-    std::istringstream is(packet);
-    boost::archive::xml_iarchive ar(is);
-    ar >> boost::serialization::make_nvp("solution_frontier", frontier);
+    decode_received("solution_frontier", frontier);
+    return true;
+}
+
+inline
+bool connection::query_frontier(eureqa::solution_arena& front)
+{
+    // request frontier
+    if (!write_command(commands::query_frontier)) { return false; }
+    
+    // read packet
+    if (!read_packet()) { return false; }
+    
+    // serialize store, reusing the arena's solutions
+    solution_arena_frontier frontier(front);
+    decode_received("solution_frontier", frontier);
     return true;
 }
 
@@ -355,28 +791,25 @@ bool connection::calc_solution_info(eureqa::solution_info& ind)
 inline
 bool connection::calc_solution_info(std::vector<eureqa::solution_info>& individuals)
 {
-    // serialize the data set
-    std::ostringstream os;
-    boost::archive::xml_oarchive ar(os);
-    ar << boost::serialization::make_nvp("vector_solution_info", individuals);
+    // serialize the individuals
+    std::string packet;
+    encode_request(individuals, "vector_solution_info", packet);
     
     // send a command-code, packet size, and data packet
-    if (!write_command_packet(commands::calc_solution_info, os.str())) { return false; }
+    if (!write_command_packet(commands::calc_solution_info, packet)) { return false; }
     
     // read packet
-    std::string packet;
-    if (!read_packet(packet)) { return false; }
+    if (!read_packet()) { return false; }
     
     // serialize
-    std::istringstream is(packet);
-    boost::archive::xml_iarchive ar2(is);
-    ar2 >> boost::serialization::make_nvp("vector_solution_info", individuals);
+    decode_received("vector_solution_info", individuals);
     return true;
 }
 
 inline
 std::string connection::remote_address() const
 {
+    if (is_local()) { return hostname_; }
     boost::system::error_code error;
     return socket_.remote_endpoint(error).address().to_string();
 }
@@ -405,66 +838,312 @@ std::string connection::summary() const
 inline
 bool connection::connect_socket(std::string hostname, int port)
 {
+    boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+    bool connected = false;
     try
     {
-        // resolve hostname into a tcp end point
-        boost::asio::ip::tcp::resolver resolver(socket_.get_io_service());
+        // resolve hostname into tcp end points
+        boost::asio::ip::tcp::resolver resolver(io_service_);
         boost::asio::ip::tcp::resolver::query query(hostname, boost::lexical_cast<std::string>(port));
         boost::asio::ip::tcp::resolver::iterator endpoint_iterator = resolver.resolve(query);
         boost::asio::ip::tcp::resolver::iterator end;
+        std::vector<boost::asio::ip::tcp::endpoint> endpoints(endpoint_iterator, end);
     
-        // create and connect a socket
-        boost::system::error_code error = boost::asio::error::host_not_found;
-        while (error && endpoint_iterator != end)
+        // race a socket to every end point and keep the first to connect,
+        // so an unreachable address does not hold up the others
+        close_socket();
+        deadline_state state((int)endpoints.size());
+        std::vector<socket_ptr> sockets;
+        for (int i=0; i<(int)endpoints.size(); ++i)
         {
-            socket_.close();
-            socket_.connect(*endpoint_iterator++, error);
+            sockets.push_back(socket_ptr(new boost::asio::ip::tcp::socket(io_service_)));
+            sockets[i]->async_connect(endpoints[i], boost::bind(&connection::handle_race, &state, i, boost::asio::placeholders::error));
         }
+        run_to_deadline(state, deadlines_.connect_ms_, boost::bind(&connection::close_losers, &sockets, &state));
+        if (state.winner_ < 0 && state.expired_) { ++statistics_.connect_timeouts_; }
         
-        if (error) { socket_.close(); }
-        return !error;
+        if (state.winner_ >= 0)
+        {
+            #ifdef BOOST_ASIO_HAS_MOVE
+            boost::mutex::scoped_lock lock(socket_mutex_);
+            socket_ = std::move(*sockets[state.winner_]);
+            #else
+            // sockets cannot be moved, so connect again to the address that answered first
+            boost::system::error_code error;
+            {
+                boost::mutex::scoped_lock lock(socket_mutex_);
+                socket_.open(endpoints[state.winner_].protocol(), error);
+            }
+            if (!error) { socket_.connect(endpoints[state.winner_], error); }
+            if (error) { close_socket(); }
+            #endif
+        }
+        connected = socket_.is_open();
+        
+        // commands are small and each waits on a reply, so don't let nagle hold them back
+        boost::system::error_code ignored;
+        if (connected) { socket_.set_option(boost::asio::ip::tcp::no_delay(true), ignored); }
+    }
+    catch (...) { connected = false; }
+    
+    if (connected)
+    {
+        boost::posix_time::time_duration elapsed = boost::posix_time::microsec_clock::universal_time() - start;
+        statistics_.last_connect_ms_ = elapsed.total_microseconds() / 1000.0;
+        statistics_.total_connect_ms_ += statistics_.last_connect_ms_;
+        ++statistics_.connects_;
+    }
+    else
+    {
+        ++statistics_.connect_failures_;
     }
-    catch (...) { return false; }
+    return connected;
 }
 
-template<typename T>
 inline
-bool connection::write_fixed(const T& val)
+bool connection::connect_local(std::string path)
 {
-    // write a primitive or fixed-sized object
+    close_socket();
+    #ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
     boost::system::error_code error;
-    boost::asio::write(socket_, boost::asio::buffer(&val,sizeof(T)), boost::asio::transfer_all(), error);
+    {
+        boost::mutex::scoped_lock lock(socket_mutex_);
+        local_socket_.reset(new boost::asio::local::stream_protocol::socket(io_service_));
+        local_socket_->open(boost::asio::local::stream_protocol(), error);
+    }
+    if (!error) { local_socket_->connect(boost::asio::local::stream_protocol::endpoint(path), error); }
+    if (error) { close_socket(); }
+    if (!error) { ++statistics_.connects_; return true; }
+    #endif
+    ++statistics_.connect_failures_;
+    return false;
+}
+
+inline
+bool connection::is_local() const
+{
+    #ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+    return local_socket_ && local_socket_->is_open();
+    #else
+    return false;
+    #endif
+}
+
+inline
+void connection::close_socket()
+{
+    discard_sample();
+    boost::mutex::scoped_lock lock(socket_mutex_);
+    boost::system::error_code ignored;
+    socket_.close(ignored);
+    #ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+    if (local_socket_) { local_socket_->close(ignored); }
+    #endif
+}
+
+inline
+void connection::run_to_deadline(deadline_state& state, int deadline_ms, boost::function<void ()> cancel)
+{
+    boost::asio::deadline_timer timer(io_service_);
+    if (deadline_ms > 0)
+    {
+        timer.expires_from_now(boost::posix_time::milliseconds(deadline_ms));
+        timer.async_wait(boost::bind(&connection::handle_timer, &state, boost::asio::placeholders::error));
+        state.timer_pending_ = true;
+    }
+    
+    // every handler must run before state goes out of scope, so once the caller
+    // has its result or the deadline passes, whatever is left is cancelled and run down
+    bool cancelled = false;
+    io_service_.reset();
+    while (state.operations_ > 0 || state.timer_pending_)
+    {
+        if (!cancelled && (state.finished_ || state.expired_ || state.cancelled_))
+        {
+            cancelled = true;
+            boost::system::error_code ignored;
+            timer.cancel(ignored);
+            if (state.operations_ > 0) { cancel(); }
+        }
+        if (io_service_.run_one() == 0)
+        {
+            // stopped by cancel()
+            io_service_.reset();
+            state.cancelled_ = true;
+        }
+    }
+}
+
+inline
+void connection::cancel()
+{
+    // a blocking read or write fails once the socket is shut down,
+    // a wait on a deadline once the io_service stops
+    // the lock keeps the socket from being closed or replaced meanwhile,
+    // so a shutdown never reaches a descriptor that has since been reused
+    {
+        boost::mutex::scoped_lock lock(socket_mutex_);
+        boost::system::error_code ignored;
+        socket_.shutdown(boost::asio::ip::tcp::socket::shutdown_both, ignored);
+        #ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+        if (local_socket_) { local_socket_->shutdown(boost::asio::local::stream_protocol::socket::shutdown_both, ignored); }
+        #endif
+    }
+    io_service_.stop();
+}
+
+inline
+void connection::handle_timer(deadline_state* state, const boost::system::error_code& error)
+{
+    state->timer_pending_ = false;
+    if (!error) { state->expired_ = true; }
+}
+
+inline
+void connection::handle_transfer(deadline_state* state, const boost::system::error_code& error)
+{
+    --state->operations_;
+    state->error_ = error;
+    state->finished_ = true;
+}
+
+inline
+void connection::handle_race(deadline_state* state, int i, const boost::system::error_code& error)
+{
+    --state->operations_;
+    if (!error && state->winner_ < 0) { state->winner_ = i; state->finished_ = true; }
+    if (error && state->winner_ < 0) { state->error_ = error; }
+    if (state->operations_ == 0) { state->finished_ = true; }
+}
+
+inline
+void connection::close_losers(std::vector<socket_ptr>* sockets, const deadline_state* state)
+{
+    for (int i=0; i<(int)sockets->size(); ++i)
+    {
+        boost::system::error_code ignored;
+        if (i != state->winner_) { (*sockets)[i]->close(ignored); }
+    }
+}
+
+template<typename ConstBufferSequence>
+inline
+bool connection::write_buffers(const ConstBufferSequence& buffers)
+{
+    boost::posix_time::ptime start;
+    if (sample_.cmd_ != 0) { start = now(); }
+    bool success;
+    #ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+    if (is_local()) { success = write_stream(*local_socket_, buffers); } else
+    #endif
+    { success = write_stream(socket_, buffers); }
+    if (success && capture_) { capture_->append(capture_kinds::sent, buffers); }
+    if (success && sample_.cmd_ != 0)
+    {
+        sample_.written_ = now();
+        sample_.write_us_ += elapsed_us(start, sample_.written_);
+        sample_.bytes_out_ += boost::asio::buffer_size(buffers);
+        sample_.awaiting_response_ = true;
+    }
+    return success;
+}
+
+template<typename MutableBufferSequence>
+inline
+bool connection::read_buffers(const MutableBufferSequence& buffers)
+{
+    bool success;
+    #ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+    if (is_local()) { success = read_stream(*local_socket_, buffers); } else
+    #endif
+    { success = read_stream(socket_, buffers); }
+    if (success && capture_) { capture_->append(capture_kinds::received, buffers); }
+    if (success && sample_.cmd_ != 0)
+    {
+        // the first read after the write returns once the response has started to arrive
+        if (sample_.awaiting_response_) { sample_.first_byte_us_ = elapsed_us(sample_.written_, now()); }
+        sample_.awaiting_response_ = false;
+        sample_.bytes_in_ += boost::asio::buffer_size(buffers);
+    }
+    return success;
+}
+
+template<typename Stream, typename ConstBufferSequence>
+inline
+bool connection::write_stream(Stream& stream, const ConstBufferSequence& buffers)
+{
+    boost::system::error_code error;
+    if (deadlines_.write_ms_ <= 0)
+    {
+        boost::asio::write(stream, buffers, boost::asio::transfer_all(), error);
+    }
+    else
+    {
+        deadline_state state(1);
+        boost::asio::async_write(stream, buffers, boost::asio::transfer_all(),
+            boost::bind(&connection::handle_transfer, &state, boost::asio::placeholders::error));
+        run_to_deadline(state, deadlines_.write_ms_, boost::bind(&connection::close_socket, this));
+        error = state.error_;
+        if (error && state.expired_) { ++statistics_.write_timeouts_; }
+    }
+    if (error) { disconnect(); }
+    return !error;
+}
+
+template<typename Stream, typename MutableBufferSequence>
+inline
+bool connection::read_stream(Stream& stream, const MutableBufferSequence& buffers)
+{
+    boost::system::error_code error;
+    if (deadlines_.read_ms_ <= 0)
+    {
+        boost::asio::read(stream, buffers, boost::asio::transfer_all(), error);
+    }
+    else
+    {
+        deadline_state state(1);
+        boost::asio::async_read(stream, buffers, boost::asio::transfer_all(),
+            boost::bind(&connection::handle_transfer, &state, boost::asio::placeholders::error));
+        run_to_deadline(state, deadlines_.read_ms_, boost::bind(&connection::close_socket, this));
+        error = state.error_;
+        if (error && state.expired_) { ++statistics_.read_timeouts_; }
+    }
     if (error) { disconnect(); }
     return !error;
 }
 
+template<typename T>
+inline
+bool connection::write_fixed(const T& val)
+{
+    // write a primitive or fixed-sized object
+    return write_buffers(boost::asio::buffer(&val,sizeof(T)));
+}
+
 template<typename T> 
 inline
 bool connection::write_command_fixed(int cmd, const T& val)
 {
+    begin_sample(cmd);
     // write a packet: a size/data pair
-    boost::system::error_code error;
     boost::array<boost::asio::const_buffer, 2> packet = {{ boost::asio::buffer(&cmd,sizeof(int)), boost::asio::buffer(&val,sizeof(T)) }};
-    boost::asio::write(socket_, packet, boost::asio::transfer_all(), error);
-    if (error) { disconnect(); }
-    return !error;
+    return write_buffers(packet);
 }
 
 inline
 bool connection::write_command(int cmd)
 {
+    begin_sample(cmd);
     return write_fixed(cmd);
 }
 
 inline
 bool connection::write_command_packet(int cmd, const void* buf, int num_bytes)
 {
+    begin_sample(cmd);
     // write a packet: a size/data pair
-    boost::system::error_code error;
     boost::array<boost::asio::const_buffer, 3> packet = {{ boost::asio::buffer(&cmd,sizeof(int)), boost::asio::buffer(&num_bytes,sizeof(int)), boost::asio::buffer(buf,num_bytes) }};
-    boost::asio::write(socket_, packet, boost::asio::transfer_all(), error);
-    if (error) { disconnect(); }
-    return !error;
+    return write_buffers(packet);
 }
 
 inline
@@ -474,31 +1153,83 @@ bool connection::write_command_packet(int cmd, const std::string& s)
     return write_command_packet(cmd, s.c_str(), s.length());
 }
 
+template<typename T>
 inline
-bool connection::read_packet(std::vector<char>& buf)
+bool connection::stream_command_packet(int cmd, const T& val, const char* name)
+{
+    // size the packet with a counting pass, since the size is sent first
+    boost::posix_time::ptime start;
+    if (instrumented_) { start = now(); }
+    std::streamsize size = encoded_size(encoding_, val, name);
+    if (instrumented_) { pending_serialize_us_ = elapsed_us(start, now()); }
+    if (size > std::numeric_limits<int>::max()) { return false; }
+    int num_bytes = (int)size;
+    begin_sample(cmd);
+    
+    // the command-code and size are buffered and go out with the first chunk of the packet
+    buffer_writer writer(*this);
+    socket_streambuf<buffer_writer> buf(writer);
+    buf.sputn((const char*)&cmd, sizeof(int));
+    buf.sputn((const char*)&num_bytes, sizeof(int));
+    std::ostream os(&buf);
+    try
+    {
+        encode_stream(encoding_, val, name, os);
+    }
+    catch (const boost::archive::archive_exception&)
+    {
+        // the archive gives up once a write to the socket has failed
+        disconnect();
+        return false;
+    }
+    bool success = buf.flush() && buf.written() == num_bytes + 2*(std::streamsize)sizeof(int);
+    if (!success) { disconnect(); }
+    return success;
+}
+
+inline
+bool connection::read_packet()
 {
     // read size of packet
     int num_bytes = 0;
-    boost::system::error_code error_header;
-    boost::asio::read(socket_, boost::asio::buffer(&num_bytes,sizeof(int)), boost::asio::transfer_all(), error_header);
-    if (error_header) { disconnect(); }
-    if (error_header || num_bytes < 0) { return false; }
+    received_bytes_ = 0;
+    if (!read_buffers(boost::asio::buffer(&num_bytes,sizeof(int)))) { return false; }
+    if (num_bytes < 0) { return false; }
     
-    // read data
-    buf.resize(num_bytes);
-    boost::system::error_code error_data;
-    if (num_bytes > 0) { boost::asio::read(socket_, boost::asio::buffer(&buf[0],num_bytes), boost::asio::transfer_all(), error_data); }
-    if (error_data) { disconnect(); }
-    return !error_header && !error_data;
+    // read data into the receive buffer, growing it only for the largest packet yet
+    if ((int)receive_buffer_.size() < num_bytes) { receive_buffer_.resize(num_bytes); }
+    if (num_bytes > 0 && !read_buffers(boost::asio::buffer(&receive_buffer_[0],num_bytes))) { return false; }
+    received_bytes_ = num_bytes;
+    return true;
+}
+
+template<typename T>
+inline
+void connection::decode_received(const char* name, T& val)
+{
+    const char* data = receive_buffer_.empty() ? "" : &receive_buffer_[0];
+    if (sample_.cmd_ == 0) { decode_packet(data, received_bytes_, name, val); return; }
+    boost::posix_time::ptime start = now();
+    decode_packet(data, received_bytes_, name, val);
+    sample_.decode_us_ = elapsed_us(start, now());
+    end_sample();
+}
+
+inline
+bool connection::read_packet(std::vector<char>& buf)
+{
+    // copies out of the receive buffer
+    if (!read_packet()) { return false; }
+    buf.assign(receive_buffer_.begin(), receive_buffer_.begin() + received_bytes_);
+    return true;
 }
 
 inline
 bool connection::read_packet(std::string& s)
 {
-    // wraps the std::vector<char> version
-    std::vector<char> buf;
-    if (!read_packet(buf)) { return false; }
-    s.assign(&buf[0], buf.size());
+    // copies out of the receive buffer, reusing the string's capacity
+    if (!read_packet()) { return false; }
+    s.assign(receive_buffer_.empty() ? "" : &receive_buffer_[0], received_bytes_);
     return true;
 }
 
@@ -507,10 +1238,7 @@ inline
 bool connection::read_fixed(T& val)
 {
     // read a primitive or fixed-sized object
-    boost::system::error_code error;
-    boost::asio::read(socket_, boost::asio::buffer(&val,sizeof(T)), boost::asio::transfer_all(), error);
-    if (error) { disconnect(); }
-    return !error;
+    return read_buffers(boost::asio::buffer(&val,sizeof(T)));
 }
 
 inline
@@ -518,9 +1246,116 @@ bool connection::read_response()
 {
     if (!read_fixed(last_result_.value_)) { return false; }
     if (!read_packet(last_result_.message_)) { return false; }
+    end_sample();
     return true;
 }
 
+template<typename T>
+inline
+void connection::encode_request(const T& val, const char* name, std::string& packet)
+{
+    if (!instrumented_) { encode_packet(encoding_, val, name, packet); return; }
+    boost::posix_time::ptime start = now();
+    encode_packet(encoding_, val, name, packet);
+    pending_serialize_us_ = elapsed_us(start, now());
+}
+
+inline
+void connection::begin_sample(int cmd)
+{
+    if (!instrumented_) { return; }
+    sample_ = command_sample();
+    sample_.cmd_ = cmd;
+    sample_.serialize_us_ = pending_serialize_us_;
+    pending_serialize_us_ = 0;
+}
+
+inline
+void connection::end_sample()
+{
+    if (sample_.cmd_ == 0) { return; }
+    command_statistics& stats = statistics_.commands_[sample_.cmd_];
+    if (commands::has_packet(sample_.cmd_)) { stats.serialize_us_.add(sample_.serialize_us_); }
+    stats.write_us_.add(sample_.write_us_);
+    stats.first_byte_us_.add(sample_.first_byte_us_);
+    if (commands::returns_packet(sample_.cmd_)) { stats.decode_us_.add(sample_.decode_us_); }
+    stats.bytes_out_.add((double)sample_.bytes_out_);
+    stats.bytes_in_.add((double)sample_.bytes_in_);
+    sample_.cmd_ = 0;
+}
+
+inline
+void log2_histogram::add(double value)
+{
+    int exponent = 0;
+    if (value >= 1) { std::frexp(value, &exponent); }
+    ++counts_[std::min(exponent, buckets-1)];
+    ++count_;
+    sum_ += value;
+    if (value > max_) { max_ = value; }
+}
+
+inline
+void log2_histogram::add(const log2_histogram& other)
+{
+    for (int i=0; i<buckets; ++i) { counts_[i] += other.counts_[i]; }
+    count_ += other.count_;
+    sum_ += other.sum_;
+    if (other.max_ > max_) { max_ = other.max_; }
+}
+
+inline
+double log2_histogram::percentile(double p) const
+{
+    if (count_ == 0) { return 0.0; }
+    double rank = std::max(1.0, std::ceil(p * count_));
+    double seen = 0;
+    for (int i=0; i<buckets; ++i)
+    {
+        seen += counts_[i];
+        if (seen >= rank) { return std::min(std::ldexp(1.0, i), max_); }
+    }
+    return max_;
+}
+
+inline
+void command_statistics::add(const command_statistics& other)
+{
+    serialize_us_.add(other.serialize_us_);
+    write_us_.add(other.write_us_);
+    first_byte_us_.add(other.first_byte_us_);
+    decode_us_.add(other.decode_us_);
+    bytes_out_.add(other.bytes_out_);
+    bytes_in_.add(other.bytes_in_);
+}
+
+inline
+void connection_statistics::add(const connection_statistics& other)
+{
+    connects_ += other.connects_;
+    connect_failures_ += other.connect_failures_;
+    if (other.connects_ > 0) { last_connect_ms_ = other.last_connect_ms_; }
+    total_connect_ms_ += other.total_connect_ms_;
+    connect_timeouts_ += other.connect_timeouts_;
+    write_timeouts_ += other.write_timeouts_;
+    read_timeouts_ += other.read_timeouts_;
+    std::map<int, command_statistics>::const_iterator i;
+    for (i = other.commands_.begin(); i != other.commands_.end(); ++i) { commands_[i->first].add(i->second); }
+}
+
+#ifdef EUREQA_SEPARATE_COMPILATION
+// the archive code for the types sent and received is compiled once, into libeureqa_client
+extern template void encode_stream(int, const eureqa::data_set&, const char*, std::ostream&);
+extern template void encode_stream(int, const eureqa::search_options&, const char*, std::ostream&);
+extern template void encode_stream(int, const std::vector<eureqa::solution_info>&, const char*, std::ostream&);
+extern template void decode_archive(const char*, std::size_t, const char*, eureqa::search_progress&);
+extern template void decode_archive(const char*, std::size_t, const char*, eureqa::server_info&);
+extern template void decode_archive(const char*, std::size_t, const char*, eureqa::solution_frontier&);
+extern template void decode_archive(const char*, std::size_t, const char*, eureqa::solution_arena_frontier&);
+extern template void decode_archive(const char*, std::size_t, const char*, eureqa::solution_arena&);
+extern template void decode_archive(const char*, std::size_t, const char*, std::vector<eureqa::solution_info>&);
+#endif
+
 } // namespace eureqa
 
 #endif //EUREQA_CONNECTION_H
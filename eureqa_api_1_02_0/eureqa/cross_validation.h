@@ -0,0 +1,324 @@
+#ifndef EUREQA_CROSS_VALIDATION_H
+#define EUREQA_CROSS_VALIDATION_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <boost/bind.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/random/mersenne_twister.hpp>
+#include <eureqa/connection.h>
+#include <eureqa/sweep.h>
+
+namespace eureqa
+{
+struct cross_validation_options
+{
+    int folds_;
+    unsigned int seed_; // for the order rows or series are dealt into the folds
+    sweep_options search_; // how long each fold's search runs
+
+    cross_validation_options() : folds_(5), seed_(1) { }
+};
+
+// one of the k searches
+struct cross_validation_fold
+{
+    std::vector<int> rows_; // of the data set, held out of this fold's search
+    bool searched_; // its search ran to its limit
+    bool validated_; // its frontier was scored on the held out rows
+    int server_; // that ran its search, -1 if none
+    eureqa::solution_frontier frontier_; // found on the training rows
+    std::vector<eureqa::solution_info> validated_solutions_; // the frontier's, scored on the held out rows
+
+    cross_validation_fold() : searched_(false), validated_(false), server_(-1) { }
+};
+
+// a formula with its fitness on the rows held out of the search that found it,
+// averaged over the folds that found it
+struct validated_solution
+{
+    eureqa::solution_info solution_; // fitness_ and score_ on the held out rows
+    float training_fitness_; // as the search reported it, the best of the folds
+    int folds_; // that found it
+
+    validated_solution() : training_fitness_(-1e30f), folds_(0) { }
+};
+
+// k-fold cross-validation of a search
+//
+// splits the data set into k folds, keeping every row of a series (r_) in
+// the same fold, runs the k searches on the other folds' rows concurrently
+// across the servers as a sweep, then has calc_solution_info score each
+// search's frontier on the fold it held out; the formulas are ranked by
+// that validation fitness, so ones that only fit the training rows sink
+//
+//   eureqa::cross_validation cv;
+//   cv.run(data, options, hostnames);
+//   cv.ranked()[0].solution_ ...
+class cross_validation
+{
+protected:
+    cross_validation_options options_;
+    std::vector<cross_validation_fold> folds_;
+    std::vector<validated_solution> ranked_;
+    eureqa::solution_frontier frontier_;
+    eureqa::sweep searches_;
+    std::vector<boost::shared_ptr<eureqa::connection> > validators_;
+    boost::mutex mutex_; // guards validators_ and cancelled_
+    bool cancelled_;
+
+public:
+    cross_validation(cross_validation_options options = cross_validation_options());
+    const cross_validation_options& options() const { return options_; }
+    void set_options(const cross_validation_options& options) { options_ = options; }
+
+    // searches and validates every fold, the servers may end in :port;
+    // true if every fold was validated
+    bool run(const eureqa::data_set& data, const eureqa::search_options& options, const std::vector<std::string>& hostnames, int port = default_port_tcp);
+
+    // makes run() on another thread return false promptly
+    void cancel();
+
+    // results, best validation fitness first
+    int folds() const { return (int)folds_.size(); }
+    const cross_validation_fold& fold(int i) const { return folds_[i]; }
+    const std::vector<validated_solution>& ranked() const { return ranked_; }
+
+    // the ranked formulas that no simpler one validates better
+    const eureqa::solution_frontier& frontier() const { return frontier_; }
+
+    // the rows of each of k folds, whole series together when the data set has them
+    static std::vector<std::vector<int> > split(const eureqa::data_set& data, int k, unsigned int seed = 1);
+
+    // a data set of the given rows
+    static eureqa::data_set select_rows(const eureqa::data_set& data, const std::vector<int>& rows);
+
+protected:
+    void validate(int server, std::string hostname, int port, const eureqa::data_set* data, const eureqa::search_options* options);
+    void combine();
+    static bool by_validation(const validated_solution& a, const validated_solution& b) { return a.solution_.fitness_ > b.solution_.fitness_; }
+};
+
+/*---------------------------------------------------------------------------
+    implementions:
+*--------------------------------------------------------------------------*/
+inline
+cross_validation::cross_validation(cross_validation_options options) :
+    options_(options),
+    cancelled_(false)
+{ }
+
+inline
+bool cross_validation::run(const eureqa::data_set& data, const eureqa::search_options& options, const std::vector<std::string>& hostnames, int port)
+{
+    {
+        boost::mutex::scoped_lock lock(mutex_);
+        cancelled_ = false;
+    }
+    folds_.clear();
+    ranked_.clear();
+    frontier_.clear();
+
+    // each fold's search runs on the rows of all the others
+    std::vector<std::vector<int> > rows = split(data, options_.folds_, options_.seed_);
+    searches_.clear();
+    searches_.set_options(options_.search_);
+    std::vector<char> held(data.size(), 0);
+    for (int f=0; f<(int)rows.size(); ++f)
+    {
+        cross_validation_fold fold;
+        fold.rows_ = rows[f];
+        folds_.push_back(fold);
+        std::fill(held.begin(), held.end(), 0);
+        for (int i=0; i<(int)rows[f].size(); ++i) { held[rows[f][i]] = 1; }
+        std::vector<int> training;
+        for (int i=0; i<data.size(); ++i) { if (!held[i]) { training.push_back(i); } }
+        searches_.add_data_set(select_rows(data, training));
+    }
+    if (folds_.empty()) { return false; }
+    searches_.add_relationship(options.search_relationship_);
+    searches_.add_options(options);
+    searches_.run(hostnames, port);
+
+    for (int f=0; f<(int)folds_.size(); ++f)
+    {
+        const sweep_result& result = searches_.result(f, 0, 0);
+        folds_[f].searched_ = result.done_;
+        folds_[f].server_ = result.done_ ? result.server_ : -1;
+        folds_[f].frontier_ = result.frontier_;
+    }
+
+    // each server that ran searches scores their frontiers, all the servers at once
+    {
+        boost::mutex::scoped_lock lock(mutex_);
+        if (cancelled_) { return false; }
+        validators_.clear();
+        for (int i=0; i<(int)hostnames.size(); ++i) { validators_.push_back(boost::shared_ptr<eureqa::connection>(new eureqa::connection())); }
+    }
+    boost::thread_group threads;
+    for (int s=0; s<(int)hostnames.size(); ++s)
+    {
+        std::string hostname;
+        int host_port = port;
+        eureqa::connection::parse_address(hostnames[s], hostname, host_port);
+        threads.create_thread(boost::bind(&cross_validation::validate, this, s, hostname, host_port, &data, &options));
+    }
+    threads.join_all();
+    {
+        boost::mutex::scoped_lock lock(mutex_);
+        validators_.clear();
+    }
+
+    combine();
+    bool all = true;
+    for (int f=0; f<(int)folds_.size(); ++f) { all = all && folds_[f].validated_; }
+    return all;
+}
+
+inline
+void cross_validation::cancel()
+{
+    boost::mutex::scoped_lock lock(mutex_);
+    cancelled_ = true;
+    searches_.cancel();
+    for (int i=0; i<(int)validators_.size(); ++i) { validators_[i]->cancel(); }
+}
+
+inline
+std::vector<std::vector<int> > cross_validation::split(const eureqa::data_set& data, int k, unsigned int seed)
+{
+    // rows go in groups, a series each or else one row each
+    std::vector<std::vector<int> > groups;
+    if ((int)data.r_.size() == data.size() && data.size() > 0)
+    {
+        std::map<int, int> series;
+        for (int i=0; i<data.size(); ++i)
+        {
+            std::map<int, int>::iterator it = series.find(data.r_[i]);
+            if (it == series.end()) { it = series.insert(std::make_pair(data.r_[i], (int)groups.size())).first; groups.push_back(std::vector<int>()); }
+            groups[it->second].push_back(i);
+        }
+    }
+    else
+    {
+        for (int i=0; i<data.size(); ++i) { groups.push_back(std::vector<int>(1, i)); }
+    }
+
+    // dealt out in a random order, each series to the fold with the fewest rows so far
+    boost::mt19937 rng(seed);
+    for (int i=(int)groups.size()-1; i>0; --i) { std::swap(groups[i], groups[rng() % (unsigned int)(i + 1)]); }
+    std::vector<std::vector<int> > folds(std::max(1, k));
+    for (int g=0; g<(int)groups.size(); ++g)
+    {
+        int fewest = 0;
+        for (int f=1; f<(int)folds.size(); ++f) { if (folds[f].size() < folds[fewest].size()) { fewest = f; } }
+        folds[fewest].insert(folds[fewest].end(), groups[g].begin(), groups[g].end());
+    }
+
+    // too few series leave some folds empty
+    std::vector<std::vector<int> > used;
+    for (int f=0; f<(int)folds.size(); ++f)
+    {
+        if (folds[f].empty()) { continue; }
+        std::sort(folds[f].begin(), folds[f].end());
+        used.push_back(folds[f]);
+    }
+    return used;
+}
+
+inline
+eureqa::data_set cross_validation::select_rows(const eureqa::data_set& data, const std::vector<int>& rows)
+{
+    eureqa::data_set subset((int)rows.size(), data.num_vars());
+    subset.X_symbols_ = data.X_symbols_;
+    subset.Y_symbols_ = data.Y_symbols_;
+    if (data.special_vars() > 0) { subset.Y_.resize(rows.size(), data.special_vars()); }
+    for (int i=0; i<(int)rows.size(); ++i)
+    {
+        int r = rows[i];
+        for (int j=0; j<data.num_vars(); ++j) { subset.X_(i, j) = data.X_(r, j); }
+        for (int j=0; j<data.special_vars(); ++j) { subset.Y_(i, j) = data.Y_(r, j); }
+        if (!data.r_.empty()) { subset.r_.push_back(data.r_[r]); }
+        if (!data.t_.empty()) { subset.t_.push_back(data.t_[r]); }
+        if (!data.w_.empty()) { subset.w_.push_back(data.w_[r]); }
+    }
+    return subset;
+}
+
+inline
+void cross_validation::validate(int server, std::string hostname, int port, const eureqa::data_set* data, const eureqa::search_options* options)
+{
+    boost::shared_ptr<eureqa::connection> conn;
+    {
+        boost::mutex::scoped_lock lock(mutex_);
+        if (cancelled_ || server >= (int)validators_.size()) { return; }
+        conn = validators_[server];
+    }
+    for (int f=0; f<(int)folds_.size(); ++f)
+    {
+        cross_validation_fold& fold = folds_[f];
+        if (fold.server_ != server || fold.frontier_.size() == 0) { continue; }
+
+        // the held out rows replace the training rows on the server, which scores the frontier on them
+        std::vector<eureqa::solution_info> solutions;
+        for (int i=0; i<fold.frontier_.size(); ++i) { solutions.push_back(fold.frontier_[i]); }
+        bool ok = false;
+        try
+        {
+            ok = (conn->is_connected() || conn->connect(hostname, port))
+                && conn->send_data_set(select_rows(*data, fold.rows_)) && conn->last_result().value() == 0
+                && conn->send_options(*options) && conn->last_result().value() == 0
+                && conn->calc_solution_info(solutions) && solutions.size() == (std::size_t)fold.frontier_.size();
+        }
+        catch (const std::exception&) { ok = false; }
+        if (!ok) { conn->disconnect(); continue; }
+        fold.validated_solutions_ = solutions;
+        fold.validated_ = true;
+    }
+    conn->disconnect();
+}
+
+inline
+void cross_validation::combine()
+{
+    // a formula found by several folds gets its mean validation fitness
+    std::map<std::string, int> index;
+    for (int f=0; f<(int)folds_.size(); ++f)
+    {
+        const cross_validation_fold& fold = folds_[f];
+        if (!fold.validated_) { continue; }
+        for (int i=0; i<(int)fold.validated_solutions_.size(); ++i)
+        {
+            const eureqa::solution_info& scored = fold.validated_solutions_[i];
+            std::map<std::string, int>::iterator it = index.find(scored.text_);
+            if (it == index.end())
+            {
+                it = index.insert(std::make_pair(scored.text_, (int)ranked_.size())).first;
+                ranked_.push_back(validated_solution());
+                ranked_.back().solution_ = scored;
+                ranked_.back().solution_.fitness_ = 0;
+                ranked_.back().solution_.score_ = 0;
+            }
+            validated_solution& v = ranked_[it->second];
+            v.solution_.fitness_ += scored.fitness_;
+            v.solution_.score_ += scored.score_;
+            v.training_fitness_ = std::max(v.training_fitness_, fold.frontier_[i].fitness_);
+            ++v.folds_;
+        }
+    }
+    for (int i=0; i<(int)ranked_.size(); ++i)
+    {
+        ranked_[i].solution_.fitness_ /= ranked_[i].folds_;
+        ranked_[i].solution_.score_ /= ranked_[i].folds_;
+        frontier_.add(ranked_[i].solution_);
+    }
+    std::stable_sort(ranked_.begin(), ranked_.end(), by_validation);
+}
+
+} // namespace eureqa
+
+#endif // EUREQA_CROSS_VALIDATION_H
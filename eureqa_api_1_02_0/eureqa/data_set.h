@@ -2,6 +2,8 @@
 #define EUREQA_DATA_SET_H
 
 #include <string>
+#include <vector>
+#include <cstdio>
 #include <fstream>
 #include <boost/format.hpp>
 #include <boost/lexical_cast.hpp>
@@ -61,8 +63,9 @@ public:
     bool import_ascii(std::string path, std::string& error_msg);
     bool import_ascii(std::istream& is);
     bool import_ascii(std::istream& is, std::string& error_msg);
-    void export_ascii(std::string path) { std::ofstream file(path.c_str()); export_ascii(file); }
-    void export_ascii(std::ostream& os);
+    // exports in the eureqa format import_ascii reads, with enough digits to read back the same values
+    bool export_ascii(std::string path) const;
+    void export_ascii(std::ostream& os) const;
     
     // returns a short text summary of the data set
     std::string summary() const;
@@ -277,7 +280,21 @@ bool data_set::import_ascii(std::istream& is, std::string& error_msg)
 }
 
 inline
-void data_set::export_ascii(std::ostream& os)
+bool data_set::export_ascii(std::string path) const
+{
+    // a large buffer, so the rows go out in few system calls
+    std::vector<char> buffer(1 << 20);
+    std::ofstream file;
+    file.rdbuf()->pubsetbuf(&buffer[0], buffer.size());
+    file.open(path.c_str(), std::ios_base::out|std::ios_base::trunc);
+    if (!file.is_open()) { return false; }
+    export_ascii(file);
+    file.close();
+    return !file.fail();
+}
+
+inline
+void data_set::export_ascii(std::ostream& os) const
 {
     // header symbols
     os << "% ";
@@ -288,18 +305,24 @@ void data_set::export_ascii(std::ostream& os)
     for (int j=0; j<(int)X_.size2(); ++j) { os << X_symbols_[j] << '\t'; }
     os << "| ";
     for (int j=0; j<(int)Y_.size2(); ++j) { os << Y_symbols_[j] << '\t'; }
-    os << std::endl;
+    os << '\n';
     
-    // data rows
+    // data rows, each formatted into one string and written at once
+    // 9 significant digits are enough for a float to read back unchanged
+    std::string line;
+    char value[32];
     for (int i=0; i<size(); ++i)
     {
-        if (r_.size() > 0) { os << r_[i] << '\t'; }
-        if (t_.size() > 0) { os << t_[i] << '\t'; }
-        if (w_.size() > 0) { os << w_[i] << '\t'; }
-        for (int j=0; j<(int)X_.size2(); ++j) { os << X_(i,j) << '\t'; }
-        for (int j=0; j<(int)Y_.size2(); ++j) { os << Y_(i,j) << '\t'; }
-        os << std::endl;
+        line.clear();
+        if (r_.size() > 0) { std::sprintf(value, "%d\t", r_[i]); line += value; }
+        if (t_.size() > 0) { std::sprintf(value, "%.9g\t", t_[i]); line += value; }
+        if (w_.size() > 0) { std::sprintf(value, "%.9g\t", w_[i]); line += value; }
+        for (int j=0; j<(int)X_.size2(); ++j) { std::sprintf(value, "%.9g\t", X_(i,j)); line += value; }
+        for (int j=0; j<(int)Y_.size2(); ++j) { std::sprintf(value, "%.9g\t", Y_(i,j)); line += value; }
+        line += '\n';
+        os.write(line.data(), line.size());
     }
+    os.flush();
 }
 
 inline
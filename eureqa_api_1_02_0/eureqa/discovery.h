@@ -0,0 +1,275 @@
+#ifndef EUREQA_DISCOVERY_H
+#define EUREQA_DISCOVERY_H
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <boost/array.hpp>
+#include <boost/bind.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <eureqa/async_connection.h>
+
+namespace eureqa
+{
+// multicast group servers are looked for on, organization-local scope
+static const char* const default_multicast_group = "239.192.0.2";
+
+// a eureqa server that answered discovery
+struct discovered_server
+{
+    std::string address_; // address it was reached at
+    int port_;
+    server_info info_;
+    search_progress progress_;
+    bool has_progress_; // progress_ was received
+    double response_ms_; // time from the start of discovery to its server_info arriving
+
+    discovered_server() : port_(default_port_tcp), has_progress_(false), response_ms_(0) { }
+
+    // tests if the server is already running a search
+    bool is_searching() const { return has_progress_ && (progress_.generations_per_sec_ > 0 || progress_.evaluations_per_sec_ > 0); }
+};
+
+// predicate for ranking servers, idle before searching, then most cores,
+// newest version and quickest to answer
+struct by_available_capacity
+{
+    bool operator ()(const discovered_server& a, const discovered_server& b) const;
+};
+
+// finds eureqa servers on the local network within a bounded time window
+//
+// listens on the multicast group and sends a probe to it; every host heard from,
+// and any added explicitly, is queried for its server_info and search progress
+// concurrently, and only hosts that answer before the window closes are reported
+//
+// the servers' multicast announcements are not documented, so any datagram other
+// than a probe marks its sender as a candidate
+class server_discovery
+{
+protected:
+    struct candidate
+    {
+        discovered_server server_;
+        async_connection conn_;
+        bool done_; // every query has finished, successfully or not
+        bool answered_;
+        candidate(boost::asio::io_service& io_service) : conn_(io_service), done_(false), answered_(false) { }
+    };
+    typedef boost::shared_ptr<candidate> candidate_ptr;
+
+    boost::asio::io_service io_service_;
+    boost::asio::ip::udp::socket udp_socket_;
+    boost::asio::ip::udp::endpoint sender_;
+    boost::array<char, 1024> datagram_;
+    boost::asio::deadline_timer timer_;
+    std::string group_;
+    int group_port_;
+    int server_port_;
+    int window_ms_;
+    std::vector<std::pair<std::string, int> > hosts_;
+    std::vector<candidate_ptr> candidates_;
+    boost::posix_time::ptime start_;
+    bool listening_;
+    bool finished_;
+
+public:
+    server_discovery(int window_ms = 2000);
+
+    // multicast group to listen and probe on, an empty address only queries the added hosts
+    void set_group(std::string address, int port = default_port_multicast) { group_ = address; group_port_ = port; }
+
+    // port servers heard on the group accept connections on
+    void set_server_port(int port) { server_port_ = port; }
+
+    // how long discovery may take, in milliseconds
+    void set_window(int window_ms) { window_ms_ = window_ms; }
+
+    // hosts to query whether or not they are heard on the group
+    void add_host(std::string hostname, int port = default_port_tcp) { hosts_.push_back(std::make_pair(hostname, port)); }
+
+    // finds servers and ranks them by available capacity, returns false if none answered
+    bool discover(std::vector<discovered_server>& servers);
+
+protected:
+    bool listen();
+    void receive();
+    void add_candidate(std::string address, int port);
+    void handle_receive(const boost::system::error_code& error, std::size_t bytes);
+    void handle_server_info(candidate_ptr c, bool success);
+    void handle_progress(candidate_ptr c, bool success);
+    void handle_window(const boost::system::error_code& error);
+    void finish();
+    static const char* probe() { return "eureqa_discovery_probe"; }
+};
+
+/*---------------------------------------------------------------------------
+    implementions:
+*--------------------------------------------------------------------------*/
+inline
+bool by_available_capacity::operator ()(const discovered_server& a, const discovered_server& b) const
+{
+    if (a.is_searching() != b.is_searching()) { return !a.is_searching(); }
+    if (a.info_.cpu_cores_ != b.info_.cpu_cores_) { return a.info_.cpu_cores_ > b.info_.cpu_cores_; }
+    if (a.info_.eureqa_version_ != b.info_.eureqa_version_) { return a.info_.eureqa_version_ > b.info_.eureqa_version_; }
+    return a.response_ms_ < b.response_ms_;
+}
+
+inline
+server_discovery::server_discovery(int window_ms) :
+    udp_socket_(io_service_),
+    timer_(io_service_),
+    group_(default_multicast_group),
+    group_port_(default_port_multicast),
+    server_port_(default_port_tcp),
+    window_ms_(window_ms),
+    listening_(false),
+    finished_(false)
+{ }
+
+inline
+bool server_discovery::discover(std::vector<discovered_server>& servers)
+{
+    servers.clear();
+    candidates_.clear();
+    finished_ = false;
+    io_service_.reset();
+    start_ = boost::posix_time::microsec_clock::universal_time();
+
+    listening_ = listen();
+    for (int i=0; i<(int)hosts_.size(); ++i) { add_candidate(hosts_[i].first, hosts_[i].second); }
+    timer_.expires_from_now(boost::posix_time::milliseconds(window_ms_));
+    timer_.async_wait(boost::bind(&server_discovery::handle_window, this, boost::asio::placeholders::error));
+    if (!listening_ && candidates_.empty()) { finish(); }
+    io_service_.run();
+
+    // a server reached at two addresses is only reported once
+    for (int i=0; i<(int)candidates_.size(); ++i)
+    {
+        const discovered_server& s = candidates_[i]->server_;
+        if (!candidates_[i]->answered_) { continue; }
+        bool duplicate = false;
+        for (int j=0; j<(int)servers.size() && !duplicate; ++j)
+        {
+            duplicate = (servers[j].info_.hostname_ == s.info_.hostname_ && servers[j].port_ == s.port_);
+            if (duplicate && s.response_ms_ < servers[j].response_ms_) { servers[j] = s; }
+        }
+        if (!duplicate) { servers.push_back(s); }
+    }
+    candidates_.clear();
+    std::sort(servers.begin(), servers.end(), by_available_capacity());
+    return !servers.empty();
+}
+
+inline
+bool server_discovery::listen()
+{
+    if (group_.empty()) { return false; }
+    boost::system::error_code error;
+    boost::asio::ip::address group = boost::asio::ip::address::from_string(group_, error);
+    if (!error) { udp_socket_.open(boost::asio::ip::udp::v4(), error); }
+    if (!error) { udp_socket_.set_option(boost::asio::ip::udp::socket::reuse_address(true), error); }
+    if (!error) { udp_socket_.bind(boost::asio::ip::udp::endpoint(boost::asio::ip::udp::v4(), group_port_), error); }
+    if (!error) { udp_socket_.set_option(boost::asio::ip::multicast::join_group(group), error); }
+    if (error)
+    {
+        // no multicast on this network, only the added hosts are queried
+        boost::system::error_code ignored;
+        udp_socket_.close(ignored);
+        return false;
+    }
+
+    // probe the group, servers that answer are found even between announcements
+    boost::system::error_code ignored;
+    udp_socket_.set_option(boost::asio::ip::multicast::hops(1), ignored);
+    udp_socket_.send_to(boost::asio::buffer(std::string(probe())), boost::asio::ip::udp::endpoint(group, group_port_), 0, ignored);
+    receive();
+    return true;
+}
+
+inline
+void server_discovery::receive()
+{
+    udp_socket_.async_receive_from(boost::asio::buffer(datagram_), sender_,
+        boost::bind(&server_discovery::handle_receive, this, boost::asio::placeholders::error,
+                    boost::asio::placeholders::bytes_transferred));
+}
+
+inline
+void server_discovery::handle_receive(const boost::system::error_code& error, std::size_t bytes)
+{
+    if (error || finished_) { return; }
+
+    // skip probes, including our own looped back
+    if (std::string(datagram_.data(), bytes) != probe())
+    {
+        add_candidate(sender_.address().to_string(), server_port_);
+    }
+    receive();
+}
+
+inline
+void server_discovery::add_candidate(std::string address, int port)
+{
+    for (int i=0; i<(int)candidates_.size(); ++i)
+    {
+        if (candidates_[i]->server_.address_ == address && candidates_[i]->server_.port_ == port) { return; }
+    }
+
+    // the queries wait behind the connect, and fail with it
+    candidate_ptr c(new candidate(io_service_));
+    c->server_.address_ = address;
+    c->server_.port_ = port;
+    candidates_.push_back(c);
+    c->conn_.async_connect(address, port, completion_handler());
+    c->conn_.async_query_server_info(c->server_.info_, boost::bind(&server_discovery::handle_server_info, this, c, _1));
+    c->conn_.async_query_progress(c->server_.progress_, boost::bind(&server_discovery::handle_progress, this, c, _1));
+}
+
+inline
+void server_discovery::handle_server_info(candidate_ptr c, bool success)
+{
+    if (!success || finished_) { return; }
+    c->answered_ = true;
+    boost::posix_time::time_duration elapsed = boost::posix_time::microsec_clock::universal_time() - start_;
+    c->server_.response_ms_ = elapsed.total_microseconds() / 1000.0;
+}
+
+inline
+void server_discovery::handle_progress(candidate_ptr c, bool success)
+{
+    c->done_ = true;
+    c->server_.has_progress_ = success && c->answered_;
+    c->conn_.disconnect();
+    if (finished_) { return; }
+
+    // without multicast nothing more can turn up once every host has answered
+    if (listening_) { return; }
+    for (int i=0; i<(int)candidates_.size(); ++i)
+    {
+        if (!candidates_[i]->done_) { return; }
+    }
+    finish();
+}
+
+inline
+void server_discovery::handle_window(const boost::system::error_code& error)
+{
+    if (!error) { finish(); }
+}
+
+inline
+void server_discovery::finish()
+{
+    // closing everything lets the outstanding handlers run down and io_service::run return
+    finished_ = true;
+    boost::system::error_code ignored;
+    timer_.cancel(ignored);
+    udp_socket_.close(ignored);
+    for (int i=0; i<(int)candidates_.size(); ++i) { candidates_[i]->conn_.disconnect(); }
+}
+
+} // namespace eureqa
+
+#endif // EUREQA_DISCOVERY_H
@@ -3,6 +3,17 @@
 
 #include <eureqa/data_set.h>
 #include <eureqa/connection.h>
+#include <eureqa/async_connection.h>
+#include <eureqa/pipeline.h>
+#include <eureqa/discovery.h>
+#include <eureqa/session.h>
+#include <eureqa/cluster.h>
+#include <eureqa/scheduler.h>
+#include <eureqa/migration.h>
+#include <eureqa/sweep.h>
+#include <eureqa/tuner.h>
+#include <eureqa/supervisor.h>
+#include <eureqa/cross_validation.h>
 #include <eureqa/server_info.h>
 #include <eureqa/search_progress.h>
 #include <eureqa/search_options.h>
@@ -0,0 +1,340 @@
+#ifndef EUREQA_MIGRATION_H
+#define EUREQA_MIGRATION_H
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <boost/bind.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <eureqa/connection.h>
+
+namespace eureqa
+{
+// which islands receive each island's migrants
+namespace topologies
+{
+static const int ring   = 1; // each to the next, the last to the first
+static const int star   = 2; // each to the hub, the hub to every other
+static const int random = 3; // each to another picked at random every round
+}
+
+struct migration_options
+{
+    int topology_;
+    int interval_ms_; // between rounds
+    int migrants_; // best individuals each island sends per round
+    int sample_size_; // individuals sampled from each island to pick the best from
+    int hub_; // island at the centre of a star
+    unsigned int seed_; // for the random topology
+
+    migration_options() : topology_(topologies::ring), interval_ms_(5000), migrants_(4), sample_size_(32), hub_(0), seed_(1) { }
+};
+
+// shares discoveries between searches running on several servers
+//
+// each round samples individuals from every server, keeps the fittest, and
+// injects them into the server's neighbours in the topology, so independent
+// searches work together as one island-model search; the rounds run on a
+// background thread, over connections of the migration's own, one per server,
+// and every query and injection of a round happens on all the servers at once
+//
+// an island that fails is skipped and reconnected at the start of the next round
+//
+//   eureqa::migration islands(options);
+//   islands.start(hostnames);
+//   ... the searches run, started through other connections ...
+//   islands.stop();
+class migration
+{
+protected:
+    struct island
+    {
+        std::string hostname_;
+        int port_;
+        eureqa::connection conn_;
+        std::vector<eureqa::solution_info> sample_;
+        std::vector<eureqa::solution_info> incoming_;
+        bool ok_;
+        island() : port_(default_port_tcp), ok_(false) { }
+    };
+    typedef boost::shared_ptr<island> island_ptr;
+
+    migration_options options_;
+    std::vector<island_ptr> islands_;
+    boost::scoped_ptr<boost::thread> thread_;
+    boost::mt19937 rng_;
+    mutable boost::mutex mutex_; // guards the counters and best_
+    eureqa::solution_frontier best_;
+    int rounds_;
+    int migrants_sent_;
+    int failures_;
+
+public:
+    migration(migration_options options = migration_options());
+    ~migration() { stop(); }
+    const migration_options& options() const { return options_; }
+
+    // connects to every server and starts migrating in the background, a hostname
+    // may end in :port; true if at least two of them connected
+    bool start(const std::vector<std::string>& hostnames, int port = default_port_tcp);
+
+    // stops migrating and closes the connections, a round in flight is cut short
+    void stop();
+    bool is_running() const { return thread_.get() != 0; }
+
+    // connects without starting the background thread, for running rounds with migrate()
+    bool connect(const std::vector<std::string>& hostnames, int port = default_port_tcp);
+
+    // runs a round now on this thread, not while the background thread is running;
+    // true unless every island failed
+    bool migrate();
+
+    // the islands a given island sends its migrants to, in this round
+    std::vector<int> neighbours(int i);
+
+    // statistics
+    int islands() const { return (int)islands_.size(); }
+    int rounds() const;
+    int migrants_sent() const;
+    int failures() const;
+
+    // the fittest individuals seen in the samples, at each complexity
+    eureqa::solution_frontier best() const;
+
+protected:
+    void run();
+    static void connect_island(island* isl);
+    static void sample_island(island* isl, int count);
+    static void inject_island(island* isl);
+    static bool by_fitness(const eureqa::solution_info& a, const eureqa::solution_info& b) { return a.fitness_ > b.fitness_; }
+};
+
+/*---------------------------------------------------------------------------
+    implementions:
+*--------------------------------------------------------------------------*/
+inline
+migration::migration(migration_options options) :
+    options_(options),
+    rng_(options.seed_),
+    rounds_(0),
+    migrants_sent_(0),
+    failures_(0)
+{ }
+
+inline
+bool migration::start(const std::vector<std::string>& hostnames, int port)
+{
+    stop();
+    if (!connect(hostnames, port)) { return false; }
+    thread_.reset(new boost::thread(boost::bind(&migration::run, this)));
+    return true;
+}
+
+inline
+void migration::stop()
+{
+    if (thread_)
+    {
+        thread_->interrupt();
+        for (int i=0; i<(int)islands_.size(); ++i) { islands_[i]->conn_.cancel(); }
+        thread_->join();
+        thread_.reset();
+    }
+    for (int i=0; i<(int)islands_.size(); ++i) { islands_[i]->conn_.disconnect(); }
+}
+
+inline
+bool migration::connect(const std::vector<std::string>& hostnames, int port)
+{
+    islands_.clear();
+    for (int i=0; i<(int)hostnames.size(); ++i)
+    {
+        island_ptr isl(new island());
+        isl->port_ = port;
+        eureqa::connection::parse_address(hostnames[i], isl->hostname_, isl->port_);
+        islands_.push_back(isl);
+    }
+
+    // join_all() is an interruption point, and the threads must not outlive the islands
+    {
+        boost::this_thread::disable_interruption no_interruption;
+        boost::thread_group threads;
+        for (int i=0; i<(int)islands_.size(); ++i) { threads.create_thread(boost::bind(&migration::connect_island, islands_[i].get())); }
+        threads.join_all();
+    }
+
+    int connected = 0;
+    for (int i=0; i<(int)islands_.size(); ++i) { connected += islands_[i]->ok_ ? 1 : 0; }
+    return connected >= 2;
+}
+
+inline
+bool migration::migrate()
+{
+    int n = (int)islands_.size();
+    if (n < 2) { return false; }
+    boost::this_thread::interruption_point();
+
+    // sample every island at once, reconnecting any lost in an earlier round;
+    // stop() interrupts only between the phases, and cancels the connections
+    // so a phase in flight finishes promptly with its threads joined
+    {
+        boost::this_thread::disable_interruption no_interruption;
+        boost::thread_group sampling;
+        for (int i=0; i<n; ++i) { sampling.create_thread(boost::bind(&migration::sample_island, islands_[i].get(), options_.sample_size_)); }
+        sampling.join_all();
+    }
+
+    // each island's fittest go to its neighbours
+    int failed = 0;
+    for (int i=0; i<n; ++i) { islands_[i]->incoming_.clear(); }
+    for (int i=0; i<n; ++i)
+    {
+        island& from = *islands_[i];
+        if (!from.ok_) { ++failed; continue; }
+        std::sort(from.sample_.begin(), from.sample_.end(), by_fitness);
+        if ((int)from.sample_.size() > options_.migrants_) { from.sample_.resize(options_.migrants_); }
+        std::vector<int> to = neighbours(i);
+        for (int k=0; k<(int)to.size(); ++k)
+        {
+            std::vector<eureqa::solution_info>& incoming = islands_[to[k]]->incoming_;
+            incoming.insert(incoming.end(), from.sample_.begin(), from.sample_.end());
+        }
+    }
+
+    // inject them all at once, an island that failed its sample gets none
+    boost::this_thread::interruption_point();
+    std::vector<char> injected(n, 0);
+    {
+        boost::this_thread::disable_interruption no_interruption;
+        boost::thread_group injecting;
+        for (int i=0; i<n; ++i)
+        {
+            island& to = *islands_[i];
+            if (!to.ok_ || to.incoming_.empty()) { continue; }
+            injected[i] = 1;
+            injecting.create_thread(boost::bind(&migration::inject_island, &to));
+        }
+        injecting.join_all();
+    }
+    int sent = 0;
+    for (int i=0; i<n; ++i)
+    {
+        if (!injected[i]) { continue; }
+        if (islands_[i]->ok_) { sent += (int)islands_[i]->incoming_.size(); }
+        else { ++failed; }
+    }
+
+    boost::mutex::scoped_lock lock(mutex_);
+    for (int i=0; i<n; ++i)
+    {
+        for (int k=0; k<(int)islands_[i]->sample_.size(); ++k) { if (!islands_[i]->sample_[k].text_.empty()) { best_.add(islands_[i]->sample_[k]); } }
+    }
+    ++rounds_;
+    migrants_sent_ += sent;
+    failures_ += failed;
+    return failed < n;
+}
+
+inline
+std::vector<int> migration::neighbours(int i)
+{
+    int n = (int)islands_.size();
+    std::vector<int> to;
+    if (n < 2) { return to; }
+    switch (options_.topology_)
+    {
+    case topologies::star:
+    {
+        int hub = std::min(std::max(options_.hub_, 0), n - 1);
+        if (i != hub) { to.push_back(hub); break; }
+        for (int j=0; j<n; ++j) { if (j != hub) { to.push_back(j); } }
+        break;
+    }
+    case topologies::random:
+    {
+        int j = (int)(rng_() % (unsigned int)(n - 1));
+        to.push_back(j < i ? j : j + 1);
+        break;
+    }
+    default:
+        to.push_back((i + 1) % n);
+        break;
+    }
+    return to;
+}
+
+inline
+int migration::rounds() const
+{
+    boost::mutex::scoped_lock lock(mutex_);
+    return rounds_;
+}
+
+inline
+int migration::migrants_sent() const
+{
+    boost::mutex::scoped_lock lock(mutex_);
+    return migrants_sent_;
+}
+
+inline
+int migration::failures() const
+{
+    boost::mutex::scoped_lock lock(mutex_);
+    return failures_;
+}
+
+inline
+eureqa::solution_frontier migration::best() const
+{
+    boost::mutex::scoped_lock lock(mutex_);
+    return best_;
+}
+
+inline
+void migration::run()
+{
+    try
+    {
+        while (true)
+        {
+            boost::this_thread::sleep(boost::posix_time::milliseconds(options_.interval_ms_));
+            migrate();
+        }
+    }
+    catch (const boost::thread_interrupted&) { }
+}
+
+inline
+void migration::connect_island(island* isl)
+{
+    isl->ok_ = isl->conn_.connect(isl->hostname_, isl->port_);
+}
+
+inline
+void migration::sample_island(island* isl, int count)
+{
+    isl->sample_.clear();
+    if (!isl->conn_.is_connected()) { connect_island(isl); }
+    try { isl->ok_ = isl->conn_.is_connected() && isl->conn_.query_individuals(isl->sample_, count) && isl->conn_.last_result().value() == 0; }
+    catch (const std::exception&) { isl->ok_ = false; }
+    if (!isl->ok_) { isl->conn_.disconnect(); }
+}
+
+inline
+void migration::inject_island(island* isl)
+{
+    try { isl->ok_ = isl->conn_.send_individuals(isl->incoming_) && isl->conn_.last_result().value() == 0; }
+    catch (const std::exception&) { isl->ok_ = false; }
+    if (!isl->ok_) { isl->conn_.disconnect(); }
+}
+
+} // namespace eureqa
+
+#endif // EUREQA_MIGRATION_H
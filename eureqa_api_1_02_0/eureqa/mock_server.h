@@ -0,0 +1,556 @@
+#ifndef EUREQA_MOCK_SERVER_H
+#define EUREQA_MOCK_SERVER_H
+
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cmath>
+#include <sstream>
+#include <algorithm>
+#include <boost/asio.hpp>
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
+#include <boost/thread.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <eureqa/connection.h>
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+#include <unistd.h>
+#endif
+
+namespace eureqa
+{
+// how a mock_server behaves, the defaults answer at once and never fail
+struct mock_server_options
+{
+    int latency_ms_; // added before every response
+    int jitter_ms_; // the latency varies by up to this much either way
+    int bandwidth_; // bytes per second each response is written at, 0 is unlimited
+    double drop_rate_; // chance a command is met by closing the connection
+    double error_rate_; // chance a command is answered with result_error, queries are not
+    double corrupt_rate_; // chance a query's packet is garbled, so it fails to decode
+    double stall_rate_; // chance a response is held back a further stall_ms_
+    int stall_ms_;
+    double generations_per_sec_; // of the synthetic search
+    int max_complexity_; // of the synthetic solutions, which bounds the frontier's size
+    unsigned int seed_; // sessions draw faults and solutions from seed_ plus their number
+
+    mock_server_options() : latency_ms_(0), jitter_ms_(0), bandwidth_(0), drop_rate_(0), error_rate_(0),
+        corrupt_rate_(0), stall_rate_(0), stall_ms_(5000), generations_per_sec_(100), max_complexity_(30), seed_(1) { }
+};
+
+// a stand-in eureqa server for tests and benchmarks
+//
+// it implements every command with the server's framing: data sets, options and
+// individuals are decoded and checked, and queries are answered in the encoding
+// the client last sent, from a synthetic search whose solutions improve as its
+// generations pass; responses can be slowed, throttled and made to fail
+//
+// clients reach it over loopback, or in-process through a socket pair
+//
+//   eureqa::mock_server server(options);
+//   server.listen();
+//   conn.connect("127.0.0.1", server.port());
+//
+//   server.connect(conn); // in-process
+class mock_server
+{
+protected:
+    mock_server_options options_;
+    boost::asio::io_service io_service_;
+    boost::scoped_ptr<boost::asio::ip::tcp::acceptor> acceptor_;
+    boost::scoped_ptr<boost::thread> accept_thread_;
+    struct running_session
+    {
+        boost::shared_ptr<boost::thread> thread_;
+        boost::function<void ()> shutdown_; // of its socket, which it keeps open
+    };
+    std::vector<running_session> running_; // sessions not yet reaped
+    boost::mutex mutex_;
+    int sessions_;
+    int commands_;
+
+public:
+    mock_server(mock_server_options options = mock_server_options());
+    ~mock_server() { stop(); }
+
+    const mock_server_options& options() const { return options_; }
+
+    // accepts clients on a tcp port, 0 picks a free one
+    bool listen(int port = 0, std::string address = "127.0.0.1");
+    int port() const;
+
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+    // connects a client in this process over a socket pair, bypassing the tcp stack
+    bool connect(connection& conn);
+#endif
+
+    // closes every session and stops listening
+    void stop();
+
+    // sessions started and commands answered since the server was created
+    int sessions() { boost::mutex::scoped_lock lock(mutex_); return sessions_; }
+    int commands() { boost::mutex::scoped_lock lock(mutex_); return commands_; }
+
+protected:
+    void start_accept();
+    void handle_accept(boost::shared_ptr<boost::asio::ip::tcp::socket> s, const boost::system::error_code& error);
+    template<typename Socket> void start_session(boost::shared_ptr<Socket> s);
+    template<typename Socket> void serve(boost::shared_ptr<Socket> s, int id);
+    template<typename Socket> static void shutdown(boost::shared_ptr<Socket> s);
+    static void run(boost::asio::io_service* io_service) { io_service->run(); }
+
+    // one client's server state
+    class session_state
+    {
+    protected:
+        const mock_server_options& options_;
+        boost::mt19937 rng_;
+        int encoding_; // of the last packet received
+        eureqa::data_set data_;
+        eureqa::search_options search_options_;
+        eureqa::solution_frontier frontier_;
+        bool searching_;
+        double generations_; // completed before the search was last started
+        boost::posix_time::ptime started_;
+
+    public:
+        session_state(const mock_server_options& options, int id);
+
+        // a draw from [0,1), for faults and solutions
+        double uniform() { return rng_() / 4294967296.0; }
+
+        // the wire bytes answering a command, false to close the connection
+        bool respond(int cmd, int argument, const std::string& request, std::string& response);
+
+        // a response's delay before it is written
+        double delay_ms();
+
+        // append a command_result, or a lone packet, as the server frames them
+        static void add_result(int value, std::string message, std::string& response);
+        static void add_packet(const std::string& packet, std::string& response);
+
+    protected:
+        double generations() const;
+        eureqa::solution_info make_solution(double generations);
+        template<typename T> bool decode_request(const std::string& request, const char* name, T& val);
+    };
+
+    template<typename Socket> bool write_response(Socket& s, session_state& state, const std::string& response);
+};
+
+/*---------------------------------------------------------------------------
+    implementions:
+*--------------------------------------------------------------------------*/
+inline
+mock_server::mock_server(mock_server_options options) :
+    options_(options),
+    sessions_(0),
+    commands_(0)
+{ }
+
+inline
+bool mock_server::listen(int port, std::string address)
+{
+    stop();
+    try
+    {
+        boost::asio::ip::tcp::endpoint endpoint(boost::asio::ip::address::from_string(address), (unsigned short)port);
+        acceptor_.reset(new boost::asio::ip::tcp::acceptor(io_service_, endpoint));
+    }
+    catch (...) { acceptor_.reset(); return false; }
+    io_service_.reset();
+    start_accept();
+    accept_thread_.reset(new boost::thread(boost::bind(&mock_server::run, &io_service_)));
+    return true;
+}
+
+inline
+int mock_server::port() const
+{
+    if (!acceptor_) { return 0; }
+    boost::system::error_code error;
+    boost::asio::ip::tcp::endpoint endpoint = acceptor_->local_endpoint(error);
+    return error ? 0 : endpoint.port();
+}
+
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+inline
+bool mock_server::connect(connection& conn)
+{
+    typedef boost::asio::local::stream_protocol::socket local_socket;
+    boost::shared_ptr<local_socket> server_end(new local_socket(io_service_));
+    local_socket client_end(io_service_);
+    boost::system::error_code error;
+    boost::asio::local::connect_pair(*server_end, client_end, error);
+    if (error) { return false; }
+
+    // the connection takes its own descriptor, on its own io_service
+    int handle = ::dup(client_end.native_handle());
+    client_end.close(error);
+    if (handle < 0) { return false; }
+    start_session(server_end);
+    return conn.adopt(handle);
+}
+#endif
+
+inline
+void mock_server::stop()
+{
+    if (accept_thread_)
+    {
+        io_service_.stop();
+        accept_thread_->join();
+        accept_thread_.reset();
+    }
+    if (acceptor_)
+    {
+        boost::system::error_code ignored;
+        acceptor_->close(ignored);
+        acceptor_.reset();
+    }
+
+    // the sessions' blocking reads fail once their sockets are shut down
+    std::vector<running_session> running;
+    {
+        boost::mutex::scoped_lock lock(mutex_);
+        for (int i=0; i<(int)running_.size(); ++i) { running_[i].shutdown_(); }
+        running.swap(running_);
+    }
+    for (int i=0; i<(int)running.size(); ++i) { running[i].thread_->join(); }
+}
+
+inline
+void mock_server::start_accept()
+{
+    boost::shared_ptr<boost::asio::ip::tcp::socket> s(new boost::asio::ip::tcp::socket(io_service_));
+    acceptor_->async_accept(*s, boost::bind(&mock_server::handle_accept, this, s, boost::asio::placeholders::error));
+}
+
+inline
+void mock_server::handle_accept(boost::shared_ptr<boost::asio::ip::tcp::socket> s, const boost::system::error_code& error)
+{
+    if (error) { return; }
+    boost::system::error_code ignored;
+    s->set_option(boost::asio::ip::tcp::no_delay(true), ignored);
+    start_session(s);
+    start_accept();
+}
+
+template<typename Socket>
+inline
+void mock_server::start_session(boost::shared_ptr<Socket> s)
+{
+    boost::mutex::scoped_lock lock(mutex_);
+
+    // reap the sessions that have ended, closing their sockets,
+    // so a long running server holds only the clients still connected
+    std::vector<running_session> running;
+    for (int i=0; i<(int)running_.size(); ++i)
+    {
+        if (!running_[i].thread_->timed_join(boost::posix_time::seconds(0))) { running.push_back(running_[i]); }
+    }
+    running_.swap(running);
+
+    int id = sessions_++;
+    running_session session;
+    session.shutdown_ = boost::bind(&mock_server::shutdown<Socket>, s);
+    session.thread_.reset(new boost::thread(boost::bind(&mock_server::serve<Socket>, this, s, id)));
+    running_.push_back(session);
+}
+
+template<typename Socket>
+inline
+void mock_server::shutdown(boost::shared_ptr<Socket> s)
+{
+    boost::system::error_code ignored;
+    s->shutdown(Socket::shutdown_both, ignored);
+}
+
+template<typename Socket>
+inline
+void mock_server::serve(boost::shared_ptr<Socket> s, int id)
+{
+    session_state state(options_, id);
+    std::string greeting;
+    session_state::add_result(result_success, "Connected to the mock Eureqa server", greeting);
+    if (!write_response(*s, state, greeting)) { return; }
+
+    std::string request, response;
+    boost::system::error_code error;
+    for (;;)
+    {
+        // read a command as the server would, closing on anything it does not know
+        int cmd = 0, argument = 0, size = 0;
+        boost::asio::read(*s, boost::asio::buffer(&cmd, sizeof(int)), boost::asio::transfer_all(), error);
+        if (error || !commands::is_known(cmd)) { break; }
+        if (commands::has_argument(cmd))
+        {
+            boost::asio::read(*s, boost::asio::buffer(&argument, sizeof(int)), boost::asio::transfer_all(), error);
+            if (error) { break; }
+        }
+        request.clear();
+        if (commands::has_packet(cmd))
+        {
+            boost::asio::read(*s, boost::asio::buffer(&size, sizeof(int)), boost::asio::transfer_all(), error);
+            if (error || size < 0) { break; }
+            request.resize(size);
+            if (size > 0) { boost::asio::read(*s, boost::asio::buffer(&request[0], size), boost::asio::transfer_all(), error); }
+            if (error) { break; }
+        }
+        {
+            boost::mutex::scoped_lock lock(mutex_);
+            ++commands_;
+        }
+
+        // injected faults
+        if (state.uniform() < options_.drop_rate_) { break; }
+        if (!commands::returns_packet(cmd) && state.uniform() < options_.error_rate_)
+        {
+            response.clear();
+            session_state::add_result(result_error, "Injected fault", response);
+        }
+        else
+        {
+            if (!state.respond(cmd, argument, request, response)) { break; }
+            if (commands::returns_packet(cmd) && response.size() > sizeof(int) && state.uniform() < options_.corrupt_rate_)
+            {
+                // keep the size so the framing holds, and garble what it frames
+                for (std::size_t i=sizeof(int); i<response.size(); ++i) { response[i] = (char)(state.uniform() * 256); }
+            }
+        }
+        if (!write_response(*s, state, response)) { break; }
+    }
+    shutdown(s);
+}
+
+template<typename Socket>
+inline
+bool mock_server::write_response(Socket& s, session_state& state, const std::string& response)
+{
+    double delay = state.delay_ms();
+    if (delay > 0) { boost::this_thread::sleep(boost::posix_time::microseconds((boost::int64_t)(delay * 1000))); }
+
+    boost::system::error_code error;
+    if (options_.bandwidth_ <= 0)
+    {
+        boost::asio::write(s, boost::asio::buffer(response), boost::asio::transfer_all(), error);
+        return !error;
+    }
+
+    // written in slices of about 10ms each, paced against the start
+    std::size_t slice = std::max(1, options_.bandwidth_ / 100);
+    boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+    for (std::size_t at=0; at<response.size(); at+=slice)
+    {
+        std::size_t n = std::min(slice, response.size() - at);
+        boost::asio::write(s, boost::asio::buffer(response.data() + at, n), boost::asio::transfer_all(), error);
+        if (error) { return false; }
+        boost::posix_time::ptime due = start + boost::posix_time::microseconds((boost::int64_t)((at + n) * 1e6 / options_.bandwidth_));
+        if (due > boost::posix_time::microsec_clock::universal_time()) { boost::this_thread::sleep(due); }
+    }
+    return true;
+}
+
+inline
+mock_server::session_state::session_state(const mock_server_options& options, int id) :
+    options_(options),
+    rng_(options.seed_ + id),
+    encoding_(default_encoding),
+    searching_(false),
+    generations_(0)
+{ }
+
+inline
+double mock_server::session_state::delay_ms()
+{
+    double ms = options_.latency_ms_;
+    if (options_.jitter_ms_ > 0) { ms += (2*uniform() - 1) * options_.jitter_ms_; }
+    if (options_.stall_rate_ > 0 && uniform() < options_.stall_rate_) { ms += options_.stall_ms_; }
+    return std::max(0.0, ms);
+}
+
+inline
+bool mock_server::session_state::respond(int cmd, int argument, const std::string& request, std::string& response)
+{
+    response.clear();
+    std::string packet;
+    switch (cmd)
+    {
+    case commands::send_data_set:
+        if (!decode_request(request, "data_set", data_)) { add_result(result_error, "Unable to read the data set", response); }
+        else if (!data_.is_valid()) { add_result(result_error, "The data set is invalid", response); }
+        else { add_result(result_success, "Data set received: " + data_.summary(), response); }
+        return true;
+
+    case commands::send_data_location:
+        if (data_.import_ascii(request)) { add_result(result_success, "Data set loaded: " + data_.summary(), response); }
+        else { add_result(result_error, "Unable to load the data set at " + request, response); }
+        return true;
+
+    case commands::send_options:
+        if (!decode_request(request, "search_options", search_options_)) { add_result(result_error, "Unable to read the search options", response); }
+        else { add_result(result_success, "Search options received", response); }
+        return true;
+
+    case commands::send_individuals:
+        {
+            std::vector<eureqa::solution_info> individuals;
+            if (!decode_request(request, "vector_solution_info", individuals)) { add_result(result_error, "Unable to read the individuals", response); return true; }
+            for (int i=0; i<(int)individuals.size(); ++i) { frontier_.add(individuals[i]); }
+            add_result(result_success, boost::lexical_cast<std::string>(individuals.size()) + " individuals received", response);
+        }
+        return true;
+
+    case commands::query_progress:
+        {
+            eureqa::search_progress progress;
+            double generations = this->generations();
+            progress.generations_ = (float)generations;
+            progress.generations_per_sec_ = (float)(searching_ ? options_.generations_per_sec_ : 0);
+            progress.total_population_size_ = search_options_.solution_population_size_;
+            progress.evaluations_ = (float)(generations * progress.total_population_size_);
+            progress.evaluations_per_sec_ = progress.generations_per_sec_ * progress.total_population_size_;
+            if (generations > 0)
+            {
+                progress.solution_ = make_solution(generations);
+                frontier_.add(progress.solution_);
+            }
+            encode_packet(encoding_, progress, "search_progress", packet);
+        }
+        break;
+
+    case commands::query_server_info:
+        {
+            eureqa::server_info info;
+            info.hostname_ = "mock";
+            info.operating_system_ = "mock";
+            info.eureqa_version_ = 1.02;
+            info.cpu_cores_ = std::max(1, (int)boost::thread::hardware_concurrency());
+            encode_packet(encoding_, info, "server_info", packet);
+        }
+        break;
+
+    case commands::query_individuals:
+        {
+            std::vector<eureqa::solution_info> individuals;
+            double generations = this->generations();
+            for (int i=0; i<argument; ++i) { individuals.push_back(make_solution(generations)); }
+            encode_packet(encoding_, individuals, "vector_solution_info", packet);
+        }
+        break;
+
+    case commands::query_frontier:
+        encode_packet(encoding_, frontier_, "solution_frontier", packet);
+        break;
+
+    case commands::start_search:
+        if (!searching_) { searching_ = true; started_ = boost::posix_time::microsec_clock::universal_time(); }
+        add_result(result_success, "Search started", response);
+        return true;
+
+    case commands::pause_search:
+        generations_ = generations();
+        searching_ = false;
+        add_result(result_success, "Search paused", response);
+        return true;
+
+    case commands::end_search:
+        generations_ = 0;
+        searching_ = false;
+        frontier_.clear();
+        add_result(result_success, "Search ended", response);
+        return true;
+
+    case commands::calc_solution_info:
+        {
+            // answered in the request's encoding, which is how clients probe for one
+            std::vector<eureqa::solution_info> individuals;
+            if (!decode_request(request, "vector_solution_info", individuals)) { return false; }
+            for (int i=0; i<(int)individuals.size(); ++i)
+            {
+                // a stable made up fitness, longer expressions fit better
+                individuals[i].complexity_ = (float)std::max<std::size_t>(1, individuals[i].text_.size() / 4);
+                individuals[i].fitness_ = -1.0f / individuals[i].complexity_;
+                individuals[i].score_ = individuals[i].fitness_;
+            }
+            encode_packet(encoding_, individuals, "vector_solution_info", packet);
+        }
+        break;
+
+    default:
+        return false;
+    }
+    add_packet(packet, response);
+    return true;
+}
+
+inline
+double mock_server::session_state::generations() const
+{
+    if (!searching_) { return generations_; }
+    boost::posix_time::time_duration elapsed = boost::posix_time::microsec_clock::universal_time() - started_;
+    return generations_ + elapsed.total_microseconds() / 1e6 * options_.generations_per_sec_;
+}
+
+inline
+eureqa::solution_info mock_server::session_state::make_solution(double generations)
+{
+    // a sum of terms, one per two steps of complexity, whose error falls
+    // with both complexity and generations, so the frontier keeps improving
+    int complexity = 1 + (int)(uniform() * std::max(1, options_.max_complexity_));
+    std::string lhs = search_options_.search_relationship_.substr(0, search_options_.search_relationship_.find('='));
+    lhs.erase(lhs.find_last_not_of(' ') + 1);
+    if (lhs.empty() || lhs.size() == search_options_.search_relationship_.size()) { lhs = "y"; }
+
+    std::ostringstream os;
+    os.precision(4);
+    os << lhs << " = " << uniform() * 10;
+    for (int i=1; i<complexity; i+=2)
+    {
+        std::string symbol = data_.X_symbols_.empty() ? std::string("x") : data_.X_symbols_[(std::size_t)(uniform() * data_.X_symbols_.size())];
+        os << " + " << uniform() * 10 << "*" << symbol;
+    }
+
+    eureqa::solution_info soln(os.str());
+    soln.complexity_ = (float)complexity;
+    soln.fitness_ = (float)(-(1.0 + 0.1 * uniform()) / (complexity * (1.0 + std::log(1.0 + generations))));
+    soln.score_ = soln.fitness_;
+    soln.age_ = (unsigned int)generations;
+    return soln;
+}
+
+inline
+void mock_server::session_state::add_result(int value, std::string message, std::string& response)
+{
+    response.append((const char*)&value, sizeof(int));
+    add_packet(message, response);
+}
+
+inline
+void mock_server::session_state::add_packet(const std::string& packet, std::string& response)
+{
+    int size = (int)packet.size();
+    response.append((const char*)&size, sizeof(int));
+    response += packet;
+}
+
+template<typename T>
+inline
+bool mock_server::session_state::decode_request(const std::string& request, const char* name, T& val)
+{
+    try
+    {
+        decode_packet(request, name, val);
+        encoding_ = packet_encoding(request);
+        return true;
+    }
+    catch (...) { return false; }
+}
+
+} // namespace eureqa
+
+#endif // EUREQA_MOCK_SERVER_H
@@ -0,0 +1,167 @@
+#ifndef EUREQA_PACKET_H
+#define EUREQA_PACKET_H
+
+#include <string>
+#include <sstream>
+#include <istream>
+#include <ostream>
+#include <boost/archive/xml_iarchive.hpp>
+#include <boost/archive/xml_oarchive.hpp>
+#include <boost/archive/binary_iarchive.hpp>
+#include <boost/archive/binary_oarchive.hpp>
+#include <boost/serialization/vector.hpp>
+#include <eureqa/packet_stream.h>
+
+namespace eureqa
+{
+// archive formats used for the packets sent over the network
+namespace encodings
+{
+static const int xml    = 0;
+static const int binary = 1;
+std::string str(int encoding);
+}
+
+// serializes an object into a packet using the given encoding
+template<typename T> void encode_packet(int encoding, const T& val, const char* name, std::string& packet);
+
+// serializes an object straight into a stream, such as one writing to a socket
+template<typename T> void encode_stream(int encoding, const T& val, const char* name, std::ostream& os);
+
+// returns the size of the packet encode_packet would produce, without building it
+template<typename T> std::streamsize encoded_size(int encoding, const T& val, const char* name);
+
+// deserializes an object from a packet, detecting the encoding it was written in
+// throws boost::archive::archive_exception if the packet is malformed
+template<typename T> void decode_packet(const std::string& packet, const char* name, T& val);
+template<typename T> void decode_packet(const char* data, std::size_t size, const char* name, T& val);
+
+// the same, always going through the boost archives
+template<typename T> void encode_archive(int encoding, const T& val, const char* name, std::string& packet);
+template<typename T> void decode_archive(const char* data, std::size_t size, const char* name, T& val);
+
+// hooks for hand-written xml codecs, overloaded in xml_codec.h for the messages that have one
+// return false to fall back to the archives
+template<typename T> bool fast_encode(const T& /*val*/, const char* /*name*/, std::string& /*packet*/) { return false; }
+template<typename T> bool fast_decode(const char* /*data*/, std::size_t /*size*/, const char* /*name*/, T& /*val*/) { return false; }
+
+// returns the encoding a packet was written in
+int packet_encoding(const std::string& packet);
+int packet_encoding(const char* data, std::size_t size);
+
+/*---------------------------------------------------------
+    Implementation:
+*--------------------------------------------------------*/
+namespace encodings
+{
+inline
+std::string str(int encoding)
+{
+    switch (encoding)
+    {
+    case xml:    return "XML";
+    case binary: return "Binary";
+    default:     return "Unknown";
+    }
+}
+}
+
+inline
+int packet_encoding(const char* data, std::size_t size)
+{
+    // xml archives always open with their declaration, binary archives with a size
+    for (std::size_t i=0; i<size; ++i)
+    {
+        if (data[i] == ' ' || data[i] == '\t' || data[i] == '\r' || data[i] == '\n') { continue; }
+        return (data[i] == '<') ? encodings::xml : encodings::binary;
+    }
+    return encodings::binary;
+}
+
+inline
+int packet_encoding(const std::string& packet)
+{
+    return packet_encoding(packet.data(), packet.size());
+}
+
+// encode_stream and decode_archive hold all of the archive code, they are not
+// inline so libeureqa_client can compile them once, see EUREQA_SEPARATE_COMPILATION
+template<typename T>
+void encode_stream(int encoding, const T& val, const char* name, std::ostream& os)
+{
+    // the archive is closed before returning, so the packet is complete
+    if (encoding == encodings::binary)
+    {
+        boost::archive::binary_oarchive ar(os);
+        ar << boost::serialization::make_nvp(name, val);
+    }
+    else
+    {
+        boost::archive::xml_oarchive ar(os);
+        ar << boost::serialization::make_nvp(name, val);
+    }
+}
+
+template<typename T>
+inline
+void encode_packet(int encoding, const T& val, const char* name, std::string& packet)
+{
+    if (encoding == encodings::xml && fast_encode(val, name, packet)) { return; }
+    encode_archive(encoding, val, name, packet);
+}
+
+template<typename T>
+inline
+void encode_archive(int encoding, const T& val, const char* name, std::string& packet)
+{
+    std::ostringstream ss(std::ios_base::out|std::ios_base::binary);
+    encode_stream(encoding, val, name, ss);
+    packet = ss.str();
+}
+
+template<typename T>
+inline
+std::streamsize encoded_size(int encoding, const T& val, const char* name)
+{
+    counting_streambuf counter;
+    std::ostream os(&counter);
+    encode_stream(encoding, val, name, os);
+    return counter.count();
+}
+
+template<typename T>
+inline
+void decode_packet(const char* data, std::size_t size, const char* name, T& val)
+{
+    if (packet_encoding(data, size) == encodings::xml && fast_decode(data, size, name, val)) { return; }
+    decode_archive(data, size, name, val);
+}
+
+template<typename T>
+void decode_archive(const char* data, std::size_t size, const char* name, T& val)
+{
+    // decodes in place, the packet is not copied into a string stream
+    array_streambuf buf(data, size);
+    std::istream is(&buf);
+    if (packet_encoding(data, size) == encodings::binary)
+    {
+        boost::archive::binary_iarchive ar(is);
+        ar >> boost::serialization::make_nvp(name, val);
+    }
+    else
+    {
+        boost::archive::xml_iarchive ar(is);
+        ar >> boost::serialization::make_nvp(name, val);
+    }
+}
+
+template<typename T>
+inline
+void decode_packet(const std::string& packet, const char* name, T& val)
+{
+    decode_packet(packet.data(), packet.size(), name, val);
+}
+
+} // namespace eureqa
+
+#endif // EUREQA_PACKET_H
@@ -0,0 +1,140 @@
+#ifndef EUREQA_PACKET_STREAM_H
+#define EUREQA_PACKET_STREAM_H
+
+#include <streambuf>
+#include <vector>
+#include <boost/asio.hpp>
+#include <boost/array.hpp>
+
+namespace eureqa
+{
+// stream buffer that discards everything written to it and counts the bytes,
+// used to size a packet before streaming it
+class counting_streambuf : public std::streambuf
+{
+protected:
+    std::streamsize count_;
+
+public:
+    counting_streambuf() : count_(0) { }
+    std::streamsize count() const { return count_; }
+
+protected:
+    virtual int_type overflow(int_type c);
+    virtual std::streamsize xsputn(const char*, std::streamsize n) { count_ += n; return n; }
+};
+
+// read-only stream buffer over memory owned by someone else,
+// lets archives decode a received packet in place
+class array_streambuf : public std::streambuf
+{
+public:
+    array_streambuf(const char* data, std::size_t size)
+    {
+        char* begin = const_cast<char*>(data);
+        setg(begin, begin, begin + size);
+    }
+};
+
+// stream buffer that writes straight to a socket
+// small writes are gathered in a buffer, large ones (such as the binary blocks
+// of a data set) are sent from the caller's memory together with whatever is buffered
+template<typename SyncWriteStream>
+class socket_streambuf : public std::streambuf
+{
+protected:
+    SyncWriteStream& stream_;
+    std::vector<char> buffer_;
+    boost::system::error_code error_;
+    std::streamsize written_;
+
+public:
+    socket_streambuf(SyncWriteStream& stream, std::size_t buffer_size = 64*1024);
+    ~socket_streambuf() { flush(); }
+
+    // sends anything left in the buffer, returns false once any write failed
+    bool flush();
+    boost::system::error_code error() const { return error_; }
+
+    // total bytes handed to the socket so far
+    std::streamsize written() const { return written_; }
+
+protected:
+    bool write_through(const char* s, std::streamsize n);
+    virtual int_type overflow(int_type c);
+    virtual std::streamsize xsputn(const char* s, std::streamsize n);
+    // archives flush their stream when constructed, which must not send the packet header
+    // on its own, so only flush() writes to the socket
+    virtual int sync() { return error_ ? -1 : 0; }
+};
+
+/*---------------------------------------------------------
+    Implementation:
+*--------------------------------------------------------*/
+inline
+counting_streambuf::int_type counting_streambuf::overflow(int_type c)
+{
+    if (!traits_type::eq_int_type(c, traits_type::eof())) { ++count_; }
+    return traits_type::not_eof(c);
+}
+
+template<typename SyncWriteStream>
+inline
+socket_streambuf<SyncWriteStream>::socket_streambuf(SyncWriteStream& stream, std::size_t buffer_size) :
+    stream_(stream),
+    buffer_(buffer_size),
+    written_(0)
+{
+    setp(&buffer_[0], &buffer_[0] + buffer_.size());
+}
+
+template<typename SyncWriteStream>
+inline
+bool socket_streambuf<SyncWriteStream>::flush()
+{
+    return write_through(0, 0);
+}
+
+template<typename SyncWriteStream>
+inline
+bool socket_streambuf<SyncWriteStream>::write_through(const char* s, std::streamsize n)
+{
+    // send the buffered bytes and the caller's bytes in one gather write
+    if (error_) { return false; }
+    std::size_t buffered = pptr() - pbase();
+    if (buffered + n == 0) { return true; }
+    boost::array<boost::asio::const_buffer, 2> packet = {{ boost::asio::buffer(pbase(), buffered), boost::asio::buffer(s, (std::size_t)n) }};
+    boost::asio::write(stream_, packet, boost::asio::transfer_all(), error_);
+    setp(&buffer_[0], &buffer_[0] + buffer_.size());
+    if (!error_) { written_ += buffered + n; }
+    return !error_;
+}
+
+template<typename SyncWriteStream>
+inline
+typename socket_streambuf<SyncWriteStream>::int_type socket_streambuf<SyncWriteStream>::overflow(int_type c)
+{
+    if (!flush()) { return traits_type::eof(); }
+    if (!traits_type::eq_int_type(c, traits_type::eof())) { *pptr() = traits_type::to_char_type(c); pbump(1); }
+    return traits_type::not_eof(c);
+}
+
+template<typename SyncWriteStream>
+inline
+std::streamsize socket_streambuf<SyncWriteStream>::xsputn(const char* s, std::streamsize n)
+{
+    // copy small writes into the buffer if they fit
+    if (n <= epptr() - pptr())
+    {
+        traits_type::copy(pptr(), s, (std::size_t)n);
+        pbump((int)n);
+        return n;
+    }
+
+    // anything else goes out directly, with no intermediate copy
+    return write_through(s, n) ? n : 0;
+}
+
+} // namespace eureqa
+
+#endif // EUREQA_PACKET_STREAM_H
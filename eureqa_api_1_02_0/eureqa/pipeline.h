@@ -0,0 +1,264 @@
+#ifndef EUREQA_PIPELINE_H
+#define EUREQA_PIPELINE_H
+
+#include <string>
+#include <vector>
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
+#include <eureqa/connection.h>
+
+namespace eureqa
+{
+// batches commands on a connection into a single round-trip
+//
+// commands are queued, then execute() writes them back-to-back in one gather
+// write and reads the responses in order; objects passed by reference to
+// queries must stay alive until execute() returns
+//
+//   eureqa::pipeline batch(conn);
+//   batch.query_progress(progress);
+//   batch.query_frontier(front);
+//   batch.execute();
+class pipeline
+{
+protected:
+    // a queued command and how to read its response
+    struct command
+    {
+        int cmd_;
+        bool has_argument_; // command is followed by a fixed int argument
+        int argument_;
+        bool has_packet_; // command is followed by a size/data packet
+        int packet_size_;
+        std::string request_;
+        bool reads_result_; // response is a command_result rather than a packet
+        boost::function<void (const char*, std::size_t)> decode_; // stores the response packet
+
+        command(int cmd) : cmd_(cmd), has_argument_(false), argument_(0), has_packet_(false),
+            packet_size_(0), reads_result_(true) { }
+    };
+
+    connection& conn_;
+    std::vector<command> commands_;
+    std::vector<command_result> results_;
+
+public:
+    pipeline(connection& conn) : conn_(conn) { }
+
+    // queue commands, as on the connection, nothing is sent until execute()
+    void send_data_set(const eureqa::data_set& data);
+    void send_data_location(std::string path);
+    void send_options(const eureqa::search_options& options);
+    void send_individuals(const std::vector<eureqa::solution_info>& individuals);
+    void query_progress(eureqa::search_progress& progress);
+    void query_server_info(eureqa::server_info& info);
+    void query_individuals(std::vector<eureqa::solution_info>& individuals, int count);
+    void query_frontier(eureqa::solution_frontier& front);
+    void query_frontier(eureqa::solution_arena& front);
+    void start_search() { commands_.push_back(command(commands::start_search)); }
+    void pause_search() { commands_.push_back(command(commands::pause_search)); }
+    void end_search() { commands_.push_back(command(commands::end_search)); }
+    void calc_solution_info(std::vector<eureqa::solution_info>& individuals);
+
+    // sends the queued commands and reads every response
+    // returns false if the connection failed, commands past the failure report an error
+    bool execute();
+
+    // per-command results of the last execute(), in the order the commands were queued
+    // queries report success once their response has been decoded
+    int size() const { return (int)results_.size(); }
+    const command_result& result(int i) const { return results_[i]; }
+    const std::vector<command_result>& results() const { return results_; }
+
+    // true if the last execute() succeeded for every command
+    bool succeeded() const;
+
+    // drops queued commands and results
+    void clear() { commands_.clear(); results_.clear(); }
+
+protected:
+    template<typename T> static void deserialize(const char* data, std::size_t size, const char* name, T* val) { decode_packet(data, size, name, *val); }
+    static void deserialize_arena_frontier(const char* data, std::size_t size, solution_arena* front);
+    void queue_packet(int cmd, const std::string& packet);
+    bool read_result(const command& c, command_result& result);
+};
+
+/*---------------------------------------------------------------------------
+    implementions:
+*--------------------------------------------------------------------------*/
+
+inline
+void pipeline::queue_packet(int cmd, const std::string& packet)
+{
+    command c(cmd);
+    c.has_packet_ = true;
+    c.request_ = packet;
+    commands_.push_back(c);
+}
+
+inline
+void pipeline::send_data_set(const eureqa::data_set& data)
+{
+    std::string packet;
+    encode_packet(conn_.encoding(), data, "data_set", packet);
+    queue_packet(commands::send_data_set, packet);
+}
+
+inline
+void pipeline::send_data_location(std::string path)
+{
+    queue_packet(commands::send_data_location, path);
+}
+
+inline
+void pipeline::send_options(const eureqa::search_options& options)
+{
+    std::string packet;
+    encode_packet(conn_.encoding(), options, "search_options", packet);
+    queue_packet(commands::send_options, packet);
+}
+
+inline
+void pipeline::send_individuals(const std::vector<eureqa::solution_info>& individuals)
+{
+    std::string packet;
+    encode_packet(conn_.encoding(), individuals, "vector_solution_info", packet);
+    queue_packet(commands::send_individuals, packet);
+}
+
+inline
+void pipeline::query_progress(eureqa::search_progress& progress)
+{
+    command c(commands::query_progress);
+    c.reads_result_ = false;
+    c.decode_ = boost::bind(&pipeline::deserialize<eureqa::search_progress>, _1, _2, "search_progress", &progress);
+    commands_.push_back(c);
+}
+
+inline
+void pipeline::query_server_info(eureqa::server_info& info)
+{
+    command c(commands::query_server_info);
+    c.reads_result_ = false;
+    c.decode_ = boost::bind(&pipeline::deserialize<eureqa::server_info>, _1, _2, "server_info", &info);
+    commands_.push_back(c);
+}
+
+inline
+void pipeline::query_individuals(std::vector<eureqa::solution_info>& individuals, int count)
+{
+    command c(commands::query_individuals);
+    c.has_argument_ = true;
+    c.argument_ = count;
+    c.reads_result_ = false;
+    c.decode_ = boost::bind(&pipeline::deserialize<std::vector<eureqa::solution_info> >, _1, _2, "vector_solution_info", &individuals);
+    commands_.push_back(c);
+}
+
+inline
+void pipeline::query_frontier(eureqa::solution_frontier& front)
+{
+    command c(commands::query_frontier);
+    c.reads_result_ = false;
+    c.decode_ = boost::bind(&pipeline::deserialize<eureqa::solution_frontier>, _1, _2, "solution_frontier", &front);
+    commands_.push_back(c);
+}
+
+inline
+void pipeline::query_frontier(eureqa::solution_arena& front)
+{
+    command c(commands::query_frontier);
+    c.reads_result_ = false;
+    c.decode_ = boost::bind(&pipeline::deserialize_arena_frontier, _1, _2, &front);
+    commands_.push_back(c);
+}
+
+inline
+void pipeline::deserialize_arena_frontier(const char* data, std::size_t size, solution_arena* front)
+{
+    solution_arena_frontier frontier(*front);
+    decode_packet(data, size, "solution_frontier", frontier);
+}
+
+inline
+void pipeline::calc_solution_info(std::vector<eureqa::solution_info>& individuals)
+{
+    std::string packet;
+    encode_packet(conn_.encoding(), individuals, "vector_solution_info", packet);
+    queue_packet(commands::calc_solution_info, packet);
+    commands_.back().reads_result_ = false;
+    commands_.back().decode_ = boost::bind(&pipeline::deserialize<std::vector<eureqa::solution_info> >, _1, _2, "vector_solution_info", &individuals);
+}
+
+inline
+bool pipeline::execute()
+{
+    results_.assign(commands_.size(), command_result(result_error, "Not sent"));
+    if (commands_.empty()) { return true; }
+    conn_.discard_sample(); // batched commands are not in the per-command statistics
+
+    // gather every command into one write
+    std::vector<boost::asio::const_buffer> request;
+    for (int i=0; i<(int)commands_.size(); ++i)
+    {
+        command& c = commands_[i];
+        request.push_back(boost::asio::buffer(&c.cmd_, sizeof(int)));
+        if (c.has_argument_) { request.push_back(boost::asio::buffer(&c.argument_, sizeof(int))); }
+        if (c.has_packet_)
+        {
+            c.packet_size_ = (int)c.request_.length();
+            request.push_back(boost::asio::buffer(&c.packet_size_, sizeof(int)));
+            request.push_back(boost::asio::buffer(c.request_));
+        }
+    }
+    bool success = conn_.write_buffers(request);
+
+    // the server answers in order, so the responses are matched up by position
+    for (int i=0; success && i<(int)commands_.size(); ++i)
+    {
+        success = read_result(commands_[i], results_[i]);
+        if (success && commands_[i].reads_result_) { conn_.last_result_ = results_[i]; }
+    }
+    commands_.clear();
+    return success;
+}
+
+inline
+bool pipeline::read_result(const command& c, command_result& result)
+{
+    result = command_result(result_error, "Connection lost");
+    if (c.reads_result_)
+    {
+        if (!conn_.read_fixed(result.value_)) { return false; }
+        if (!conn_.read_packet(result.message_)) { return false; }
+        return true;
+    }
+
+    // decoded straight out of the connection's receive buffer
+    if (!conn_.read_packet()) { return false; }
+    try
+    {
+        c.decode_(conn_.receive_buffer_.empty() ? "" : &conn_.receive_buffer_[0], conn_.received_bytes_);
+        result = command_result();
+    }
+    catch (const boost::archive::archive_exception& e)
+    {
+        // a bad packet does not upset the framing of the responses behind it
+        result = command_result(result_error, e.what());
+    }
+    return true;
+}
+
+inline
+bool pipeline::succeeded() const
+{
+    for (int i=0; i<(int)results_.size(); ++i)
+    {
+        if (!results_[i]) { return false; }
+    }
+    return true;
+}
+
+} // namespace eureqa
+
+#endif // EUREQA_PIPELINE_H
@@ -0,0 +1,481 @@
+#ifndef EUREQA_SCHEDULER_H
+#define EUREQA_SCHEDULER_H
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <boost/bind.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <eureqa/connection.h>
+
+namespace eureqa
+{
+// states of a scheduled search
+namespace job_states
+{
+static const int queued   = 0; // waiting for a server
+static const int running  = 1;
+static const int finished = 2; // reached its time or evaluation budget
+static const int failed   = 3; // no server could run it
+}
+
+// a search waiting to be placed on a server
+struct search_job
+{
+    eureqa::data_set data_;
+    eureqa::search_options options_;
+    double max_seconds_; // of searching, 0 for no limit
+    double max_evaluations_; // 0 for no limit
+
+    // filled in as it runs
+    int state_;
+    int server_; // index of the server it runs on, -1 if none
+    eureqa::search_progress progress_; // last received, from its current server
+    eureqa::solution_frontier frontier_; // everything found, carried over when it moves
+    double evaluations_; // total, over every server it ran on
+    double seconds_; // total time searching
+    int moves_; // times it was moved to a faster server
+    int retries_; // times it was queued again after its server failed
+
+    search_job() : max_seconds_(0), max_evaluations_(0), state_(job_states::queued), server_(-1),
+        evaluations_(0), seconds_(0), moves_(0), retries_(0) { }
+};
+
+// a server jobs can be placed on
+struct scheduled_server
+{
+    std::string hostname_;
+    int port_;
+    server_info info_;
+    bool available_; // answered calibration and has not failed since
+    double calibrated_eps_; // evaluations per second of the calibration search
+    double capacity_eps_; // current estimate of its total evaluations per second
+    int max_jobs_; // concurrent jobs allowed
+    int running_;
+    int failures_;
+
+    scheduled_server() : port_(default_port_tcp), available_(false), calibrated_eps_(0), capacity_eps_(0),
+        max_jobs_(1), running_(0), failures_(0) { }
+
+    // evaluations per second a job placed here next can expect, as the jobs share the server
+    double expected_eps() const { return capacity_eps_ / (running_ + 1); }
+    bool has_slot() const { return available_ && running_ < max_jobs_; }
+};
+
+struct scheduler_options
+{
+    int calibration_ms_; // length of the calibration search on each server
+    int max_jobs_per_server_; // concurrent jobs per server, 0 for one per cpu core
+    int poll_ms_; // between polls of the running jobs
+    double smoothing_; // weight of the newest throughput in the server estimates, 0 keeps the calibration
+    double move_ratio_; // a job moves when another server would run it this many times faster
+    int min_placement_ms_; // a job stays at least this long on a server before it can move
+
+    scheduler_options() : calibration_ms_(2000), max_jobs_per_server_(1), poll_ms_(1000), smoothing_(0.3),
+        move_ratio_(1.5), min_placement_ms_(10000) { }
+};
+
+// places queued searches on the servers best able to run them
+//
+// calibrate() asks every server for its cpu cores and times a short search
+// on it to measure its evaluations per second; each step() then fills the free
+// slots with queued jobs, the fastest expected placement first, polls every
+// running job concurrently, updates each server's throughput from the polls,
+// and moves a job to a server that has become much faster than its own,
+// seeding it there with the job's frontier
+//
+// a job whose server fails is queued again with its frontier, and the server
+// is left out until the next calibrate()
+//
+//   eureqa::scheduler jobs;
+//   jobs.add_server("server-a");
+//   jobs.add_server("server-b");
+//   jobs.add_job(data, options, 600);
+//   jobs.run();
+//   jobs.job(0).frontier_ ...
+class scheduler
+{
+protected:
+    struct placement
+    {
+        eureqa::connection conn_;
+        boost::posix_time::ptime started_;
+        double base_evaluations_; // the job's evaluations before this placement
+        double base_seconds_;
+        bool ok_; // last command succeeded
+        placement() : base_evaluations_(0), base_seconds_(0), ok_(false) { }
+    };
+    typedef boost::shared_ptr<placement> placement_ptr;
+
+    scheduler_options options_;
+    std::vector<scheduled_server> servers_;
+    std::vector<search_job> jobs_;
+    std::vector<placement_ptr> placements_; // one per job, null unless running
+    bool calibrated_;
+
+public:
+    scheduler(scheduler_options options = scheduler_options());
+    const scheduler_options& options() const { return options_; }
+
+    // servers and jobs, added before or while running
+    int add_server(std::string hostname, int port = default_port_tcp);
+    int add_job(const eureqa::data_set& data, const eureqa::search_options& options, double max_seconds, double max_evaluations = 0);
+
+    // a job that carries on from an earlier search, its servers are seeded with the frontier
+    int add_job(const eureqa::data_set& data, const eureqa::search_options& options, double max_seconds, double max_evaluations, const eureqa::solution_frontier& seed);
+
+    // queries every server's info and times a search on each, concurrently;
+    // the calibration search is the first job's, true if any server is available
+    bool calibrate();
+
+    // places, polls and moves jobs once, false when no job is queued or running
+    bool step();
+
+    // calibrates if needed and steps until every job is finished or failed,
+    // false if any failed
+    bool run();
+
+    // stops every running job, leaving it queued
+    void stop();
+
+    // results
+    int servers() const { return (int)servers_.size(); }
+    const scheduled_server& server(int i) const { return servers_[i]; }
+    int jobs() const { return (int)jobs_.size(); }
+    const search_job& job(int i) const { return jobs_[i]; }
+    int count(int state) const;
+
+    // evaluations per second of all the running jobs, as last polled
+    double total_eps() const;
+
+protected:
+    void calibrate_server(int i, const search_job* sample);
+    bool place(int j, int s);
+    void poll(int j);
+    void release(int j, int state);
+    int best_server(int exclude) const;
+    void update_capacity();
+    void move_slowest();
+};
+
+/*---------------------------------------------------------------------------
+    implementions:
+*--------------------------------------------------------------------------*/
+inline
+scheduler::scheduler(scheduler_options options) :
+    options_(options),
+    calibrated_(false)
+{ }
+
+inline
+int scheduler::add_server(std::string hostname, int port)
+{
+    scheduled_server server;
+    server.hostname_ = hostname;
+    server.port_ = port;
+    servers_.push_back(server);
+    calibrated_ = false;
+    return (int)servers_.size() - 1;
+}
+
+inline
+int scheduler::add_job(const eureqa::data_set& data, const eureqa::search_options& options, double max_seconds, double max_evaluations)
+{
+    search_job job;
+    job.data_ = data;
+    job.options_ = options;
+    job.max_seconds_ = max_seconds;
+    job.max_evaluations_ = max_evaluations;
+    jobs_.push_back(job);
+    placements_.push_back(placement_ptr());
+    return (int)jobs_.size() - 1;
+}
+
+inline
+int scheduler::add_job(const eureqa::data_set& data, const eureqa::search_options& options, double max_seconds, double max_evaluations, const eureqa::solution_frontier& seed)
+{
+    int j = add_job(data, options, max_seconds, max_evaluations);
+    jobs_[j].frontier_ = seed;
+    return j;
+}
+
+inline
+bool scheduler::calibrate()
+{
+    const search_job* sample = jobs_.empty() ? 0 : &jobs_[0];
+    boost::thread_group threads;
+    for (int i=0; i<(int)servers_.size(); ++i)
+    {
+        if (servers_[i].running_ > 0) { continue; } // keeps its estimate from the polls
+        threads.create_thread(boost::bind(&scheduler::calibrate_server, this, i, sample));
+    }
+    threads.join_all();
+
+    // a server that reported no speed is rated by its cores at the average speed per core
+    double eps = 0;
+    int cores = 0;
+    for (int i=0; i<(int)servers_.size(); ++i)
+    {
+        if (!servers_[i].available_ || servers_[i].calibrated_eps_ <= 0) { continue; }
+        eps += servers_[i].calibrated_eps_;
+        cores += std::max(1, servers_[i].info_.cpu_cores_);
+    }
+    bool any = false;
+    for (int i=0; i<(int)servers_.size(); ++i)
+    {
+        scheduled_server& server = servers_[i];
+        if (!server.available_) { continue; }
+        any = true;
+        if (server.running_ > 0) { continue; }
+        double per_core = cores > 0 ? eps / cores : 1;
+        server.capacity_eps_ = server.calibrated_eps_ > 0 ? server.calibrated_eps_ : per_core * std::max(1, server.info_.cpu_cores_);
+        server.max_jobs_ = options_.max_jobs_per_server_ > 0 ? options_.max_jobs_per_server_ : std::max(1, server.info_.cpu_cores_);
+    }
+    calibrated_ = true;
+    return any;
+}
+
+inline
+void scheduler::calibrate_server(int i, const search_job* sample)
+{
+    scheduled_server& server = servers_[i];
+    server.available_ = false;
+    server.calibrated_eps_ = 0;
+
+    eureqa::connection conn;
+    if (!conn.connect(server.hostname_, server.port_)) { ++server.failures_; return; }
+    try
+    {
+        if (!conn.query_server_info(server.info_) || conn.last_result().value() != 0) { ++server.failures_; return; }
+        server.available_ = true;
+        if (sample == 0 || options_.calibration_ms_ <= 0) { return; }
+
+        // time a short run of a real search, the rate it reports once running is the server's
+        eureqa::search_progress progress;
+        if (!conn.send_data_set(sample->data_) || !conn.send_options(sample->options_) || !conn.start_search()) { return; }
+        boost::this_thread::sleep(boost::posix_time::milliseconds(options_.calibration_ms_));
+        if (conn.query_progress(progress)) { server.calibrated_eps_ = progress.evaluations_per_sec_; }
+        conn.end_search();
+    }
+    catch (const std::exception&) { server.available_ = false; ++server.failures_; }
+}
+
+inline
+bool scheduler::step()
+{
+    if (!calibrated_) { calibrate(); }
+
+    // fill the free slots, each queued job taking the fastest expected placement
+    for (int j=0; j<(int)jobs_.size(); ++j)
+    {
+        if (jobs_[j].state_ != job_states::queued) { continue; }
+        int s = best_server(-1);
+        if (s < 0) { break; }
+        place(j, s);
+    }
+
+    // poll every running job at once
+    boost::thread_group threads;
+    for (int j=0; j<(int)jobs_.size(); ++j)
+    {
+        if (jobs_[j].state_ == job_states::running) { threads.create_thread(boost::bind(&scheduler::poll, this, j)); }
+    }
+    threads.join_all();
+
+    for (int j=0; j<(int)jobs_.size(); ++j)
+    {
+        search_job& job = jobs_[j];
+        if (job.state_ != job_states::running) { continue; }
+        if (!placements_[j]->ok_)
+        {
+            // the server failed, the job goes back on the queue with what it found
+            scheduled_server& server = servers_[job.server_];
+            server.available_ = false;
+            ++server.failures_;
+            ++job.retries_;
+            release(j, job_states::queued);
+            continue;
+        }
+        if ((job.max_seconds_ > 0 && job.seconds_ >= job.max_seconds_) || (job.max_evaluations_ > 0 && job.evaluations_ >= job.max_evaluations_))
+        {
+            placements_[j]->conn_.end_search();
+            release(j, job_states::finished);
+        }
+    }
+    update_capacity();
+    move_slowest();
+
+    // queued jobs with no server left to run them have failed
+    int queued = count(job_states::queued);
+    int running = count(job_states::running);
+    if (queued > 0 && running == 0 && best_server(-1) < 0)
+    {
+        for (int j=0; j<(int)jobs_.size(); ++j) { if (jobs_[j].state_ == job_states::queued) { jobs_[j].state_ = job_states::failed; } }
+        return false;
+    }
+    return queued + running > 0;
+}
+
+inline
+bool scheduler::run()
+{
+    if (!calibrated_ && !calibrate()) { return false; }
+    while (step()) { boost::this_thread::sleep(boost::posix_time::milliseconds(options_.poll_ms_)); }
+    return count(job_states::failed) == 0;
+}
+
+inline
+void scheduler::stop()
+{
+    for (int j=0; j<(int)jobs_.size(); ++j)
+    {
+        if (jobs_[j].state_ != job_states::running) { continue; }
+        placements_[j]->conn_.end_search();
+        release(j, job_states::queued);
+    }
+}
+
+inline
+int scheduler::count(int state) const
+{
+    int n = 0;
+    for (int j=0; j<(int)jobs_.size(); ++j) { n += jobs_[j].state_ == state ? 1 : 0; }
+    return n;
+}
+
+inline
+double scheduler::total_eps() const
+{
+    double eps = 0;
+    for (int j=0; j<(int)jobs_.size(); ++j)
+    {
+        if (jobs_[j].state_ == job_states::running) { eps += jobs_[j].progress_.evaluations_per_sec_; }
+    }
+    return eps;
+}
+
+inline
+bool scheduler::place(int j, int s)
+{
+    search_job& job = jobs_[j];
+    scheduled_server& server = servers_[s];
+    placement_ptr p(new placement());
+    p->base_evaluations_ = job.evaluations_;
+    p->base_seconds_ = job.seconds_;
+    try
+    {
+        p->ok_ = p->conn_.connect(server.hostname_, server.port_)
+            && p->conn_.send_data_set(job.data_)
+            && p->conn_.send_options(job.options_);
+        if (p->ok_ && job.frontier_.size() > 0)
+        {
+            // carry on from where it left off
+            std::vector<eureqa::solution_info> individuals;
+            for (int i=0; i<job.frontier_.size(); ++i) { individuals.push_back(job.frontier_[i]); }
+            p->ok_ = p->conn_.send_individuals(individuals);
+        }
+        p->ok_ = p->ok_ && p->conn_.start_search() && p->conn_.last_result().value() == 0;
+    }
+    catch (const std::exception&) { p->ok_ = false; }
+
+    if (!p->ok_)
+    {
+        server.available_ = false;
+        ++server.failures_;
+        return false;
+    }
+    p->started_ = boost::posix_time::microsec_clock::universal_time();
+    placements_[j] = p;
+    job.state_ = job_states::running;
+    job.server_ = s;
+    job.progress_ = eureqa::search_progress();
+    ++server.running_;
+    return true;
+}
+
+inline
+void scheduler::poll(int j)
+{
+    search_job& job = jobs_[j];
+    placement& p = *placements_[j];
+    try
+    {
+        p.ok_ = p.conn_.query_progress(job.progress_);
+        if (p.ok_ && !job.progress_.solution_.text_.empty()) { job.frontier_.add(job.progress_.solution_); }
+    }
+    catch (const std::exception&) { p.ok_ = false; }
+    if (!p.ok_) { return; }
+    job.evaluations_ = p.base_evaluations_ + job.progress_.evaluations_;
+    job.seconds_ = p.base_seconds_ + (boost::posix_time::microsec_clock::universal_time() - p.started_).total_microseconds() / 1e6;
+}
+
+inline
+void scheduler::release(int j, int state)
+{
+    search_job& job = jobs_[j];
+    if (job.server_ >= 0) { --servers_[job.server_].running_; }
+    placements_[j]->conn_.disconnect();
+    placements_[j].reset();
+    job.state_ = state;
+    job.server_ = -1;
+}
+
+inline
+int scheduler::best_server(int exclude) const
+{
+    int best = -1;
+    for (int s=0; s<(int)servers_.size(); ++s)
+    {
+        if (s == exclude || !servers_[s].has_slot()) { continue; }
+        if (best < 0 || servers_[s].expected_eps() > servers_[best].expected_eps()) { best = s; }
+    }
+    return best;
+}
+
+inline
+void scheduler::update_capacity()
+{
+    // a busy server's capacity follows the throughput of its jobs
+    std::vector<double> eps(servers_.size(), 0);
+    for (int j=0; j<(int)jobs_.size(); ++j)
+    {
+        if (jobs_[j].state_ == job_states::running) { eps[jobs_[j].server_] += jobs_[j].progress_.evaluations_per_sec_; }
+    }
+    for (int s=0; s<(int)servers_.size(); ++s)
+    {
+        scheduled_server& server = servers_[s];
+        if (server.running_ == 0 || eps[s] <= 0) { continue; }
+        server.capacity_eps_ = (1 - options_.smoothing_) * server.capacity_eps_ + options_.smoothing_ * eps[s];
+    }
+}
+
+inline
+void scheduler::move_slowest()
+{
+    // at most one move a step, the job that gains the most
+    boost::posix_time::ptime now = boost::posix_time::microsec_clock::universal_time();
+    int move = -1, to = -1;
+    double gain = options_.move_ratio_;
+    for (int j=0; j<(int)jobs_.size(); ++j)
+    {
+        const search_job& job = jobs_[j];
+        if (job.state_ != job_states::running || job.progress_.evaluations_per_sec_ <= 0) { continue; }
+        if ((now - placements_[j]->started_).total_milliseconds() < options_.min_placement_ms_) { continue; }
+        int s = best_server(job.server_);
+        if (s < 0) { continue; }
+        double ratio = servers_[s].expected_eps() / job.progress_.evaluations_per_sec_;
+        if (ratio > gain) { gain = ratio; move = j; to = s; }
+    }
+    if (move < 0) { return; }
+
+    search_job& job = jobs_[move];
+    placements_[move]->conn_.end_search();
+    release(move, job_states::queued);
+    if (place(move, to)) { ++job.moves_; }
+}
+
+} // namespace eureqa
+
+#endif // EUREQA_SCHEDULER_H
@@ -0,0 +1,307 @@
+#ifndef EUREQA_SESSION_H
+#define EUREQA_SESSION_H
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <eureqa/connection.h>
+
+namespace eureqa
+{
+// how a session reconnects after losing its server
+struct reconnect_policy
+{
+    int attempts_; // attempts per outage before giving up, 0 never reconnects
+    int initial_ms_; // wait before the first attempt
+    int max_ms_; // longest wait between attempts
+    double multiplier_; // growth of the wait after each failed attempt
+
+    reconnect_policy(int attempts = 8) : attempts_(attempts), initial_ms_(250), max_ms_(30000), multiplier_(2.0) { }
+};
+
+// a search that survives its connection dropping
+//
+// remembers the data set, search options and the solution frontier seen so far;
+// when a command fails because the connection was lost, the session reconnects
+// with exponential backoff, re-sends the data set and options, seeds the server's
+// population with the frontier, restarts the search if it was running, and then
+// retries the command
+//
+//   eureqa::session search(conn);
+//   search.connect("eureqa-server");
+//   search.send_data_set(data);
+//   search.send_options(options);
+//   search.start_search();
+//   while (search.query_progress(progress)) { ... }
+class session
+{
+protected:
+    connection& conn_;
+    reconnect_policy policy_;
+    std::string hostname_;
+    int port_;
+    bool active_; // between connect() and disconnect(), or an outage that could not be restored
+    eureqa::data_set data_;
+    bool has_data_;
+    std::string data_location_; // instead of data_, when the server was told to load a file
+    eureqa::search_options options_;
+    bool has_options_;
+    bool searching_; // started and not paused or ended
+    eureqa::solution_frontier frontier_;
+    int reconnects_;
+    boost::mutex mutex_;
+    boost::condition_variable wake_;
+    bool cancelled_;
+
+public:
+    session(connection& conn, reconnect_policy policy = reconnect_policy());
+
+    // how lost connections are restored
+    void set_policy(const reconnect_policy& policy) { policy_ = policy; }
+    const reconnect_policy& policy() const { return policy_; }
+
+    // connects to a server and begins a new session, the frontier is kept
+    bool connect(std::string hostname, int port = default_port_tcp);
+
+    // ends the session, nothing is restored until the next connect()
+    void disconnect() { active_ = false; searching_ = false; conn_.disconnect(); }
+
+    // tests if the session is connected, or will reconnect on its next command
+    bool is_connected() const { return conn_.is_connected() || (active_ && policy_.attempts_ > 0); }
+
+    // makes a command blocked on another thread, including a wait between
+    // reconnect attempts, fail promptly without reconnecting
+    void cancel();
+
+    // commands, as on the connection, but remembered and restored after an outage
+    bool send_data_set(const eureqa::data_set& data);
+    bool send_data_location(std::string path);
+    bool send_options(const eureqa::search_options& options);
+    bool start_search();
+    bool pause_search();
+    bool end_search();
+
+    // queries, the solutions received are added to the frontier
+    bool query_progress(eureqa::search_progress& progress);
+    bool query_frontier(eureqa::solution_frontier& front);
+    bool query_frontier(eureqa::solution_arena& front);
+
+    // the solutions the server is seeded with after reconnecting
+    eureqa::solution_frontier& frontier() { return frontier_; }
+    const eureqa::solution_frontier& frontier() const { return frontier_; }
+
+    // number of times the session has been restored
+    int reconnects() const { return reconnects_; }
+
+    // the underlying connection
+    connection& conn() { return conn_; }
+
+protected:
+    void begin_command();
+    bool restore();
+    bool replay();
+    bool wait(int ms);
+    void add_to_frontier(const eureqa::solution_info& soln) { if (!soln.text_.empty()) { frontier_.add(soln); } }
+};
+
+/*---------------------------------------------------------------------------
+    implementions:
+*--------------------------------------------------------------------------*/
+inline
+session::session(connection& conn, reconnect_policy policy) :
+    conn_(conn),
+    policy_(policy),
+    port_(default_port_tcp),
+    active_(false),
+    has_data_(false),
+    has_options_(false),
+    searching_(false),
+    reconnects_(0),
+    cancelled_(false)
+{ }
+
+inline
+bool session::connect(std::string hostname, int port)
+{
+    begin_command();
+    hostname_ = hostname;
+    port_ = port;
+    has_data_ = false;
+    data_location_.clear();
+    has_options_ = false;
+    searching_ = false;
+    reconnects_ = 0;
+    active_ = conn_.connect(hostname, port);
+    return active_;
+}
+
+inline
+void session::cancel()
+{
+    {
+        boost::mutex::scoped_lock lock(mutex_);
+        cancelled_ = true;
+    }
+    wake_.notify_all();
+    conn_.cancel();
+}
+
+inline
+bool session::send_data_set(const eureqa::data_set& data)
+{
+    begin_command();
+    data_ = data;
+    has_data_ = true;
+    data_location_.clear();
+    if (conn_.is_connected() && conn_.send_data_set(data_)) { return true; }
+    if (conn_.is_connected()) { return false; }
+    return restore(); // re-sends it
+}
+
+inline
+bool session::send_data_location(std::string path)
+{
+    begin_command();
+    data_location_ = path;
+    has_data_ = false;
+    if (conn_.is_connected() && conn_.send_data_location(path)) { return true; }
+    if (conn_.is_connected()) { return false; }
+    return restore();
+}
+
+inline
+bool session::send_options(const eureqa::search_options& options)
+{
+    begin_command();
+    options_ = options;
+    has_options_ = true;
+    if (conn_.is_connected() && conn_.send_options(options_)) { return true; }
+    if (conn_.is_connected()) { return false; }
+    return restore();
+}
+
+inline
+bool session::start_search()
+{
+    begin_command();
+    searching_ = true;
+    if (conn_.is_connected() && conn_.start_search()) { return true; }
+    if (conn_.is_connected()) { return false; }
+    return restore();
+}
+
+inline
+bool session::pause_search()
+{
+    begin_command();
+    searching_ = false;
+    if (conn_.is_connected() && conn_.pause_search()) { return true; }
+    if (conn_.is_connected()) { return false; }
+    return restore(); // a restored search is left paused
+}
+
+inline
+bool session::end_search()
+{
+    begin_command();
+    searching_ = false;
+    if (conn_.is_connected() && conn_.end_search()) { return true; }
+    if (conn_.is_connected()) { return false; }
+    return restore();
+}
+
+inline
+bool session::query_progress(eureqa::search_progress& progress)
+{
+    begin_command();
+    bool success = conn_.is_connected() && conn_.query_progress(progress);
+    if (!success && !conn_.is_connected() && restore()) { success = conn_.query_progress(progress); }
+    if (success) { add_to_frontier(progress.solution_); }
+    return success;
+}
+
+inline
+bool session::query_frontier(eureqa::solution_frontier& front)
+{
+    begin_command();
+    bool success = conn_.is_connected() && conn_.query_frontier(front);
+    if (!success && !conn_.is_connected() && restore()) { success = conn_.query_frontier(front); }
+    if (success) { for (int i=0; i<front.size(); ++i) { add_to_frontier(front[i]); } }
+    return success;
+}
+
+inline
+bool session::query_frontier(eureqa::solution_arena& front)
+{
+    begin_command();
+    bool success = conn_.is_connected() && conn_.query_frontier(front);
+    if (!success && !conn_.is_connected() && restore()) { success = conn_.query_frontier(front); }
+    if (success) { for (int i=0; i<front.size(); ++i) { add_to_frontier(front[i]); } }
+    return success;
+}
+
+inline
+void session::begin_command()
+{
+    // a cancel() aimed at an earlier command does not carry over
+    boost::mutex::scoped_lock lock(mutex_);
+    cancelled_ = false;
+}
+
+inline
+bool session::restore()
+{
+    if (!active_ || policy_.attempts_ <= 0) { active_ = false; return false; }
+
+    double wait_ms = policy_.initial_ms_;
+    for (int i=0; i<policy_.attempts_; ++i)
+    {
+        if (!wait((int)wait_ms)) { return false; }
+        wait_ms = std::min(wait_ms * policy_.multiplier_, (double)policy_.max_ms_);
+        if (replay()) { ++reconnects_; return true; }
+        conn_.disconnect();
+    }
+
+    // the server is gone for good
+    active_ = false;
+    return false;
+}
+
+inline
+bool session::replay()
+{
+    if (!conn_.connect(hostname_, port_)) { return false; }
+    if (has_data_ && !conn_.send_data_set(data_)) { return false; }
+    if (!data_location_.empty() && !conn_.send_data_location(data_location_)) { return false; }
+    if (has_options_ && !conn_.send_options(options_)) { return false; }
+    if (frontier_.size() > 0)
+    {
+        // seed the new population with the best solutions found before the outage
+        std::vector<eureqa::solution_info> individuals;
+        individuals.reserve(frontier_.size());
+        for (int i=0; i<frontier_.size(); ++i) { individuals.push_back(frontier_[i]); }
+        if (!conn_.send_individuals(individuals)) { return false; }
+    }
+    if (searching_ && !conn_.start_search()) { return false; }
+    return true;
+}
+
+inline
+bool session::wait(int ms)
+{
+    // returns false if cancelled during the wait
+    boost::mutex::scoped_lock lock(mutex_);
+    boost::system_time until = boost::get_system_time() + boost::posix_time::milliseconds(ms);
+    while (!cancelled_)
+    {
+        if (!wake_.timed_wait(lock, until)) { break; }
+    }
+    return !cancelled_;
+}
+
+} // namespace eureqa
+
+#endif // EUREQA_SESSION_H
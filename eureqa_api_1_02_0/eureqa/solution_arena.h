@@ -0,0 +1,111 @@
+#ifndef EUREQA_SOLUTION_ARENA_H
+#define EUREQA_SOLUTION_ARENA_H
+
+#include <string>
+#include <vector>
+#include <sstream>
+#include <algorithm>
+#include <boost/serialization/nvp.hpp>
+#include <boost/serialization/split_member.hpp>
+#include <boost/serialization/collection_size_type.hpp>
+#include <boost/serialization/item_version_type.hpp>
+#include <boost/archive/basic_archive.hpp>
+#include <eureqa/solution_frontier.h>
+
+namespace eureqa
+{
+// reusable storage for the solutions decoded by one poll
+//
+// clearing keeps the solution objects and the capacity of their strings,
+// so decoding a frontier or a batch of individuals of a similar size
+// into the same arena again does not touch the heap
+class solution_arena
+{
+protected:
+    std::vector<solution_info> slots_; // never shrinks
+    int size_;
+
+public:
+    solution_arena() : size_(0) { }
+
+    // basic container functions
+    int size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    solution_info& operator [](int i) { return slots_[i]; }
+    const solution_info& operator [](int i) const { return slots_[i]; }
+    void clear() { size_ = 0; }
+
+    // returns the next free solution, reusing one from an earlier poll if possible
+    solution_info& allocate();
+
+    // adds the solutions to a frontier, copying only those that belong on it
+    void add_to(solution_frontier& front) const;
+
+protected:
+    // boost serialization, reads the same packets as a std::vector<solution_info>
+    friend class boost::serialization::access;
+    template<class TArchive> void save(TArchive& ar, const unsigned int /*version*/) const;
+    template<class TArchive> void load(TArchive& ar, const unsigned int /*version*/);
+    BOOST_SERIALIZATION_SPLIT_MEMBER()
+};
+
+// decodes a solution_frontier packet into an arena
+class solution_arena_frontier
+{
+public:
+    solution_arena& front_;
+    solution_arena_frontier(solution_arena& front) : front_(front) { }
+
+protected:
+    // boost serialization, reads the same packets as a solution_frontier
+    friend class boost::serialization::access;
+    template<class TArchive> void serialize(TArchive& ar, const unsigned int /*version*/) { ar & BOOST_SERIALIZATION_NVP( front_ ); }
+};
+
+/*---------------------------------------------------------
+    Implementation:
+*--------------------------------------------------------*/
+inline
+solution_info& solution_arena::allocate()
+{
+    if (size_ == (int)slots_.size()) { slots_.push_back(solution_info()); }
+    return slots_[size_++];
+}
+
+inline
+void solution_arena::add_to(solution_frontier& front) const
+{
+    for (int i=0; i<size_; ++i) { front.add(slots_[i]); }
+}
+
+template<class TArchive>
+inline
+void solution_arena::save(TArchive& ar, const unsigned int /*version*/) const
+{
+    // mirrors boost's collection format for std::vector
+    boost::serialization::collection_size_type count(size_);
+    ar << boost::serialization::make_nvp("count", count);
+    const boost::serialization::item_version_type item_version(boost::serialization::version<solution_info>::value);
+    ar << boost::serialization::make_nvp("item_version", item_version);
+    for (int i=0; i<size_; ++i) { ar << boost::serialization::make_nvp("item", slots_[i]); }
+}
+
+template<class TArchive>
+inline
+void solution_arena::load(TArchive& ar, const unsigned int /*version*/)
+{
+    // mirrors boost's collection format for std::vector
+    boost::serialization::collection_size_type count;
+    ar >> boost::serialization::make_nvp("count", count);
+    boost::serialization::item_version_type item_version(0);
+    if (boost::archive::library_version_type(3) < ar.get_library_version())
+    {
+        ar >> boost::serialization::make_nvp("item_version", item_version);
+    }
+    clear();
+    for (std::size_t i=0; i<count; ++i) { ar >> boost::serialization::make_nvp("item", allocate()); }
+}
+
+} // namespace eureqa
+
+#endif // EUREQA_SOLUTION_ARENA_H
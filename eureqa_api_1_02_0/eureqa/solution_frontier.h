@@ -66,6 +66,9 @@ protected:
     // can also be used for saving/loading the data set
     friend class boost::serialization::access;
     template<class TArchive> void serialize(TArchive& ar, const unsigned int /*version*/);
+    
+    // hand-written xml encoder/decoder
+    friend class xml_codec;
 };
 
 
@@ -0,0 +1,511 @@
+#ifndef EUREQA_SUPERVISOR_H
+#define EUREQA_SUPERVISOR_H
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <algorithm>
+#include <boost/bind.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <eureqa/connection.h>
+#ifndef _WIN32
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#endif
+#ifdef __linux__
+#include <sched.h>
+#include <sys/prctl.h>
+#endif
+
+namespace eureqa
+{
+// how the machine's cpus are divided between the server instances
+namespace pinnings
+{
+static const int none  = 0; // not pinned, each told to use its share of the cores
+static const int cores = 1; // each pinned to its own run of cpus
+static const int numa  = 2; // each pinned to the cpus of one numa node, shared out if there are more instances than nodes
+}
+
+struct supervisor_options
+{
+    std::string program_; // eureqa_server, looked up on the PATH if it has no directory
+    std::vector<std::string> arguments_; // passed after -port and -max_cores
+    int base_port_; // the instances listen on consecutive ports from here
+    int pinning_;
+    int check_ms_; // between health checks
+    int timeout_ms_; // a health check's connect and query must each finish within this
+    int max_failures_; // health checks in a row an instance may fail before it is restarted
+    int startup_ms_; // an instance may take this long to answer after it is launched
+    int max_restarts_; // of each instance, then it is given up on
+    std::string log_directory_; // instances write eureqa_server_<port>.log here, empty discards their output
+
+    supervisor_options() : program_("eureqa_server"), base_port_(default_port_tcp + 1), pinning_(pinnings::numa),
+        check_ms_(2000), timeout_ms_(2000), max_failures_(2), startup_ms_(10000), max_restarts_(10) { }
+};
+
+// an instance of the server the supervisor runs
+struct supervised_server
+{
+    int port_;
+    std::vector<int> cpus_; // pinned to, empty if not pinned
+    int max_cores_;
+    int pid_; // 0 while not running
+    bool healthy_; // answered its last health check
+    int failures_; // health checks failed in a row
+    int restarts_;
+    bool given_up_; // restarted max_restarts_ times
+    eureqa::server_info info_; // from its last health check
+    boost::posix_time::ptime launched_;
+
+    supervised_server() : port_(default_port_tcp), max_cores_(0), pid_(0), healthy_(false), failures_(0), restarts_(0), given_up_(false) { }
+
+    // as connect() and the cluster take it
+    std::string hostname() const { return "127.0.0.1:" + boost::lexical_cast<std::string>(port_); }
+};
+
+// runs several eureqa_server instances on this machine, on consecutive ports,
+// each pinned to its share of the cpus, so together they use the whole machine
+// without their threads competing for cores or reaching across numa nodes
+//
+// a background thread checks every instance with query_server_info and
+// restarts one that has exited or stopped answering; on linux the instances
+// are killed when the thread that launched them exits, so start() should be
+// called from a thread that lives as long as the supervisor
+//
+// only implemented on posix systems, start() fails on windows
+//
+//   eureqa::supervisor local;
+//   local.start(0); // one instance per numa node
+//   local.wait_ready(10000);
+//   cluster.connect(local.hostnames());
+//   ...
+//   local.stop();
+class supervisor
+{
+protected:
+    supervisor_options options_;
+    std::vector<supervised_server> servers_;
+    boost::scoped_ptr<boost::thread> thread_;
+    mutable boost::mutex mutex_; // guards servers_ between the health checks and the accessors
+
+public:
+    supervisor(supervisor_options options = supervisor_options());
+    ~supervisor() { stop(); }
+    const supervisor_options& options() const { return options_; }
+    void set_options(const supervisor_options& options) { options_ = options; } // used by the next start()
+
+    // launches count instances, 0 for one per numa node, and starts checking on them;
+    // true if every instance was launched
+    bool start(int count);
+
+    // waits until every instance answers; false if the time runs out, an instance
+    // is given up on or stop() is called from another thread
+    bool wait_ready(int timeout_ms);
+
+    // stops checking and stops every instance
+    void stop();
+    bool is_running() const { return thread_.get() != 0; }
+
+    // checks every instance once, on this thread, restarting those that have failed;
+    // true if they were all healthy
+    bool check();
+
+    // the instances, the hostnames of those not given up on
+    int size() const;
+    supervised_server server(int i) const;
+    std::vector<std::string> hostnames() const;
+    int restarts() const;
+
+    // the cpus this process may run on, and those of each numa node among them
+    static std::vector<int> available_cpus();
+    static std::vector<std::vector<int> > numa_nodes();
+
+    // parses a linux cpu or node list such as "0-3,8-11"
+    static std::vector<int> parse_cpu_list(std::string text);
+
+protected:
+    void assign_cpus(int count);
+    bool launch(supervised_server& server);
+    static void terminate(supervised_server& server, int wait_ms);
+    static bool has_exited(supervised_server& server);
+    static void query_server(supervised_server* server, int timeout_ms);
+    void run();
+};
+
+/*---------------------------------------------------------------------------
+    implementions:
+*--------------------------------------------------------------------------*/
+inline
+supervisor::supervisor(supervisor_options options) :
+    options_(options)
+{ }
+
+inline
+bool supervisor::start(int count)
+{
+    stop();
+    if (count <= 0) { count = (int)numa_nodes().size(); }
+    {
+        boost::mutex::scoped_lock lock(mutex_);
+        servers_.assign(count, supervised_server());
+        for (int i=0; i<count; ++i) { servers_[i].port_ = options_.base_port_ + i; }
+        assign_cpus(count);
+    }
+
+    // launched from this thread, which the instances are tied to on linux
+    bool all = true;
+    for (int i=0; i<count; ++i) { all = launch(servers_[i]) && all; }
+    thread_.reset(new boost::thread(boost::bind(&supervisor::run, this)));
+    return all;
+}
+
+inline
+bool supervisor::wait_ready(int timeout_ms)
+{
+    boost::posix_time::ptime until = boost::posix_time::microsec_clock::universal_time() + boost::posix_time::milliseconds(timeout_ms);
+    while (true)
+    {
+        {
+            boost::mutex::scoped_lock lock(mutex_);
+            bool ready = true;
+            for (int i=0; i<(int)servers_.size(); ++i)
+            {
+                if (servers_[i].given_up_ || servers_[i].pid_ == 0) { return false; }
+                ready = ready && servers_[i].healthy_;
+            }
+            if (ready) { return true; }
+        }
+        if (boost::posix_time::microsec_clock::universal_time() >= until) { return false; }
+
+        // quicker than waiting for the background checks
+        std::vector<supervised_server> probes;
+        {
+            boost::mutex::scoped_lock lock(mutex_);
+            probes = servers_;
+        }
+        {
+            boost::this_thread::disable_interruption no_interruption;
+            boost::thread_group threads;
+            for (int i=0; i<(int)probes.size(); ++i)
+            {
+                if (!probes[i].healthy_ && probes[i].pid_ != 0) { threads.create_thread(boost::bind(&supervisor::query_server, &probes[i], options_.timeout_ms_)); }
+            }
+            threads.join_all();
+        }
+        {
+            boost::mutex::scoped_lock lock(mutex_);
+            for (int i=0; i<(int)probes.size() && i<(int)servers_.size(); ++i)
+            {
+                if (probes[i].healthy_ && probes[i].pid_ == servers_[i].pid_) { servers_[i].healthy_ = true; servers_[i].info_ = probes[i].info_; }
+            }
+        }
+        boost::this_thread::sleep(boost::posix_time::milliseconds(100));
+    }
+}
+
+inline
+void supervisor::stop()
+{
+    if (thread_)
+    {
+        thread_->interrupt();
+        thread_->join();
+        thread_.reset();
+    }
+    boost::mutex::scoped_lock lock(mutex_);
+    for (int i=0; i<(int)servers_.size(); ++i) { terminate(servers_[i], 2000); }
+}
+
+inline
+bool supervisor::check()
+{
+    std::vector<supervised_server> probes;
+    {
+        boost::mutex::scoped_lock lock(mutex_);
+        probes = servers_;
+    }
+
+    // query every running instance at once; join_all() is an interruption point,
+    // and stop() must not leave the queries writing to probes once it is gone,
+    // so they are always joined, which takes at most timeout_ms_
+    {
+        boost::this_thread::disable_interruption no_interruption;
+        boost::thread_group threads;
+        for (int i=0; i<(int)probes.size(); ++i)
+        {
+            if (probes[i].pid_ != 0) { threads.create_thread(boost::bind(&supervisor::query_server, &probes[i], options_.timeout_ms_)); }
+        }
+        threads.join_all();
+    }
+
+    boost::mutex::scoped_lock lock(mutex_);
+    boost::posix_time::ptime now = boost::posix_time::microsec_clock::universal_time();
+    bool all = true;
+    for (int i=0; i<(int)servers_.size() && i<(int)probes.size(); ++i)
+    {
+        supervised_server& server = servers_[i];
+        if (server.given_up_) { all = false; continue; }
+        bool exited = has_exited(server);
+        if (!exited && probes[i].pid_ == server.pid_)
+        {
+            server.healthy_ = probes[i].healthy_;
+            if (server.healthy_) { server.info_ = probes[i].info_; server.failures_ = 0; continue; }
+
+            // still starting up, or not answering for max_failures_ checks in a row
+            if ((now - server.launched_).total_milliseconds() < options_.startup_ms_) { all = false; continue; }
+            if (++server.failures_ < options_.max_failures_) { all = false; continue; }
+        }
+        all = false;
+        terminate(server, 0);
+        if (server.restarts_ >= options_.max_restarts_) { server.given_up_ = true; continue; }
+        ++server.restarts_;
+        launch(server);
+    }
+    return all;
+}
+
+inline
+int supervisor::size() const
+{
+    boost::mutex::scoped_lock lock(mutex_);
+    return (int)servers_.size();
+}
+
+inline
+supervised_server supervisor::server(int i) const
+{
+    boost::mutex::scoped_lock lock(mutex_);
+    return servers_[i];
+}
+
+inline
+std::vector<std::string> supervisor::hostnames() const
+{
+    boost::mutex::scoped_lock lock(mutex_);
+    std::vector<std::string> hosts;
+    for (int i=0; i<(int)servers_.size(); ++i) { if (!servers_[i].given_up_) { hosts.push_back(servers_[i].hostname()); } }
+    return hosts;
+}
+
+inline
+int supervisor::restarts() const
+{
+    boost::mutex::scoped_lock lock(mutex_);
+    int n = 0;
+    for (int i=0; i<(int)servers_.size(); ++i) { n += servers_[i].restarts_; }
+    return n;
+}
+
+inline
+std::vector<int> supervisor::available_cpus()
+{
+    std::vector<int> cpus;
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0)
+    {
+        for (int c=0; c<CPU_SETSIZE; ++c) { if (CPU_ISSET(c, &set)) { cpus.push_back(c); } }
+    }
+#endif
+    if (cpus.empty())
+    {
+        int n = std::max(1, (int)boost::thread::hardware_concurrency());
+        for (int c=0; c<n; ++c) { cpus.push_back(c); }
+    }
+    return cpus;
+}
+
+inline
+std::vector<std::vector<int> > supervisor::numa_nodes()
+{
+    // the online nodes' cpu lists from sysfs, less the cpus this process may not use
+    std::vector<int> available = available_cpus();
+    std::vector<std::vector<int> > nodes;
+    std::string text;
+    std::ifstream online("/sys/devices/system/node/online");
+    std::getline(online, text);
+    std::vector<int> ids = parse_cpu_list(text);
+    for (int n=0; n<(int)ids.size(); ++n)
+    {
+        std::ifstream file(("/sys/devices/system/node/node" + boost::lexical_cast<std::string>(ids[n]) + "/cpulist").c_str());
+        text.clear();
+        std::getline(file, text);
+        std::vector<int> cpus = parse_cpu_list(text), node;
+        for (int i=0; i<(int)cpus.size(); ++i)
+        {
+            if (std::find(available.begin(), available.end(), cpus[i]) != available.end()) { node.push_back(cpus[i]); }
+        }
+        if (!node.empty()) { nodes.push_back(node); }
+    }
+    if (nodes.empty()) { nodes.push_back(available); }
+    return nodes;
+}
+
+inline
+std::vector<int> supervisor::parse_cpu_list(std::string text)
+{
+    std::vector<int> cpus;
+    std::istringstream is(text);
+    std::string range;
+    while (std::getline(is, range, ','))
+    {
+        if (range.find_first_of("0123456789") == std::string::npos) { continue; }
+        int first = std::atoi(range.c_str());
+        std::string::size_type dash = range.find('-');
+        int last = (dash == std::string::npos) ? first : std::atoi(range.c_str() + dash + 1);
+        for (int c=first; c<=last; ++c) { cpus.push_back(c); }
+    }
+    return cpus;
+}
+
+inline
+void supervisor::assign_cpus(int count)
+{
+    // each group of cpus is split into even runs among the instances given it
+    std::vector<std::vector<int> > groups;
+    if (options_.pinning_ == pinnings::numa) { groups = numa_nodes(); }
+    else { groups.push_back(available_cpus()); }
+
+    int total = 0;
+    for (int g=0; g<(int)groups.size(); ++g) { total += (int)groups[g].size(); }
+    for (int g=0; g<(int)groups.size(); ++g)
+    {
+        std::vector<int> members;
+        for (int i=g; i<count; i+=(int)groups.size()) { members.push_back(i); }
+        const std::vector<int>& cpus = groups[g];
+        int m = (int)members.size();
+        for (int k=0; k<m; ++k)
+        {
+            supervised_server& server = servers_[members[k]];
+            int first = (int)cpus.size() * k / m;
+            int last = std::max(first + 1, (int)cpus.size() * (k + 1) / m);
+            server.cpus_.clear();
+            for (int c=first; c<last; ++c) { server.cpus_.push_back(cpus[c % cpus.size()]); }
+            server.max_cores_ = (int)server.cpus_.size();
+        }
+    }
+    if (options_.pinning_ == pinnings::none)
+    {
+        for (int i=0; i<count; ++i) { servers_[i].cpus_.clear(); servers_[i].max_cores_ = std::max(1, total / count); }
+    }
+}
+
+inline
+bool supervisor::launch(supervised_server& server)
+{
+    server.pid_ = 0;
+    server.healthy_ = false;
+    server.failures_ = 0;
+    server.launched_ = boost::posix_time::microsec_clock::universal_time();
+#ifdef _WIN32
+    return false;
+#else
+    // everything the child needs is prepared before the fork
+    std::vector<std::string> args;
+    args.push_back(options_.program_);
+    args.push_back("-port");
+    args.push_back(boost::lexical_cast<std::string>(server.port_));
+    args.push_back("-max_cores");
+    args.push_back(boost::lexical_cast<std::string>(server.max_cores_));
+    args.insert(args.end(), options_.arguments_.begin(), options_.arguments_.end());
+    std::vector<char*> argv;
+    for (int i=0; i<(int)args.size(); ++i) { argv.push_back(const_cast<char*>(args[i].c_str())); }
+    argv.push_back(0);
+    std::string log = options_.log_directory_.empty() ? std::string("/dev/null")
+        : options_.log_directory_ + "/eureqa_server_" + boost::lexical_cast<std::string>(server.port_) + ".log";
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int i=0; i<(int)server.cpus_.size(); ++i) { CPU_SET(server.cpus_[i], &set); }
+#endif
+
+    pid_t pid = fork();
+    if (pid < 0) { return false; }
+    if (pid == 0)
+    {
+#ifdef __linux__
+        prctl(PR_SET_PDEATHSIG, SIGTERM);
+        if (!server.cpus_.empty()) { sched_setaffinity(0, sizeof(set), &set); }
+#endif
+        int out = open(log.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+        if (out >= 0) { dup2(out, 1); dup2(out, 2); close(out); }
+        execvp(argv[0], &argv[0]);
+        _exit(127);
+    }
+    server.pid_ = (int)pid;
+    return true;
+#endif
+}
+
+inline
+void supervisor::terminate(supervised_server& server, int wait_ms)
+{
+#ifndef _WIN32
+    if (server.pid_ == 0) { return; }
+    if (wait_ms > 0)
+    {
+        // a chance to exit cleanly before it is killed
+        kill(server.pid_, SIGTERM);
+        for (int waited=0; waited<wait_ms; waited+=20)
+        {
+            if (has_exited(server)) { return; }
+            boost::this_thread::sleep(boost::posix_time::milliseconds(20));
+        }
+    }
+    kill(server.pid_, SIGKILL);
+    waitpid(server.pid_, 0, 0);
+#endif
+    server.pid_ = 0;
+    server.healthy_ = false;
+}
+
+inline
+bool supervisor::has_exited(supervised_server& server)
+{
+    if (server.pid_ == 0) { return true; }
+#ifndef _WIN32
+    if (waitpid(server.pid_, 0, WNOHANG) == 0) { return false; }
+#endif
+    server.pid_ = 0;
+    server.healthy_ = false;
+    return true;
+}
+
+inline
+void supervisor::query_server(supervised_server* server, int timeout_ms)
+{
+    eureqa::connection conn;
+    conn.set_deadlines(connection_deadlines(timeout_ms, timeout_ms, timeout_ms));
+    try { server->healthy_ = conn.connect("127.0.0.1", server->port_) && conn.query_server_info(server->info_) && conn.last_result().value() == 0; }
+    catch (const std::exception&) { server->healthy_ = false; }
+    conn.disconnect();
+}
+
+inline
+void supervisor::run()
+{
+    try
+    {
+        while (true)
+        {
+            boost::this_thread::sleep(boost::posix_time::milliseconds(options_.check_ms_));
+            check();
+        }
+    }
+    catch (const boost::thread_interrupted&) { }
+}
+
+} // namespace eureqa
+
+#endif // EUREQA_SUPERVISOR_H
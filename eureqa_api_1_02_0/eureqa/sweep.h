@@ -0,0 +1,340 @@
+#ifndef EUREQA_SWEEP_H
+#define EUREQA_SWEEP_H
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <boost/bind.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <eureqa/connection.h>
+
+namespace eureqa
+{
+struct sweep_options
+{
+    double max_generations_; // each search ends after this many generations, 0 for no limit
+    double max_seconds_; // or this long, 0 for no limit; one of the two limits must be set
+    int poll_ms_; // between progress queries
+    int max_attempts_; // servers a search is tried on before it fails
+
+    sweep_options() : max_generations_(1000), max_seconds_(0), poll_ms_(1000), max_attempts_(2) { }
+};
+
+// one search of a sweep
+struct sweep_result
+{
+    int data_set_; // indices of the combination
+    int relationship_;
+    int options_;
+    bool done_; // the search ran to its limit
+    bool failed_;
+    int attempts_;
+    int server_; // that ran it, -1 if none
+    eureqa::search_progress progress_; // last received
+    eureqa::solution_frontier frontier_;
+    double seconds_;
+
+    sweep_result() : data_set_(0), relationship_(0), options_(0), done_(false), failed_(false), attempts_(0), server_(-1), seconds_(0) { }
+};
+
+// runs every combination of data sets, search relationships and option sets
+// across several servers
+//
+// each server takes the searches one at a time on its own thread, preferring
+// those on the data set it already holds, so a data set is uploaded at most
+// once to each server; a search whose server fails is tried on another
+//
+//   eureqa::sweep runs;
+//   runs.add_data_set(data);
+//   runs.add_relationship("y = f(x)");
+//   runs.add_relationship("y = f(x, t)");
+//   runs.add_options(options_a);
+//   runs.add_options(options_b);
+//   runs.run(hostnames);
+//   runs.result(0, 1, 0).frontier_ ...
+class sweep
+{
+protected:
+    struct worker
+    {
+        std::string hostname_;
+        int port_;
+        eureqa::connection conn_;
+        int data_set_; // uploaded to the server, -1 if none
+        int holding_; // data set of the search it took last, seen by the other workers
+        int uploads_;
+        int searches_;
+        bool failed_;
+        worker() : port_(default_port_tcp), data_set_(-1), holding_(-1), uploads_(0), searches_(0), failed_(false) { }
+    };
+    typedef boost::shared_ptr<worker> worker_ptr;
+
+    sweep_options options_;
+    std::vector<eureqa::data_set> data_sets_;
+    std::vector<std::string> relationships_;
+    std::vector<eureqa::search_options> option_sets_;
+    std::vector<sweep_result> results_;
+    std::vector<char> taken_; // per result, handed to a worker
+    std::vector<worker_ptr> workers_;
+    boost::mutex mutex_; // guards taken_, results_ and the workers' counters while running
+    boost::condition_variable released_; // a search ended, and may have been given back
+    int running_; // searches taken and not yet ended
+    bool cancelled_;
+
+public:
+    sweep(sweep_options options = sweep_options());
+    const sweep_options& options() const { return options_; }
+    void set_options(const sweep_options& options) { options_ = options; }
+
+    // the dimensions of the sweep, each returns the new index
+    int add_data_set(const eureqa::data_set& data);
+    int add_relationship(std::string relationship);
+    int add_options(const eureqa::search_options& options); // its search relationship is replaced
+    void clear();
+
+    // runs every combination, the servers may end in :port;
+    // true if every search ran to its limit, false without running any if neither limit is set
+    bool run(const std::vector<std::string>& hostnames, int port = default_port_tcp);
+
+    // makes run() on another thread return promptly, the searches left are not run
+    void cancel();
+
+    // results, with no option sets added the defaults are swept as one
+    int data_sets() const { return (int)data_sets_.size(); }
+    int relationships() const { return (int)relationships_.size(); }
+    int option_sets() const { return std::max(1, (int)option_sets_.size()); }
+    int size() const { return (int)results_.size(); }
+    const sweep_result& result(int i) const { return results_[i]; }
+    const sweep_result& result(int data_set, int relationship, int options) const { return results_[index(data_set, relationship, options)]; }
+    int index(int data_set, int relationship, int options) const { return (data_set * relationships() + relationship) * option_sets() + options; }
+
+    // what was added
+    const eureqa::data_set& data(int data_set) const { return data_sets_[data_set]; }
+    const std::string& relationship(int relationship) const { return relationships_[relationship]; }
+    eureqa::search_options option_set(int options) const { return option_sets_.empty() ? eureqa::search_options() : option_sets_[options]; }
+
+    // data sets uploaded and searches run by each server in the last run()
+    int servers() const { return (int)workers_.size(); }
+    int uploads(int server) const { return workers_[server]->uploads_; }
+    int searches(int server) const { return workers_[server]->searches_; }
+
+protected:
+    void work(int w);
+    int next(worker& w);
+    bool search(worker& w, sweep_result& result);
+};
+
+/*---------------------------------------------------------------------------
+    implementions:
+*--------------------------------------------------------------------------*/
+inline
+sweep::sweep(sweep_options options) :
+    options_(options),
+    running_(0),
+    cancelled_(false)
+{ }
+
+inline
+int sweep::add_data_set(const eureqa::data_set& data)
+{
+    data_sets_.push_back(data);
+    return (int)data_sets_.size() - 1;
+}
+
+inline
+int sweep::add_relationship(std::string relationship)
+{
+    relationships_.push_back(relationship);
+    return (int)relationships_.size() - 1;
+}
+
+inline
+int sweep::add_options(const eureqa::search_options& options)
+{
+    option_sets_.push_back(options);
+    return (int)option_sets_.size() - 1;
+}
+
+inline
+void sweep::clear()
+{
+    data_sets_.clear();
+    relationships_.clear();
+    option_sets_.clear();
+    results_.clear();
+
+    // cancel() may be walking the workers
+    std::vector<worker_ptr> workers;
+    boost::mutex::scoped_lock lock(mutex_);
+    workers_.swap(workers);
+}
+
+inline
+bool sweep::run(const std::vector<std::string>& hostnames, int port)
+{
+    // every combination, in order of data set so the servers share them out
+    results_.clear();
+    for (int d=0; d<data_sets(); ++d)
+    {
+        for (int r=0; r<relationships(); ++r)
+        {
+            for (int o=0; o<option_sets(); ++o)
+            {
+                sweep_result result;
+                result.data_set_ = d;
+                result.relationship_ = r;
+                result.options_ = o;
+                results_.push_back(result);
+            }
+        }
+    }
+    taken_.assign(results_.size(), 0);
+
+    std::vector<worker_ptr> workers;
+    for (int i=0; i<(int)hostnames.size(); ++i)
+    {
+        worker_ptr w(new worker());
+        w->port_ = port;
+        eureqa::connection::parse_address(hostnames[i], w->hostname_, w->port_);
+        workers.push_back(w);
+    }
+    {
+        // cancel() may be walking the workers of the last run
+        boost::mutex::scoped_lock lock(mutex_);
+        workers_.swap(workers);
+        running_ = 0;
+        cancelled_ = false;
+    }
+    workers.clear();
+
+    // a search with no limit would never end, so then none are run
+    boost::thread_group threads;
+    bool limited = options_.max_generations_ > 0 || options_.max_seconds_ > 0;
+    for (int i=0; limited && i<(int)workers_.size(); ++i) { threads.create_thread(boost::bind(&sweep::work, this, i)); }
+    threads.join_all();
+
+    // searches no server could run have failed
+    bool all = !results_.empty();
+    for (int i=0; i<(int)results_.size(); ++i)
+    {
+        if (!results_[i].done_) { results_[i].failed_ = true; all = false; }
+    }
+    return all;
+}
+
+inline
+void sweep::cancel()
+{
+    boost::mutex::scoped_lock lock(mutex_);
+    cancelled_ = true;
+    for (int i=0; i<(int)workers_.size(); ++i) { workers_[i]->conn_.cancel(); }
+    released_.notify_all();
+}
+
+inline
+void sweep::work(int i)
+{
+    worker& w = *workers_[i];
+    if (!w.conn_.connect(w.hostname_, w.port_)) { w.failed_ = true; return; }
+
+    for (int r = next(w); r >= 0; r = next(w))
+    {
+        sweep_result& result = results_[r];
+        bool ok = false;
+        try { ok = search(w, result); }
+        catch (const std::exception&) { ok = false; }
+
+        boost::mutex::scoped_lock lock(mutex_);
+        result.server_ = i;
+        ++result.attempts_;
+        --running_;
+        released_.notify_all();
+        if (ok) { result.done_ = true; ++w.searches_; continue; }
+
+        // give it back for another server to try, and stop using this one
+        if (result.attempts_ < options_.max_attempts_) { taken_[r] = 0; }
+        w.failed_ = true;
+        w.holding_ = -1;
+        break;
+    }
+    w.conn_.disconnect();
+}
+
+inline
+int sweep::next(worker& w)
+{
+    // a search on the data set the server holds, or else one on the
+    // data set the fewest other servers are working on; with none left, the
+    // worker waits while any search is running, as a server that fails gives
+    // its search back to be tried again
+    boost::mutex::scoped_lock lock(mutex_);
+    while (true)
+    {
+        if (cancelled_) { return -1; }
+        std::vector<int> holders(data_sets_.size(), 0);
+        for (int i=0; i<(int)workers_.size(); ++i)
+        {
+            if (workers_[i].get() != &w && workers_[i]->holding_ >= 0) { ++holders[workers_[i]->holding_]; }
+        }
+        int best = -1;
+        for (int i=0; i<(int)results_.size(); ++i)
+        {
+            if (taken_[i]) { continue; }
+            int d = results_[i].data_set_;
+            if (d == w.holding_) { best = i; break; }
+            if (best < 0 || holders[d] < holders[results_[best].data_set_]) { best = i; }
+        }
+        if (best >= 0)
+        {
+            taken_[best] = 1;
+            ++running_;
+            w.holding_ = results_[best].data_set_;
+            return best;
+        }
+        w.holding_ = -1;
+        if (running_ == 0) { return -1; }
+        released_.wait(lock);
+    }
+}
+
+inline
+bool sweep::search(worker& w, sweep_result& result)
+{
+    if (w.data_set_ != result.data_set_)
+    {
+        w.data_set_ = -1;
+        if (!w.conn_.send_data_set(data_sets_[result.data_set_]) || w.conn_.last_result().value() != 0) { return false; }
+        w.data_set_ = result.data_set_;
+        boost::mutex::scoped_lock lock(mutex_);
+        ++w.uploads_;
+    }
+    eureqa::search_options options = option_sets_.empty() ? eureqa::search_options() : option_sets_[result.options_];
+    options.search_relationship_ = relationships_[result.relationship_];
+    if (!w.conn_.send_options(options) || w.conn_.last_result().value() != 0) { return false; }
+    if (!w.conn_.start_search() || w.conn_.last_result().value() != 0) { return false; }
+
+    boost::posix_time::ptime started = boost::posix_time::microsec_clock::universal_time();
+    while (true)
+    {
+        boost::this_thread::sleep(boost::posix_time::milliseconds(options_.poll_ms_));
+        if (!w.conn_.query_progress(result.progress_)) { return false; }
+        if (!result.progress_.solution_.text_.empty()) { result.frontier_.add(result.progress_.solution_); }
+        result.seconds_ = (boost::posix_time::microsec_clock::universal_time() - started).total_microseconds() / 1e6;
+        if (options_.max_generations_ > 0 && result.progress_.generations_ >= options_.max_generations_) { break; }
+        if (options_.max_seconds_ > 0 && result.seconds_ >= options_.max_seconds_) { break; }
+    }
+
+    // the server's frontier has every solution it kept, not only those polled
+    eureqa::solution_frontier front;
+    if (!w.conn_.query_frontier(front)) { return false; }
+    for (int i=0; i<front.size(); ++i) { result.frontier_.add(front[i]); }
+    return w.conn_.end_search();
+}
+
+} // namespace eureqa
+
+#endif // EUREQA_SWEEP_H
@@ -0,0 +1,222 @@
+#ifndef EUREQA_TUNER_H
+#define EUREQA_TUNER_H
+
+#include <string>
+#include <vector>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <boost/random/mersenne_twister.hpp>
+#include <eureqa/scheduler.h>
+
+namespace eureqa
+{
+struct tuner_options
+{
+    double min_evaluations_; // each configuration's budget on the first rung
+    double keep_fraction_; // of the configurations kept after each rung, the budget grows by its inverse
+    double max_evaluations_; // the winner runs on until the tuning has spent this many, 0 for no final run
+    unsigned int seed_; // for sample()
+    scheduler_options scheduler_; // how the searches are placed on the servers
+
+    tuner_options() : min_evaluations_(1e6), keep_fraction_(0.5), max_evaluations_(0), seed_(1) { }
+};
+
+// a configuration being tuned
+struct tuner_result
+{
+    eureqa::search_options options_;
+    eureqa::solution_frontier frontier_; // everything found with it, carried from rung to rung
+    double evaluations_; // total spent on it
+    double score_; // fitness improvement per evaluation on the last rung it ran
+    int rungs_; // it ran on
+    bool failed_;
+
+    tuner_result() : evaluations_(0), score_(0), rungs_(0), failed_(false) { }
+
+    // fitness of the fittest solution found
+    double best_fitness() const;
+};
+
+// picks search options by successive halving
+//
+// every configuration gets a short search, scored by how much it improved the
+// best fitness per evaluation; the top keep_fraction_ go on to the next rung
+// with 1/keep_fraction_ times the budget, seeded with their own frontiers,
+// until one is left, which gets whatever is left of max_evaluations_
+//
+// the searches of a rung run concurrently on the scheduler, so a rung takes
+// about as long as its slowest search divided among the servers
+//
+//   eureqa::tuner tune;
+//   tune.sample(27, eureqa::search_options("y = f(x)"));
+//   tune.run(data, hostnames);
+//   tune.result(tune.best()).options_ ...
+class tuner
+{
+protected:
+    tuner_options options_;
+    std::vector<tuner_result> results_;
+    std::vector<int> survivors_;
+    boost::mt19937 rng_;
+    int best_;
+    double spent_;
+
+public:
+    tuner(tuner_options options = tuner_options());
+    const tuner_options& options() const { return options_; }
+
+    // configurations to try, given or drawn at random around a base
+    int add(const eureqa::search_options& options);
+    void sample(int count, const eureqa::search_options& base);
+
+    // tunes on the servers, which may end in :port; false if no configuration finished a rung
+    bool run(const eureqa::data_set& data, const std::vector<std::string>& hostnames, int port = default_port_tcp);
+
+    // results
+    int size() const { return (int)results_.size(); }
+    const tuner_result& result(int i) const { return results_[i]; }
+    int best() const { return best_; } // index of the winner, -1 before run()
+    double evaluations() const { return spent_; } // over every search
+
+protected:
+    bool run_rung(eureqa::scheduler& jobs, const eureqa::data_set& data, double budget);
+    double uniform() { return rng_() / ((double)rng_.max() + 1); }
+    double log_uniform(double lo, double hi) { return std::exp(std::log(lo) + uniform() * (std::log(hi) - std::log(lo))); }
+};
+
+/*---------------------------------------------------------------------------
+    implementions:
+*--------------------------------------------------------------------------*/
+inline
+double tuner_result::best_fitness() const
+{
+    double best = -std::numeric_limits<double>::infinity();
+    for (int i=0; i<frontier_.size(); ++i) { best = std::max(best, (double)frontier_[i].fitness_); }
+    return best;
+}
+
+inline
+tuner::tuner(tuner_options options) :
+    options_(options),
+    rng_(options.seed_),
+    best_(-1),
+    spent_(0)
+{ }
+
+inline
+int tuner::add(const eureqa::search_options& options)
+{
+    tuner_result result;
+    result.options_ = options;
+    results_.push_back(result);
+    return (int)results_.size() - 1;
+}
+
+inline
+void tuner::sample(int count, const eureqa::search_options& base)
+{
+    // sizes on a log scale, probabilities evenly, within what searches commonly use
+    for (int i=0; i<count; ++i)
+    {
+        eureqa::search_options options = base;
+        options.solution_population_size_ = (int)log_uniform(16, 1024);
+        options.predictor_population_size_ = (int)log_uniform(4, 64);
+        options.trainer_population_size_ = (int)log_uniform(4, 64);
+        options.solution_crossover_probability_ = (float)(0.3 + 0.6 * uniform());
+        options.solution_mutation_probability_ = (float)log_uniform(0.005, 0.2);
+        options.predictor_crossover_probability_ = (float)(0.3 + 0.6 * uniform());
+        options.predictor_mutation_probability_ = (float)log_uniform(0.005, 0.2);
+        add(options);
+    }
+}
+
+inline
+bool tuner::run(const eureqa::data_set& data, const std::vector<std::string>& hostnames, int port)
+{
+    best_ = -1;
+    spent_ = 0;
+    if (results_.empty()) { return false; }
+
+    eureqa::scheduler jobs(options_.scheduler_);
+    for (int i=0; i<(int)hostnames.size(); ++i)
+    {
+        std::string host;
+        int host_port = port;
+        eureqa::connection::parse_address(hostnames[i], host, host_port);
+        jobs.add_server(host, host_port);
+    }
+
+    survivors_.clear();
+    for (int i=0; i<(int)results_.size(); ++i) { survivors_.push_back(i); }
+
+    // halve until one is left, each rung costing about the same
+    double budget = options_.min_evaluations_;
+    while (true)
+    {
+        if (!run_rung(jobs, data, budget)) { return false; }
+        if (survivors_.size() <= 1) { break; }
+        int keep = std::max(1, (int)std::ceil(survivors_.size() * options_.keep_fraction_));
+        if (keep >= (int)survivors_.size()) { keep = (int)survivors_.size() - 1; }
+        survivors_.resize(keep);
+        budget /= options_.keep_fraction_;
+    }
+    best_ = survivors_[0];
+
+    // the rest of the budget goes to the winner
+    if (options_.max_evaluations_ > spent_) { run_rung(jobs, data, options_.max_evaluations_ - spent_); }
+    return true;
+}
+
+inline
+bool tuner::run_rung(eureqa::scheduler& jobs, const eureqa::data_set& data, double budget)
+{
+    // every survivor carries on from its own frontier
+    std::vector<int> job_of(results_.size(), -1);
+    std::vector<double> start(results_.size(), 0);
+    for (int k=0; k<(int)survivors_.size(); ++k)
+    {
+        tuner_result& result = results_[survivors_[k]];
+        start[survivors_[k]] = result.best_fitness();
+        job_of[survivors_[k]] = jobs.add_job(data, result.options_, 0, budget, result.frontier_);
+    }
+    jobs.run();
+
+    // on the first rung, when nothing has been found yet, they all start
+    // from the worst of the fitnesses they reached
+    double floor = std::numeric_limits<double>::infinity();
+    for (int k=0; k<(int)survivors_.size(); ++k)
+    {
+        const search_job& job = jobs.job(job_of[survivors_[k]]);
+        if (job.state_ != job_states::finished) { continue; }
+        for (int i=0; i<job.frontier_.size(); ++i) { floor = std::min(floor, (double)job.frontier_[i].fitness_); }
+    }
+
+    std::vector<std::pair<double, int> > ranked;
+    for (int k=0; k<(int)survivors_.size(); ++k)
+    {
+        int c = survivors_[k];
+        tuner_result& result = results_[c];
+        const search_job& job = jobs.job(job_of[c]);
+        result.evaluations_ += job.evaluations_;
+        spent_ += job.evaluations_;
+        ++result.rungs_;
+        if (job.state_ != job_states::finished || job.frontier_.size() == 0) { result.failed_ = true; continue; }
+        result.frontier_ = job.frontier_;
+        double from = (start[c] == -std::numeric_limits<double>::infinity()) ? floor : start[c];
+        result.score_ = (result.best_fitness() - from) / std::max(1.0, job.evaluations_);
+        ranked.push_back(std::make_pair(result.score_, c));
+    }
+    if (ranked.empty()) { return false; }
+
+    // highest improvement per evaluation first
+    std::sort(ranked.begin(), ranked.end());
+    std::reverse(ranked.begin(), ranked.end());
+    survivors_.clear();
+    for (int k=0; k<(int)ranked.size(); ++k) { survivors_.push_back(ranked[k].second); }
+    return true;
+}
+
+} // namespace eureqa
+
+#endif // EUREQA_TUNER_H
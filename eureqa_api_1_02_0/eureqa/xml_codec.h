@@ -0,0 +1,569 @@
+#ifndef EUREQA_XML_CODEC_H
+#define EUREQA_XML_CODEC_H
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <limits>
+#include <string>
+#include <vector>
+#include <boost/archive/basic_archive.hpp>
+#include <eureqa/server_info.h>
+#include <eureqa/search_progress.h>
+#include <eureqa/solution_frontier.h>
+#include <eureqa/solution_arena.h>
+
+namespace eureqa
+{
+// hand-written xml encoders and decoders for the small fixed-shape messages
+//
+// the encoders write exactly the bytes boost::archive::xml_oarchive writes,
+// the decoders read anything it writes without constructing an archive, and
+// decode into the existing objects so strings keep their capacity
+//
+// decoders return false for a packet they do not recognize, so the caller can
+// fall back to the boost archives
+class xml_codec
+{
+public:
+    static void encode(const eureqa::search_progress& progress, std::string& packet);
+    static void encode(const eureqa::server_info& info, std::string& packet);
+    static void encode(const eureqa::solution_frontier& front, std::string& packet);
+    static void encode(const std::vector<eureqa::solution_info>& individuals, std::string& packet);
+
+    static bool decode(const char* data, std::size_t size, eureqa::search_progress& progress);
+    static bool decode(const char* data, std::size_t size, eureqa::server_info& info);
+    static bool decode(const char* data, std::size_t size, eureqa::solution_frontier& front);
+    static bool decode(const char* data, std::size_t size, std::vector<eureqa::solution_info>& individuals);
+    static bool decode_frontier(const char* data, std::size_t size, eureqa::solution_arena& front);
+    static bool decode_individuals(const char* data, std::size_t size, eureqa::solution_arena& individuals);
+
+protected:
+    // one primitive member of a message, exactly one of the pointers is set
+    template<typename T>
+    struct field
+    {
+        const char* name_;
+        std::string T::* string_;
+        float T::* float_;
+        double T::* double_;
+        int T::* int_;
+        unsigned int T::* unsigned_;
+    };
+    static const field<solution_info>* solution_info_fields();
+    static const field<search_progress>* search_progress_fields();
+    static const field<server_info>* server_info_fields();
+
+    // writing
+    static void write_header(std::string& packet, const char* root);
+    static void write_footer(std::string& packet, const char* root);
+    static void write_open(std::string& packet, int depth, const char* name, int class_id);
+    static void write_close(std::string& packet, int depth, const char* name);
+    template<typename T> static void write_fields(std::string& packet, int depth, const T& val, const field<T>* fields);
+    static void write_solutions(std::string& packet, int depth, const std::vector<solution_info>& solutions, int class_id);
+    static void write_escaped(std::string& packet, const std::string& s);
+    template<typename T> static void write_float(std::string& packet, T val);
+
+    // reading, each advances p past what it read and returns false on a mismatch
+    static bool read_header(const char*& p, const char* end, const char* root);
+    static bool read_open(const char*& p, const char* end, const char* name);
+    static bool read_close(const char*& p, const char* end, const char* name);
+    static bool read_text(const char*& p, const char* end, const char*& text, const char*& text_end);
+    static bool read_count(const char*& p, const char* end, std::size_t& count);
+    template<typename T> static bool read_fields(const char*& p, const char* end, T& val, const field<T>* fields);
+    static void unescape(const char* begin, const char* end, std::string& s);
+    template<typename Container> static bool read_solutions(const char*& p, const char* end, Container& solutions);
+
+    static solution_info& next(std::vector<solution_info>& solutions, std::size_t i);
+    static solution_info& next(solution_arena& solutions, std::size_t i);
+    static void reset(std::vector<solution_info>& solutions, std::size_t count) { solutions.resize(count); }
+    static void reset(solution_arena& solutions, std::size_t /*count*/) { solutions.clear(); }
+};
+
+// hooks used by encode_packet/decode_packet, xml only
+inline bool fast_encode(const search_progress& val, const char* name, std::string& packet);
+inline bool fast_encode(const server_info& val, const char* name, std::string& packet);
+inline bool fast_encode(const solution_frontier& val, const char* name, std::string& packet);
+inline bool fast_encode(const std::vector<solution_info>& val, const char* name, std::string& packet);
+inline bool fast_decode(const char* data, std::size_t size, const char* name, search_progress& val);
+inline bool fast_decode(const char* data, std::size_t size, const char* name, server_info& val);
+inline bool fast_decode(const char* data, std::size_t size, const char* name, solution_frontier& val);
+inline bool fast_decode(const char* data, std::size_t size, const char* name, std::vector<solution_info>& val);
+inline bool fast_decode(const char* data, std::size_t size, const char* name, solution_arena_frontier& val);
+inline bool fast_decode(const char* data, std::size_t size, const char* name, solution_arena& val);
+
+/*---------------------------------------------------------
+    Implementation:
+*--------------------------------------------------------*/
+inline
+const xml_codec::field<solution_info>* xml_codec::solution_info_fields()
+{
+    static const field<solution_info> fields[] = {
+        { "text_",       &solution_info::text_, 0, 0, 0, 0 },
+        { "score_",      0, &solution_info::score_, 0, 0, 0 },
+        { "fitness_",    0, &solution_info::fitness_, 0, 0, 0 },
+        { "complexity_", 0, &solution_info::complexity_, 0, 0, 0 },
+        { "age_",        0, 0, 0, 0, &solution_info::age_ },
+        { 0, 0, 0, 0, 0, 0 }
+    };
+    return fields;
+}
+
+inline
+const xml_codec::field<search_progress>* xml_codec::search_progress_fields()
+{
+    // follows the nested solution_
+    static const field<search_progress> fields[] = {
+        { "generations_",           0, &search_progress::generations_, 0, 0, 0 },
+        { "generations_per_sec_",   0, &search_progress::generations_per_sec_, 0, 0, 0 },
+        { "evaluations_",           0, &search_progress::evaluations_, 0, 0, 0 },
+        { "evaluations_per_sec_",   0, &search_progress::evaluations_per_sec_, 0, 0, 0 },
+        { "total_population_size_", 0, 0, 0, &search_progress::total_population_size_, 0 },
+        { 0, 0, 0, 0, 0, 0 }
+    };
+    return fields;
+}
+
+inline
+const xml_codec::field<server_info>* xml_codec::server_info_fields()
+{
+    static const field<server_info> fields[] = {
+        { "hostname_",         &server_info::hostname_, 0, 0, 0, 0 },
+        { "operating_system_", &server_info::operating_system_, 0, 0, 0, 0 },
+        { "eureqa_version_",   0, 0, &server_info::eureqa_version_, 0, 0 },
+        { "cpu_cores_",        0, 0, 0, &server_info::cpu_cores_, 0 },
+        { 0, 0, 0, 0, 0, 0 }
+    };
+    return fields;
+}
+
+inline
+void xml_codec::encode(const eureqa::search_progress& progress, std::string& packet)
+{
+    packet.clear();
+    write_header(packet, "search_progress");
+    write_open(packet, 1, "solution_", 1);
+    write_fields(packet, 2, progress.solution_, solution_info_fields());
+    write_close(packet, 1, "solution_");
+    write_fields(packet, 1, progress, search_progress_fields());
+    write_footer(packet, "search_progress");
+}
+
+inline
+void xml_codec::encode(const eureqa::server_info& info, std::string& packet)
+{
+    packet.clear();
+    write_header(packet, "server_info");
+    write_fields(packet, 1, info, server_info_fields());
+    write_footer(packet, "server_info");
+}
+
+inline
+void xml_codec::encode(const eureqa::solution_frontier& front, std::string& packet)
+{
+    packet.clear();
+    write_header(packet, "solution_frontier");
+    write_open(packet, 1, "front_", 1);
+    write_solutions(packet, 2, front.front_, 2);
+    write_close(packet, 1, "front_");
+    write_footer(packet, "solution_frontier");
+}
+
+inline
+void xml_codec::encode(const std::vector<eureqa::solution_info>& individuals, std::string& packet)
+{
+    packet.clear();
+    write_header(packet, "vector_solution_info");
+    write_solutions(packet, 1, individuals, 1);
+    write_footer(packet, "vector_solution_info");
+}
+
+inline
+bool xml_codec::decode(const char* data, std::size_t size, eureqa::search_progress& progress)
+{
+    const char* p = data;
+    const char* end = data + size;
+    return read_header(p, end, "search_progress")
+        && read_open(p, end, "solution_")
+        && read_fields(p, end, progress.solution_, solution_info_fields())
+        && read_close(p, end, "solution_")
+        && read_fields(p, end, progress, search_progress_fields());
+}
+
+inline
+bool xml_codec::decode(const char* data, std::size_t size, eureqa::server_info& info)
+{
+    const char* p = data;
+    const char* end = data + size;
+    return read_header(p, end, "server_info")
+        && read_fields(p, end, info, server_info_fields());
+}
+
+inline
+bool xml_codec::decode(const char* data, std::size_t size, eureqa::solution_frontier& front)
+{
+    const char* p = data;
+    const char* end = data + size;
+    return read_header(p, end, "solution_frontier")
+        && read_open(p, end, "front_")
+        && read_solutions(p, end, front.front_);
+}
+
+inline
+bool xml_codec::decode(const char* data, std::size_t size, std::vector<eureqa::solution_info>& individuals)
+{
+    const char* p = data;
+    const char* end = data + size;
+    return read_header(p, end, "vector_solution_info")
+        && read_solutions(p, end, individuals);
+}
+
+inline
+bool xml_codec::decode_frontier(const char* data, std::size_t size, eureqa::solution_arena& front)
+{
+    const char* p = data;
+    const char* end = data + size;
+    return read_header(p, end, "solution_frontier")
+        && read_open(p, end, "front_")
+        && read_solutions(p, end, front);
+}
+
+inline
+bool xml_codec::decode_individuals(const char* data, std::size_t size, eureqa::solution_arena& individuals)
+{
+    const char* p = data;
+    const char* end = data + size;
+    return read_header(p, end, "vector_solution_info")
+        && read_solutions(p, end, individuals);
+}
+
+inline
+void xml_codec::write_header(std::string& packet, const char* root)
+{
+    char version[16];
+    std::sprintf(version, "%u", (unsigned int)boost::archive::BOOST_ARCHIVE_VERSION());
+    packet += "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\" ?>\n";
+    packet += "<!DOCTYPE boost_serialization>\n";
+    packet += "<boost_serialization signature=\"serialization::archive\" version=\"";
+    packet += version;
+    packet += "\">\n";
+    write_open(packet, 0, root, 0);
+}
+
+inline
+void xml_codec::write_footer(std::string& packet, const char* root)
+{
+    write_close(packet, 0, root);
+    packet += "</boost_serialization>\n\n";
+}
+
+inline
+void xml_codec::write_open(std::string& packet, int depth, const char* name, int class_id)
+{
+    // the first object of each class carries its class information
+    packet.append(depth, '\t');
+    packet += '<';
+    packet += name;
+    if (class_id >= 0)
+    {
+        char attributes[64];
+        std::sprintf(attributes, " class_id=\"%d\" tracking_level=\"0\" version=\"0\"", class_id);
+        packet += attributes;
+    }
+    packet += ">\n";
+}
+
+inline
+void xml_codec::write_close(std::string& packet, int depth, const char* name)
+{
+    packet.append(depth, '\t');
+    packet += "</";
+    packet += name;
+    packet += ">\n";
+}
+
+template<typename T>
+inline
+void xml_codec::write_fields(std::string& packet, int depth, const T& val, const field<T>* fields)
+{
+    for (const field<T>* f=fields; f->name_; ++f)
+    {
+        packet.append(depth, '\t');
+        packet += '<';
+        packet += f->name_;
+        packet += '>';
+        char number[64];
+        if (f->string_) { write_escaped(packet, val.*(f->string_)); }
+        else if (f->float_) { write_float(packet, val.*(f->float_)); }
+        else if (f->double_) { write_float(packet, val.*(f->double_)); }
+        else if (f->int_) { std::sprintf(number, "%d", val.*(f->int_)); packet += number; }
+        else if (f->unsigned_) { std::sprintf(number, "%u", val.*(f->unsigned_)); packet += number; }
+        packet += "</";
+        packet += f->name_;
+        packet += ">\n";
+    }
+}
+
+inline
+void xml_codec::write_solutions(std::string& packet, int depth, const std::vector<solution_info>& solutions, int class_id)
+{
+    char count[32];
+    std::sprintf(count, "%u", (unsigned int)solutions.size());
+    packet.append(depth, '\t');
+    packet += "<count>";
+    packet += count;
+    packet += "</count>\n";
+    packet.append(depth, '\t');
+    packet += "<item_version>0</item_version>\n";
+    for (int i=0; i<(int)solutions.size(); ++i)
+    {
+        write_open(packet, depth, "item", (i == 0) ? class_id : -1);
+        write_fields(packet, depth+1, solutions[i], solution_info_fields());
+        write_close(packet, depth, "item");
+    }
+}
+
+inline
+void xml_codec::write_escaped(std::string& packet, const std::string& s)
+{
+    for (std::string::size_type i=0; i<s.length(); ++i)
+    {
+        switch (s[i])
+        {
+        case '<':  packet += "&lt;"; break;
+        case '>':  packet += "&gt;"; break;
+        case '&':  packet += "&amp;"; break;
+        case '\"': packet += "&quot;"; break;
+        case '\'': packet += "&apos;"; break;
+        default:   packet += s[i]; break;
+        }
+    }
+}
+
+template<typename T>
+inline
+void xml_codec::write_float(std::string& packet, T val)
+{
+    // the same precision and notation the text archives use
+    #ifndef BOOST_NO_CXX11_NUMERIC_LIMITS
+    const int digits = std::numeric_limits<T>::max_digits10;
+    #else
+    const int digits = std::numeric_limits<T>::digits10 + 2;
+    #endif
+    char number[64];
+    std::sprintf(number, "%.*e", digits, (double)val);
+    packet += number;
+}
+
+inline
+bool xml_codec::read_header(const char*& p, const char* end, const char* root)
+{
+    // skip the declaration, doctype and archive element
+    const char* tag = "<boost_serialization";
+    const char* found = std::search(p, end, tag, tag + std::strlen(tag));
+    if (found == end) { return false; }
+    p = found;
+    const char* close = std::find(p, end, '>');
+    if (close == end) { return false; }
+    p = close + 1;
+    return read_open(p, end, root);
+}
+
+inline
+bool xml_codec::read_open(const char*& p, const char* end, const char* name)
+{
+    // expects the next element to be <name ...>, attributes are skipped
+    while (p != end && *p != '<') { ++p; }
+    std::size_t length = std::strlen(name);
+    if (end - p < (std::ptrdiff_t)length + 2) { return false; }
+    if (std::strncmp(p + 1, name, length) != 0) { return false; }
+    char after = p[length + 1];
+    if (after != '>' && after != ' ' && after != '\t' && after != '/') { return false; }
+    const char* close = std::find(p, end, '>');
+    if (close == end) { return false; }
+    p = close + 1;
+    return true;
+}
+
+inline
+bool xml_codec::read_close(const char*& p, const char* end, const char* name)
+{
+    while (p != end && *p != '<') { ++p; }
+    std::size_t length = std::strlen(name);
+    if (end - p < (std::ptrdiff_t)length + 3) { return false; }
+    if (p[1] != '/' || std::strncmp(p + 2, name, length) != 0 || p[length + 2] != '>') { return false; }
+    p += length + 3;
+    return true;
+}
+
+inline
+bool xml_codec::read_text(const char*& p, const char* end, const char*& text, const char*& text_end)
+{
+    // the text of an element runs up to its closing tag
+    text = p;
+    while (p != end && *p != '<') { ++p; }
+    text_end = p;
+    return p != end;
+}
+
+inline
+bool xml_codec::read_count(const char*& p, const char* end, std::size_t& count)
+{
+    const char* text;
+    const char* text_end;
+    if (!read_open(p, end, "count") || !read_text(p, end, text, text_end)) { return false; }
+    count = (std::size_t)std::strtoul(text, 0, 10);
+    if (!read_close(p, end, "count")) { return false; }
+
+    // older archives have no item version
+    const char* q = p;
+    if (read_open(q, end, "item_version"))
+    {
+        p = q;
+        if (!read_text(p, end, text, text_end) || !read_close(p, end, "item_version")) { return false; }
+    }
+    return true;
+}
+
+template<typename T>
+inline
+bool xml_codec::read_fields(const char*& p, const char* end, T& val, const field<T>* fields)
+{
+    for (const field<T>* f=fields; f->name_; ++f)
+    {
+        const char* text;
+        const char* text_end;
+        if (!read_open(p, end, f->name_) || !read_text(p, end, text, text_end)) { return false; }
+        if (f->string_) { unescape(text, text_end, val.*(f->string_)); }
+        else if (f->float_) { val.*(f->float_) = (float)std::strtod(text, 0); }
+        else if (f->double_) { val.*(f->double_) = std::strtod(text, 0); }
+        else if (f->int_) { val.*(f->int_) = (int)std::strtol(text, 0, 10); }
+        else if (f->unsigned_) { val.*(f->unsigned_) = (unsigned int)std::strtoul(text, 0, 10); }
+        if (!read_close(p, end, f->name_)) { return false; }
+    }
+    return true;
+}
+
+inline
+void xml_codec::unescape(const char* begin, const char* end, std::string& s)
+{
+    // assigning keeps the string's capacity
+    s.clear();
+    while (begin != end)
+    {
+        const char* amp = std::find(begin, end, '&');
+        s.append(begin, amp);
+        if (amp == end) { break; }
+        const char* semi = std::find(amp, end, ';');
+        std::string::size_type length = semi - amp;
+        if      (length == 3 && std::strncmp(amp, "&lt", 3) == 0)   { s += '<'; }
+        else if (length == 3 && std::strncmp(amp, "&gt", 3) == 0)   { s += '>'; }
+        else if (length == 4 && std::strncmp(amp, "&amp", 4) == 0)  { s += '&'; }
+        else if (length == 5 && std::strncmp(amp, "&quot", 5) == 0) { s += '\"'; }
+        else if (length == 5 && std::strncmp(amp, "&apos", 5) == 0) { s += '\''; }
+        else { s.append(amp, semi); }
+        begin = (semi == end) ? end : semi + 1;
+    }
+}
+
+inline
+solution_info& xml_codec::next(std::vector<solution_info>& solutions, std::size_t i)
+{
+    return solutions[i];
+}
+
+inline
+solution_info& xml_codec::next(solution_arena& solutions, std::size_t /*i*/)
+{
+    return solutions.allocate();
+}
+
+template<typename Container>
+inline
+bool xml_codec::read_solutions(const char*& p, const char* end, Container& solutions)
+{
+    std::size_t count = 0;
+    if (!read_count(p, end, count)) { return false; }
+    if (count > (std::size_t)(end - p)) { return false; }
+    reset(solutions, count);
+    for (std::size_t i=0; i<count; ++i)
+    {
+        if (!read_open(p, end, "item")) { return false; }
+        if (!read_fields(p, end, next(solutions, i), solution_info_fields())) { return false; }
+        if (!read_close(p, end, "item")) { return false; }
+    }
+    return true;
+}
+
+inline
+bool fast_encode(const search_progress& val, const char* name, std::string& packet)
+{
+    if (std::strcmp(name, "search_progress") != 0) { return false; }
+    xml_codec::encode(val, packet);
+    return true;
+}
+
+inline
+bool fast_encode(const server_info& val, const char* name, std::string& packet)
+{
+    if (std::strcmp(name, "server_info") != 0) { return false; }
+    xml_codec::encode(val, packet);
+    return true;
+}
+
+inline
+bool fast_encode(const solution_frontier& val, const char* name, std::string& packet)
+{
+    if (std::strcmp(name, "solution_frontier") != 0) { return false; }
+    xml_codec::encode(val, packet);
+    return true;
+}
+
+inline
+bool fast_encode(const std::vector<solution_info>& val, const char* name, std::string& packet)
+{
+    if (std::strcmp(name, "vector_solution_info") != 0) { return false; }
+    xml_codec::encode(val, packet);
+    return true;
+}
+
+inline
+bool fast_decode(const char* data, std::size_t size, const char* name, search_progress& val)
+{
+    return std::strcmp(name, "search_progress") == 0 && xml_codec::decode(data, size, val);
+}
+
+inline
+bool fast_decode(const char* data, std::size_t size, const char* name, server_info& val)
+{
+    return std::strcmp(name, "server_info") == 0 && xml_codec::decode(data, size, val);
+}
+
+inline
+bool fast_decode(const char* data, std::size_t size, const char* name, solution_frontier& val)
+{
+    return std::strcmp(name, "solution_frontier") == 0 && xml_codec::decode(data, size, val);
+}
+
+inline
+bool fast_decode(const char* data, std::size_t size, const char* name, std::vector<solution_info>& val)
+{
+    return std::strcmp(name, "vector_solution_info") == 0 && xml_codec::decode(data, size, val);
+}
+
+inline
+bool fast_decode(const char* data, std::size_t size, const char* name, solution_arena_frontier& val)
+{
+    return std::strcmp(name, "solution_frontier") == 0 && xml_codec::decode_frontier(data, size, val.front_);
+}
+
+inline
+bool fast_decode(const char* data, std::size_t size, const char* name, solution_arena& val)
+{
+    return std::strcmp(name, "vector_solution_info") == 0 && xml_codec::decode_individuals(data, size, val);
+}
+
+} // namespace eureqa
+
+#endif // EUREQA_XML_CODEC_H
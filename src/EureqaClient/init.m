@@ -15,7 +15,8 @@ BeginPackage["EureqaClient`"];
 
   symbolGroups = Hold[SendOptionsOptions, SolutionInfoOptions,
                   SearchProgressOptions, EureqaSearchOptions,
-                  FitnessMetrics]; (* Hold is like quote in Lisp. *)
+                  FitnessMetrics, ServerInfoOptions,
+                  ConnectionStatisticsOptions]; (* Hold is like quote in Lisp. *)
   (* Unprotect for cases of reloading a package.*)
   Unprotect@@symbolGroups;
     (* Maybe I should put these in their own packages to split them up finer. *)
@@ -55,7 +56,43 @@ BeginPackage["EureqaClient`"];
                   TerminateCondition,
                   UpdatesPerSecond,
                   DisplaySolutionFrontier,
-                  DisplaySearchProgress};
+                  DisplaySearchProgress,
+                  Reconnect,
+                  SharedDirectory,
+                 (* Arguments to EureqaSweep *)
+                  MaxSeconds,
+                 (* Arguments to EureqaCrossValidate *)
+                  Folds,
+                 (* Arguments to LaunchServers *)
+                  ServerProgram,
+                  Pinning};
+                 (* Tags for ServerInfo *)
+    ServerInfoOptions = {
+                  Port,
+                  Hostname,
+                  OperatingSystem,
+                  EureqaVersion,
+                  CPUCores,
+                  Searching,
+                  ResponseTime};
+                 (* Tags for ConnectionStatistics *)
+    ConnectionStatisticsOptions = {
+                  Connects,
+                  ConnectFailures,
+                  MeanConnectTime,
+                  ConnectTimeouts,
+                  WriteTimeouts,
+                  ReadTimeouts,
+                  Commands,
+                  Command,
+                  Calls,
+                  SerializeTime,
+                  WriteTime,
+                  FirstByteTime,
+                  DecodeTime,
+                  BytesOut,
+                  BytesIn,
+                  Percentile99};
     FitnessMetrics = {
                  (* Fitness Metrics *)
                   AbsoluteError,
@@ -86,6 +123,9 @@ BeginPackage["EureqaClient`"];
                 (* MathLink Functions *)
                  ConnectTo, 
                  Disconnect, 
+                 SetReconnect, 
+                 SetSharedDirectory, 
+                 SendDataLocation, 
                  SendOptions, 
                  SendDataSet, 
                  StartSearch, 
@@ -98,16 +138,30 @@ BeginPackage["EureqaClient`"];
                  GetSolutionFrontier, 
                  SearchProgressGrid, 
                  IsConnected,
+                 DiscoverServers,
+                 ConnectionStatistics,
+                 SweepClear,
+                 SweepDataSet,
+                 SweepRelationship,
+                 SweepOptions,
+                 SweepRun,
+                 CrossValidate,
+                 LaunchServers,
+                 StopServers,
                 (* Tags or objects *)
                  SolutionFrontier, 
                  SolutionInfo, 
                  ConnectionInfo,
                  SearchProgress, 
+                 ServerInfo,
+                 CommandStatistics,
                  (* Mathematica Functions *)
                  AddToSolutionFrontier,                  
                  FormulaTextToExpression, 
                  SolutionFrontierGrid,
                  EureqaSearch,
+                 EureqaSweep,
+                 EureqaCrossValidate,
                  GetField,
                  GetFields,
                  PutField,
@@ -123,17 +177,23 @@ BeginPackage["EureqaClient`"];
 
     Apply[Unprotect, eureqaSymbols];
 
-    ConnectTo::usage = "ConnectTo[host] connects to the Eureqa server on host.";
+    ConnectTo::usage = "ConnectTo[host] connects to the Eureqa server on host.\nConnectTo[\"unix:path\"] connects through an eureqa_broker listening on path, which lets parallel kernels share one connection to the server.\nConnectTo[{host1, host2, ...}] runs one search on all the hosts at once: every command is sent to each of them, QueryProgress[] sums their speeds, and the solution frontier merges the solutions they all find.  A host may be given as \"host:port\", or \"[address]:port\" for an IPv6 address.  A host that stops responding is dropped and the search goes on with the rest.";
     ConnectTo::conn = "There is already a connection.";
     ConnectTo::err = "Unable to connect to Eureqa server.";
+    ConnectTo::hosts = "Expected a list of host names.";
 
     Disconnect::usage = "Disconnect[] disconnects from a Eureqa server.";
+    SetReconnect::usage = "SetReconnect[n] makes a dropped connection reconnect on the next call, trying up to n times with increasing waits, and restore the data set, options, solution frontier and running search.  SetReconnect[True] tries 8 times; SetReconnect[False] or SetReconnect[0] turns reconnecting off.";
     SendDataSet::usage = "SendDataSet[data] sends the data to the Eureqa server with default labels \"xi\" for each column i.\nSendDataSet[data, {l1, l2, ...}] send the data to the Eureqa server with given labels li for each column i.";
     SendDataSet::readerr = "Error reading data matrix.";
     SendDataSet::colmis = "Invalid number of labels: columns of data do not equal length of list of labels.";
     SendDataSet::invarg = "Invalid argument.";
     SendDataSet::err = "Generic error.";
-    Map[(#::noconn = "Not connected to a Eureqa server.")&, {SendDataSet,SendOptions, StartSearch, PauseSearch, EndSearch, QueryProgress, Disconnect}];
+    SetSharedDirectory::usage = "SetSharedDirectory[dir] makes SendDataSet write the data to a file in dir and send the server only its path, which is much faster when the server can read dir, as on the same machine or a shared filesystem.  Data the server cannot load from dir is sent over the network as usual.  SetSharedDirectory[None] sends all data over the network.";
+    SendDataLocation::usage = "SendDataLocation[path] has the Eureqa server load the data set from the file at path on the server's machine.  The file is a plain text table, separated by whitespace or commas, with an optional first line of variable labels.";
+    SendDataLocation::err = "Error sending the data location.";
+    SendDataLocation::load = "The Eureqa server could not load the data set file.";
+    Map[(#::noconn = "Not connected to a Eureqa server.")&, {SendDataSet, SendDataLocation, SendOptions, StartSearch, PauseSearch, EndSearch, QueryProgress, Disconnect}];
     StartSearch::err = "Error starting search.";
     PauseSearch::err = "Error pausing search.";
     EndSearch::err = "Error ending search.";
@@ -187,7 +247,48 @@ BeginPackage["EureqaClient`"];
     StepMonitor::usage = "Option used with EureqaSearch to specify a function that is run on every update interval.  It is not provided with any arguments, but it can query the running server with QueryProgress[] and GetSolutionFrontier[] functions.";
     EureqaSearch::usage = "EureqaSearch[data, model] initiates a search of the given data for a relationship as specified by the model.  Some important options are Host, VariableLabels, BuildingBlocks.  See all the options this function accepts by evaluating Options[EureqaSearch].";
     FitnessMetric::usage = "Option used to specify how fitness should be evaluated.  Evaluate FitnessMetrics to see the values available.";
-    Host::usage = "Option used to specify what host to connect to.";
+    SharedDirectory::usage = "Option used with EureqaSearch to send the data set through a file in the given directory when the server can read it; see SetSharedDirectory.  None sends it over the network.";
+    Reconnect::usage = "Option used with EureqaSearch to restore the search if the connection to the server drops.  True, False or the number of attempts; see SetReconnect.";
+    Host::usage = "Option used to specify what host to connect to.  Host -> Automatic uses the first server found by DiscoverServers[].  Host -> {host1, host2, ...} runs the search on all of them at once and merges their solution frontiers.";
+    DiscoverServers::usage = "DiscoverServers[] looks for Eureqa servers on the local network and this machine for two seconds and returns a list of ServerInfo[Host -> ..., CPUCores -> ..., ...], ranked with idle servers with the most cores first.\nDiscoverServers[ms] looks for ms milliseconds.";
+    EureqaSearch::noserv = "No Eureqa servers found.";
+    EureqaSweep::usage = "EureqaSweep[{data1, data2, ...}, {model1, model2, ...}, {{opts1}, {opts2}, ...}] searches every combination of data set, model and set of SendOptions options, running the searches in parallel on the hosts given by the Host option, and returns the solution frontiers as a table indexed by data set, model and option set.  Each data set is uploaded at most once to each host.  A single data set or model need not be in a list, and the option sets may be left out.  Host -> Automatic uses every server found by DiscoverServers[].  Each search stops at MaxGenerations or MaxSeconds.";
+    EureqaSweep::nolimit = "MaxGenerations or MaxSeconds must be finite.";
+    MaxSeconds::usage = "Option used with EureqaSweep to stop each search after that many seconds.";
+    SweepClear::usage = "SweepClear[] forgets the data sets, models and option sets given to SweepDataSet, SweepRelationship and SweepOptions.";
+    SweepDataSet::usage = "SweepDataSet[data] or SweepDataSet[data, labels] adds a data set to the sweep and returns its index.";
+    SweepDataSet::readerr = "Unable to read the data set.";
+    SweepDataSet::invarg = "Expected a list of strings for the variable labels.";
+    SweepDataSet::colmis = "The number of variable labels does not match the number of columns.";
+    SweepRelationship::usage = "SweepRelationship[model] adds a search relationship to the sweep and returns its index.";
+    SweepOptions::usage = "SweepOptions[FitnessMetric -> ..., BuildingBlocks -> ..., ...] adds a set of SendOptions options to the sweep and returns its index.  The SearchRelationship comes from the models.";
+    (* SweepOptions reads its options as SendOptions does, and reports the same errors *)
+    Scan[(MessageName[SweepOptions, #] = MessageName[SendOptions, #])&, 
+      {"inv", "expstr", "expstr2", "failstr", "expint1", "failint", "expreal", "failreal", "failmsym1", 
+       "explist", "expsym1", "failsym1", "invsym1", "invopt1", "exprule", "expruletwo", "exprsym"}];
+    SweepRun::usage = "SweepRun[{host1, host2, ...}, maxGenerations, maxSeconds] runs every combination added since SweepClear[] across the hosts, each search until it reaches maxGenerations or maxSeconds, where 0 means no limit but one of the two must be set, and returns {{{frontier, ...}, ...}, ...} indexed by data set, model and option set, with $Failed for a search no host could finish.  It uses connections of its own, apart from ConnectTo[].";
+    SweepRun::hosts = "Expected a list of host names.";
+    SweepRun::empty = "The sweep needs at least one data set and one model.";
+    SweepRun::nolimit = "maxGenerations or maxSeconds must be greater than 0.";
+    SweepRun::arcerr = "Error decoding a reply from the server.";
+    EureqaCrossValidate::usage = "EureqaCrossValidate[data, model] splits the data into Folds folds, runs the searches that each leave one fold out in parallel on the hosts given by the Host option, scores every formula they find on the fold its search left out, and returns the formulas as a SolutionFrontier ranked by that validation fitness, best first.  SendOptions options such as FitnessMetric are passed on to the searches, and each search stops at MaxGenerations or MaxSeconds.";
+    EureqaCrossValidate::nolimit = "MaxGenerations or MaxSeconds must be finite.";
+    Folds::usage = "Option used with EureqaCrossValidate to give the number of folds.";
+    CrossValidate::usage = "CrossValidate[{host1, host2, ...}, folds, maxGenerations, maxSeconds] cross-validates the first data set, model and option set added since SweepClear[], and returns the formulas as a SolutionFrontier whose fitness and score are from the held out folds, ranked best first.  A limit of 0 means none, but one of the two must be set.";
+    CrossValidate::hosts = "Expected a list of host names.";
+    CrossValidate::empty = "Cross-validation needs a data set and a model.";
+    CrossValidate::folds = "Cross-validation needs at least 2 folds.";
+    CrossValidate::nolimit = "maxGenerations or maxSeconds must be greater than 0.";
+    CrossValidate::arcerr = "Error decoding a reply from the server.";
+    CrossValidate::novalid = "No fold's search finished and was scored.";
+    LaunchServers::usage = "LaunchServers[n] starts n eureqa_server instances on this machine, on consecutive ports from 22113, and returns their hosts, so ConnectTo[LaunchServers[n]] or EureqaSearch[..., Host -> LaunchServers[n]] runs a search on all of them.  LaunchServers[] starts one per NUMA node.  With Pinning -> \"NUMA\" each instance is pinned to the cpus of one node, shared out if there are more instances than nodes; \"Cores\" gives each its own run of cpus and None does not pin them.  ServerProgram gives the path of eureqa_server, by default $EUREQA_SERVER or eureqa_server on the PATH.  An instance that exits or stops answering is restarted on its port, where a session with Reconnect on carries on.  Asked again for the same servers, the running ones are returned.";
+    LaunchServers::launch = "Unable to launch the Eureqa servers.";
+    LaunchServers::start = "The Eureqa servers did not start answering; check ServerProgram.";
+    LaunchServers::pin = "Pinning must be \"NUMA\", \"Cores\" or None.";
+    StopServers::usage = "StopServers[] stops the servers started by LaunchServers[].";
+    ServerProgram::usage = "Option used with LaunchServers to give the path of the eureqa_server program.";
+    Pinning::usage = "Option used with LaunchServers to choose how the instances are pinned to cpus: \"NUMA\", \"Cores\" or None.";
+    ConnectionStatistics::usage = "ConnectionStatistics[] returns ConnectionStatistics[Connects -> ..., Commands -> {CommandStatistics[Command -> \"query_progress\", Calls -> ..., SerializeTime -> {Mean -> ..., Median -> ..., Percentile99 -> ..., Max -> ...}, WriteTime -> ..., FirstByteTime -> ..., DecodeTime -> ..., BytesOut -> ..., BytesIn -> ...], ...}] for the commands sent since the first ConnectTo[], summed over every server of ConnectTo[{host1, host2, ...}].  Times are in milliseconds; medians and percentiles are upper bounds within a factor of two.";
     VariableLabels::usage = "Option used to specify the labels of each column of data.  If not specified the labels used by default are x1, x2, ....";
 
     (*AllBuildingBlocks = Where are these defined?*)
@@ -323,12 +424,87 @@ BeginPackage["EureqaClient`"];
       MaxGenerations -> Infinity, 
       UpdatesPerSecond -> 1,
       DisplaySearchProgress -> SearchProgressGrid,
-      DisplaySolutionFrontier -> SolutionFrontierGrid
+      DisplaySolutionFrontier -> SolutionFrontierGrid,
+      Reconnect -> True,
+      SharedDirectory -> None
       };
 
+    SweepDataSet[data_, Automatic] := SweepDataSet[data];
+
+    Options[EureqaSweep] = {
+      Host -> "localhost",
+      VariableLabels -> Automatic,
+      MaxGenerations -> 1000,
+      MaxSeconds -> Infinity
+      };
+
+    EureqaSweep[data_?MatrixQ, rest___] := EureqaSweep[{data}, rest];
+    EureqaSweep[datas:{__?MatrixQ}, model_String, rest___] := EureqaSweep[datas, {model}, rest];
+    EureqaSweep[datas:{__?MatrixQ}, models:{__String}, opts___Rule] := 
+      EureqaSweep[datas, models, {{}}, opts];
+    EureqaSweep[datas:{__?MatrixQ}, models:{__String}, optionSets:{___List}, 
+      opts:OptionsPattern[]] :=
+     Module[{hosts = OptionValue[Host], 
+       maxGenerations = OptionValue[MaxGenerations], 
+       maxSeconds = OptionValue[MaxSeconds]},
+      If[maxGenerations === Infinity && maxSeconds === Infinity,
+        Message[EureqaSweep::nolimit]; Return[$Failed]];
+      If[hosts === Automatic,
+        hosts = Map[(GetField[#, Host] <> ":" <> ToString[GetField[#, Port]])&, DiscoverServers[]];
+        If[hosts === {}, Message[EureqaSearch::noserv]; Return[$Failed]]];
+      SweepClear[];
+      Check[Scan[SweepDataSet[#, OptionValue[VariableLabels]]&, datas];
+            Scan[SweepRelationship, models];
+            Scan[Apply[SweepOptions, #]&, If[optionSets === {}, {{}}, optionSets]],
+            Return[$Failed]];
+      SweepRun[Flatten[{hosts}], 
+               If[maxGenerations === Infinity, 0, maxGenerations], 
+               If[maxSeconds === Infinity, 0, maxSeconds]]];
+
+    Options[EureqaCrossValidate] = {
+      Host -> "localhost",
+      VariableLabels -> Automatic,
+      Folds -> 5,
+      MaxGenerations -> 1000,
+      MaxSeconds -> Infinity
+      };
+
+    EureqaCrossValidate[data_?MatrixQ, model_String, opts:OptionsPattern[]] :=
+     Module[{hosts = OptionValue[Host], 
+       maxGenerations = OptionValue[MaxGenerations], 
+       maxSeconds = OptionValue[MaxSeconds]},
+      If[maxGenerations === Infinity && maxSeconds === Infinity,
+        Message[EureqaCrossValidate::nolimit]; Return[$Failed]];
+      If[hosts === Automatic,
+        hosts = Map[(GetField[#, Host] <> ":" <> ToString[GetField[#, Port]])&, DiscoverServers[]];
+        If[hosts === {}, Message[EureqaSearch::noserv]; Return[$Failed]]];
+      SweepClear[];
+      Check[SweepDataSet[data, OptionValue[VariableLabels]];
+            SweepRelationship[model];
+            Apply[SweepOptions, FilterRules[{opts}, SendOptionsOptions]],
+            Return[$Failed]];
+      CrossValidate[Flatten[{hosts}], OptionValue[Folds], 
+                    If[maxGenerations === Infinity, 0, maxGenerations], 
+                    If[maxSeconds === Infinity, 0, maxSeconds]]];
+
+    Options[LaunchServers] = {
+      ServerProgram -> Automatic,
+      Pinning -> "NUMA"
+      };
+
+    LaunchServers[opts___Rule] := LaunchServers[0, opts];
+    LaunchServers[count_Integer, opts:OptionsPattern[]] :=
+     Module[{program = OptionValue[ServerProgram], 
+       pinning = OptionValue[Pinning] /. {"NUMA" -> 2, "Cores" -> 1, None -> 0}},
+      If[! IntegerQ[pinning], Message[LaunchServers::pin]; Return[$Failed]];
+      If[program === Automatic,
+        program = Environment["EUREQA_SERVER"];
+        If[program === $Failed, program = "eureqa_server"]];
+      LaunchServers[count, program, pinning]];
+
     EureqaSearch[data_?MatrixQ, searchRelationship_String, 
       opts : OptionsPattern[]] := 
-     Module[{host = OptionValue[Host], frontier, frontierGrid = "", status = "", 
+     Module[{host = OptionValue[Host], servers, frontier, frontierGrid = "", status = "", 
        progress = {}, generations, progressGrid = "", loop = True,
        maxGenerations = OptionValue[MaxGenerations]},
       CellGroup[{
@@ -338,7 +514,16 @@ BeginPackage["EureqaClient`"];
         CellPrint[ExpressionCell[Dynamic[progressGrid], "Output"]],
         CellPrint[TextCell[Dynamic[status], "Output"]]
         }];
-      status = "Connecting to '" <> host <> "'...";
+      If[host === Automatic,
+        status = "Looking for Eureqa servers...";
+        servers = DiscoverServers[];
+        If[servers === {},
+          Message[EureqaSearch::noserv];
+          status = "No Eureqa servers found."; Return[]];
+        host = GetField[First[servers], Host] <> ":" <> ToString[GetField[First[servers], Port]]];
+      SetReconnect[OptionValue[Reconnect]];
+      SetSharedDirectory[OptionValue[SharedDirectory]];
+      status = "Connecting to '" <> StringJoin[Riffle[Flatten[{host}], "', '"]] <> "'...";
       Check[ConnectTo[host], Return[]];
       status = "Sending data set...";
       Check[SendDataSet[data, OptionValue[VariableLabels]], 
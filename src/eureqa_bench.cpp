@@ -0,0 +1,131 @@
+/*
+  eureqa_bench.cpp
+
+  Compares the packet encodings the Eureqa Client can use on the wire.
+  For every message type it reports the packet size and the time taken
+  to encode and decode it with each encoding. The XML row uses the
+  hand-written codec where a message has one, the Archive row always
+  goes through the boost XML archives.  eureqa_check_xml checks that
+  the two produce the same bytes.
+
+  Licensed under the GNU General Public License.
+
+*/
+
+/*
+   Usage:
+
+    $ eureqa_bench [iterations]
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <eureqa/eureqa.h>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+/* Microseconds spent per call of f, averaged over n calls. */
+template<typename F>
+double time_per_call(F f, int n)
+{
+    boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+    for (int i = 0; i < n; i++) {
+        f();
+    }
+    boost::posix_time::time_duration elapsed = boost::posix_time::microsec_clock::universal_time() - start;
+    return elapsed.total_microseconds() / (double) n;
+}
+
+/* Encodes with the boost archives when archive is set, with encode_packet otherwise. */
+template<typename T>
+struct encode_call {
+    int encoding; bool archive; const T& val; const char* name; std::string& packet;
+    encode_call(int e, bool a, const T& v, const char* n, std::string& p) : encoding(e), archive(a), val(v), name(n), packet(p) { }
+    void operator()() {
+        if (archive) eureqa::encode_archive(encoding, val, name, packet);
+        else eureqa::encode_packet(encoding, val, name, packet);
+    }
+};
+
+/* Decodes into the same object every call, as a polling client does. */
+template<typename T>
+struct decode_call {
+    bool archive; const std::string& packet; const char* name; T& val;
+    decode_call(bool a, const std::string& p, const char* n, T& v) : archive(a), packet(p), name(n), val(v) { }
+    void operator()() {
+        if (archive) eureqa::decode_archive(packet.data(), packet.size(), name, val);
+        else eureqa::decode_packet(packet, name, val);
+    }
+};
+
+template<typename T>
+void bench_message(const char* name, const T& val, int n)
+{
+    int encodings[] = { eureqa::encodings::xml, eureqa::encodings::xml, eureqa::encodings::binary };
+    bool archives[] = { false, true, false };
+    for (int i = 0; i < 3; i++) {
+        std::string packet;
+        T decoded;
+        double encode_us = time_per_call(encode_call<T>(encodings[i], archives[i], val, name, packet), n);
+        double decode_us = time_per_call(decode_call<T>(archives[i], packet, name, decoded), n);
+        std::cout << std::left << std::setw(22) << name
+                  << std::setw(8) << (archives[i] ? "Archive" : eureqa::encodings::str(encodings[i]).c_str())
+                  << std::right << std::setw(10) << packet.size()
+                  << std::setw(14) << std::fixed << std::setprecision(2) << encode_us
+                  << std::setw(14) << decode_us << std::endl;
+    }
+}
+
+eureqa::solution_info make_solution(int i)
+{
+    eureqa::solution_info soln("f(x) = 1.2345*x^" + boost::lexical_cast<std::string>(i) + " + sin(2.5*x)");
+    soln.score_ = i;
+    soln.fitness_ = -1.0f / (i + 1);
+    soln.complexity_ = i;
+    soln.age_ = i;
+    return soln;
+}
+
+int main(int argc, char* argv[])
+{
+    int n = argc > 1 ? std::atoi(argv[1]) : 1000;
+
+    eureqa::data_set data(1000, 4);
+    for (int i = 0; i < data.size(); i++)
+        for (int j = 0; j < data.num_vars(); j++)
+            data(i,j) = i * 0.5f + j;
+
+    eureqa::search_options options("y = f(x0, x1, x2)");
+
+    std::vector<eureqa::solution_info> individuals;
+    eureqa::solution_frontier front;
+    for (int i = 0; i < 20; i++) {
+        individuals.push_back(make_solution(i));
+        front.add(make_solution(i));
+    }
+
+    eureqa::search_progress progress;
+    progress.solution_ = make_solution(3);
+    progress.generations_ = 1234;
+    progress.generations_per_sec_ = 12.5f;
+    progress.evaluations_ = 9.87e8f;
+    progress.evaluations_per_sec_ = 1.5e6f;
+    progress.total_population_size_ = 1064;
+
+    eureqa::server_info info;
+    info.hostname_ = "eureqa-server";
+    info.operating_system_ = "Linux";
+    info.eureqa_version_ = 1.02;
+    info.cpu_cores_ = 8;
+
+    std::cout << std::left << std::setw(22) << "Message:" << std::setw(8) << "Format:"
+              << std::right << std::setw(10) << "Bytes:" << std::setw(14) << "Encode (us):"
+              << std::setw(14) << "Decode (us):" << std::endl;
+    bench_message("data_set", data, n / 10 + 1);
+    bench_message("search_options", options, n);
+    bench_message("vector_solution_info", individuals, n);
+    bench_message("search_progress", progress, n);
+    bench_message("server_info", info, n);
+    bench_message("solution_frontier", front, n);
+    return 0;
+}
@@ -0,0 +1,324 @@
+/*
+  eureqa_broker.cpp
+
+  Shares one connection to a Eureqa server between the Mathematica
+  kernels on this machine.
+
+  Every kernel that loads the Eureqa Client runs its own eureqaml, so
+  N parallel kernels watching one search poll the server N times per
+  tick. The broker owns the only connection to the server and serves
+  the kernels over a Unix socket. A query_progress or query_frontier
+  that arrives within one polling interval of the last call the broker
+  made for it is answered with that call's response, so the server
+  sees one poll per interval however many kernels are watching. Every
+  other command is passed through, and clears the saved responses.
+
+  If the server connection drops, the broker reconnects for the next
+  command and closes the kernels that were connected before, so their
+  sessions notice and restore the search.
+
+  Licensed under the GNU General Public License.
+
+*/
+
+/*
+   Usage:
+
+    $ eureqa_broker [-s socket_path] [-i interval_ms] server_host[:port]
+
+   The broker listens on /tmp/eureqa_broker by default and merges polls
+   that arrive within 500 ms. Kernels connect with
+
+    ConnectTo["unix:/tmp/eureqa_broker"]
+
+   or EureqaSearch[..., Host -> "unix:/tmp/eureqa_broker"]. Run one
+   broker, each with its own socket, per server.
+ */
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <map>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include <eureqa/eureqa.h>
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+using boost::asio::ip::tcp;
+typedef boost::asio::local::stream_protocol local;
+typedef boost::shared_ptr<local::socket> socket_ptr;
+
+static const char* default_socket_path = "/tmp/eureqa_broker";
+static const int default_interval_ms = 500;
+
+static boost::mutex log_mutex;
+
+void log_line(const std::string& line)
+{
+    boost::mutex::scoped_lock lock(log_mutex);
+    std::cout << line << std::endl;
+}
+
+/* Protocol I/O, the messages are kept as the bytes sent on the wire. */
+
+template<typename Socket>
+bool read_bytes(Socket& s, void* data, std::size_t size)
+{
+    boost::system::error_code error;
+    boost::asio::read(s, boost::asio::buffer(data, size), boost::asio::transfer_all(), error);
+    return !error;
+}
+
+template<typename Socket>
+bool write_bytes(Socket& s, const std::string& data)
+{
+    boost::system::error_code error;
+    boost::asio::write(s, boost::asio::buffer(data), boost::asio::transfer_all(), error);
+    return !error;
+}
+
+/* Reads an int and appends it to raw. */
+template<typename Socket>
+bool read_int(Socket& s, std::string& raw, int& value)
+{
+    if (!read_bytes(s, &value, sizeof(int))) return false;
+    raw.append((const char*) &value, sizeof(int));
+    return true;
+}
+
+/* Reads a size/data packet and appends it to raw. */
+template<typename Socket>
+bool read_packet(Socket& s, std::string& raw)
+{
+    int size;
+    if (!read_int(s, raw, size) || size < 0) return false;
+    std::size_t at = raw.size();
+    raw.resize(at + size);
+    return size == 0 || read_bytes(s, &raw[at], size);
+}
+
+/* Reads a command from a kernel, fails on commands whose layout is not known. */
+template<typename Socket>
+bool read_command(Socket& s, std::string& raw, int& cmd)
+{
+    raw.clear();
+    if (!read_int(s, raw, cmd) || !eureqa::commands::is_known(cmd)) return false;
+    int argument;
+    if (eureqa::commands::has_argument(cmd) && !read_int(s, raw, argument)) return false;
+    if (eureqa::commands::has_packet(cmd) && !read_packet(s, raw)) return false;
+    return true;
+}
+
+/* Reads the server's response to a command, or its greeting when cmd is 0. */
+template<typename Socket>
+bool read_response(Socket& s, int cmd, std::string& raw)
+{
+    raw.clear();
+    int value;
+    if (!eureqa::commands::returns_packet(cmd) && !read_int(s, raw, value)) return false;
+    return read_packet(s, raw);
+}
+
+/* A command_result as the server would send it. */
+std::string make_result(int value, const std::string& message)
+{
+    std::string raw;
+    raw.append((const char*) &value, sizeof(int));
+    int size = (int) message.size();
+    raw.append((const char*) &size, sizeof(int));
+    raw += message;
+    return raw;
+}
+
+/* Polls whose responses are shared between kernels. */
+bool is_poll(int cmd)
+{
+    return cmd == eureqa::commands::query_progress || cmd == eureqa::commands::query_frontier;
+}
+
+/* The broker's connection to the server, shared by every kernel. */
+class upstream {
+public:
+    upstream(const std::string& host, int port, int interval_ms)
+        : socket_(io_service_), host_(host), port_(port), interval_ms_(interval_ms),
+          generation_(0), calls_(0), merged_(0) { }
+
+    /* The server's greeting for a kernel that has just connected, and the
+       connection it was given on. */
+    bool greet(std::string& raw, int& generation);
+
+    /* Sends a kernel's command and reads the response. Fails if the server
+       cannot be reached, or if it has been reconnected since the kernel was
+       greeted, as the server will have lost that kernel's search. */
+    bool forward(int generation, int cmd, const std::string& request, std::string& response);
+
+    int calls() { boost::mutex::scoped_lock lock(mutex_); return calls_; }
+    int merged() { boost::mutex::scoped_lock lock(mutex_); return merged_; }
+
+private:
+    /* A poll's response and when the server gave it. */
+    struct saved_response {
+        std::string raw;
+        boost::posix_time::ptime at;
+    };
+
+    bool ensure_connected();
+    void close();
+
+    boost::asio::io_service io_service_;
+    tcp::socket socket_;
+    std::string host_;
+    int port_;
+    int interval_ms_;
+    std::string greeting_;
+    int generation_;     /* bumped on every reconnect */
+    std::map<int, saved_response> polls_;
+    int calls_;          /* commands sent to the server */
+    int merged_;         /* polls answered without one */
+    boost::mutex mutex_; /* one command on the server connection at a time */
+};
+
+bool upstream::greet(std::string& raw, int& generation)
+{
+    boost::mutex::scoped_lock lock(mutex_);
+    if (!ensure_connected()) return false;
+    raw = greeting_;
+    generation = generation_;
+    return true;
+}
+
+bool upstream::forward(int generation, int cmd, const std::string& request, std::string& response)
+{
+    boost::mutex::scoped_lock lock(mutex_);
+    if (generation != generation_ || !socket_.is_open()) return false;
+
+    // kernels waiting on the lock while a poll was made get its response
+    boost::posix_time::ptime now = boost::posix_time::microsec_clock::universal_time();
+    if (is_poll(cmd)) {
+        std::map<int, saved_response>::iterator saved = polls_.find(cmd);
+        if (saved != polls_.end() && now - saved->second.at < boost::posix_time::milliseconds(interval_ms_)) {
+            response = saved->second.raw;
+            merged_++;
+            return true;
+        }
+    }
+
+    calls_++;
+    if (!write_bytes(socket_, request) || !read_response(socket_, cmd, response)) {
+        close();
+        return false;
+    }
+    if (is_poll(cmd)) {
+        saved_response& saved = polls_[cmd];
+        saved.raw = response;
+        saved.at = boost::posix_time::microsec_clock::universal_time();
+    } else {
+        // the search may have changed
+        polls_.clear();
+    }
+    return true;
+}
+
+bool upstream::ensure_connected()
+{
+    if (socket_.is_open()) return true;
+    try {
+        tcp::resolver resolver(io_service_);
+        tcp::resolver::query query(host_, boost::lexical_cast<std::string>(port_));
+        tcp::resolver::iterator endpoint_iterator = resolver.resolve(query);
+        tcp::resolver::iterator end;
+        boost::system::error_code error = boost::asio::error::host_not_found;
+        while (error && endpoint_iterator != end) {
+            socket_.close();
+            socket_.connect(*endpoint_iterator++, error);
+        }
+        if (error) { close(); return false; }
+        socket_.set_option(tcp::no_delay(true));
+    } catch (...) {
+        close();
+        return false;
+    }
+    if (!read_response(socket_, 0, greeting_)) { close(); return false; }
+    generation_++;
+    return true;
+}
+
+void upstream::close()
+{
+    boost::system::error_code ignored;
+    socket_.close(ignored);
+    polls_.clear();
+}
+
+/* Serves one kernel until it disconnects or the server connection is lost. */
+void kernel_session(socket_ptr kernel, upstream* server, int id)
+{
+    std::string raw, response;
+    int generation, cmd, commands = 0;
+
+    if (!server->greet(response, generation)) {
+        write_bytes(*kernel, make_result(eureqa::result_error, "Unable to reach the Eureqa server behind the broker"));
+        return;
+    }
+    if (!write_bytes(*kernel, response)) return;
+
+    while (read_command(*kernel, raw, cmd)) {
+        commands++;
+        if (!server->forward(generation, cmd, raw, response)) break;
+        if (!write_bytes(*kernel, response)) break;
+    }
+
+    std::ostringstream os;
+    os << "kernel " << id << " closed after " << commands << " commands; "
+       << server->calls() << " sent to the server and " << server->merged() << " polls merged in all";
+    log_line(os.str());
+}
+
+int usage()
+{
+    std::cerr << "usage: eureqa_broker [-s socket_path] [-i interval_ms] server_host[:port]" << std::endl;
+    return 1;
+}
+
+int main(int argc, char* argv[])
+{
+    std::string path = default_socket_path;
+    int interval_ms = default_interval_ms;
+    std::string address;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-s" && i + 1 < argc) path = argv[++i];
+        else if (arg == "-i" && i + 1 < argc) interval_ms = std::atoi(argv[++i]);
+        else if (address.empty() && arg[0] != '-') address = arg;
+        else return usage();
+    }
+    if (address.empty()) return usage();
+
+    std::string host;
+    int port = eureqa::default_port_tcp;
+    eureqa::connection::parse_address(address, host, port);
+    upstream server(host, port, interval_ms);
+
+    try {
+        boost::asio::io_service io_service;
+        ::unlink(path.c_str()); // left behind by an earlier broker
+        local::acceptor acceptor(io_service, local::endpoint(path));
+        std::ostringstream os;
+        os << "listening on " << path << ", sharing " << host << ":" << port
+           << ", polls merged within " << interval_ms << " ms";
+        log_line(os.str());
+        for (int id = 1;; id++) {
+            socket_ptr s(new local::socket(io_service));
+            acceptor.accept(*s);
+            boost::thread(boost::bind(kernel_session, s, &server, id)).detach();
+        }
+    } catch (std::exception& e) {
+        std::cerr << "eureqa_broker: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,217 @@
+/*
+  eureqa_check_relay.cpp
+
+  Checks eureqa_relay end to end.  It runs a far and a near relay in
+  front of a mock server, and runs the same session against the mock
+  server directly and through the relays.  The session sends a data
+  set twice, so the second one crosses the link by reference, then
+  options and individuals.  It reads back the frontier and has the
+  individuals scored.  Every result must be the same both ways.
+
+  The check is run twice: once with the far relay's data-set cache, and
+  once with no cache, so every data set sent by reference is a miss the
+  near relay has to send again in full.  Exits with a non-zero status
+  on any difference.
+
+  Licensed under the GNU General Public License.
+
+*/
+
+/*
+   Usage:
+
+    $ eureqa_check_relay path/to/eureqa_relay
+ */
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <eureqa/eureqa.h>
+#include <eureqa/mock_server.h>
+
+/* What a session got back, each value by its binary encoding. */
+struct session_results {
+    std::vector<std::string> results;
+    std::string frontier;
+    std::string scored;
+    bool ok;
+};
+
+eureqa::solution_info make_solution(int i)
+{
+    eureqa::solution_info soln("y = 1.2345*x0^" + boost::lexical_cast<std::string>(i) + " + sin(2.5*x1)");
+    soln.score_ = i;
+    soln.fitness_ = -1.0f / (i + 1);
+    soln.complexity_ = i;
+    soln.age_ = i;
+    return soln;
+}
+
+/* Runs the session against host:port, ok is false if any call failed. */
+session_results run_session(int port)
+{
+    session_results r;
+    r.ok = false;
+    eureqa::connection conn;
+    if (!conn.connect("127.0.0.1", port)) return r;
+
+    eureqa::data_set data(500, 3);
+    data.set_default_symbols();
+    for (int i = 0; i < data.size(); i++)
+        for (int j = 0; j < data.num_vars(); j++)
+            data(i,j) = i * 0.25f + j;
+    eureqa::search_options options("y = f(x0, x1)");
+    std::vector<eureqa::solution_info> individuals;
+    for (int i = 0; i < 10; i++)
+        individuals.push_back(make_solution(i));
+
+    for (int i = 0; i < 2; i++) {
+        if (!conn.send_data_set(data)) return r;
+        r.results.push_back(conn.last_result().message_);
+    }
+    if (!conn.send_options(options)) return r;
+    r.results.push_back(conn.last_result().message_);
+    if (!conn.send_individuals(individuals)) return r;
+    r.results.push_back(conn.last_result().message_);
+
+    eureqa::solution_frontier front;
+    if (!conn.query_frontier(front)) return r;
+    eureqa::encode_packet(eureqa::encodings::binary, front, "solution_frontier", r.frontier);
+    if (!conn.calc_solution_info(individuals)) return r;
+    eureqa::encode_packet(eureqa::encodings::binary, individuals, "vector_solution_info", r.scored);
+    r.ok = true;
+    return r;
+}
+
+/* A port nothing is listening on, for a relay to take. */
+int free_port()
+{
+    boost::asio::io_service io_service;
+    boost::asio::ip::tcp::acceptor acceptor(io_service, boost::asio::ip::tcp::endpoint(boost::asio::ip::address::from_string("127.0.0.1"), 0));
+    return acceptor.local_endpoint().port();
+}
+
+/* Starts the relay with args, and waits for it to listen on port. */
+pid_t start_relay(const std::string& relay, const std::vector<std::string>& args, int port)
+{
+    std::vector<char*> argv;
+    argv.push_back(const_cast<char*>(relay.c_str()));
+    for (std::size_t i = 0; i < args.size(); i++)
+        argv.push_back(const_cast<char*>(args[i].c_str()));
+    argv.push_back(0);
+    pid_t pid = fork();
+    if (pid == 0) {
+        execv(argv[0], &argv[0]);
+        _exit(127);
+    }
+    if (pid < 0) return pid;
+
+    for (int i = 0; i < 100; i++) {
+        boost::asio::io_service io_service;
+        boost::asio::ip::tcp::socket s(io_service);
+        boost::system::error_code error;
+        s.connect(boost::asio::ip::tcp::endpoint(boost::asio::ip::address::from_string("127.0.0.1"), port), error);
+        if (!error) return pid;
+        if (waitpid(pid, 0, WNOHANG) == pid) return -1;
+        boost::this_thread::sleep(boost::posix_time::milliseconds(50));
+    }
+    kill(pid, SIGKILL);
+    waitpid(pid, 0, 0);
+    return -1;
+}
+
+void stop_relay(pid_t pid)
+{
+    kill(pid, SIGKILL);
+    waitpid(pid, 0, 0);
+}
+
+/* Compares a session through a pair of relays with one straight to a server, true if they match. */
+bool check_relay(const std::string& relay, const char* far_cache_mb)
+{
+    eureqa::mock_server direct_server, relayed_server;
+    if (!direct_server.listen() || !relayed_server.listen()) {
+        std::cerr << "unable to start the mock servers" << std::endl;
+        return false;
+    }
+
+    std::vector<std::string> far_args, near_args;
+    int far_port = free_port(), near_port = free_port();
+    std::ostringstream server, far;
+    server << "127.0.0.1:" << relayed_server.port();
+    far << "127.0.0.1:" << far_port;
+    far_args.push_back("far");
+    far_args.push_back("-l");
+    far_args.push_back(boost::lexical_cast<std::string>(far_port));
+    far_args.push_back("-c");
+    far_args.push_back(far_cache_mb);
+    far_args.push_back(server.str());
+    near_args.push_back("near");
+    near_args.push_back("-l");
+    near_args.push_back(boost::lexical_cast<std::string>(near_port));
+    near_args.push_back(far.str());
+
+    pid_t far_pid = start_relay(relay, far_args, far_port);
+    if (far_pid < 0) {
+        std::cerr << "unable to start the far relay " << relay << std::endl;
+        return false;
+    }
+    pid_t near_pid = start_relay(relay, near_args, near_port);
+    if (near_pid < 0) {
+        std::cerr << "unable to start the near relay " << relay << std::endl;
+        stop_relay(far_pid);
+        return false;
+    }
+
+    session_results expected = run_session(direct_server.port());
+    session_results relayed = run_session(near_port);
+    stop_relay(near_pid);
+    stop_relay(far_pid);
+
+    std::string label = std::string("far cache of ") + far_cache_mb + " MB";
+    if (!expected.ok) {
+        std::cerr << label << ": the session failed against the mock server" << std::endl;
+        return false;
+    }
+    if (!relayed.ok) {
+        std::cerr << label << ": the session failed through the relays" << std::endl;
+        return false;
+    }
+    bool same = true;
+    if (relayed.results != expected.results) {
+        std::cerr << label << ": command results differ through the relays" << std::endl;
+        same = false;
+    }
+    if (relayed.frontier != expected.frontier) {
+        std::cerr << label << ": the frontier differs through the relays" << std::endl;
+        same = false;
+    }
+    if (relayed.scored != expected.scored) {
+        std::cerr << label << ": the scored individuals differ through the relays" << std::endl;
+        same = false;
+    }
+    return same;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc != 2) {
+        std::cerr << "usage: eureqa_check_relay path/to/eureqa_relay" << std::endl;
+        return 2;
+    }
+    std::string relay = argv[1];
+
+    int failures = 0;
+    failures += !check_relay(relay, "64");
+    failures += !check_relay(relay, "0");
+    if (failures > 0) {
+        std::cerr << failures << " relay checks failed" << std::endl;
+        return 1;
+    }
+    std::cout << "Sessions through the relays match the server's" << std::endl;
+    return 0;
+}
@@ -0,0 +1,121 @@
+/*
+  eureqa_check_xml.cpp
+
+  Checks that the hand-written XML codec produces the same bytes as the
+  boost XML archives for every message it handles, and that decoding
+  those bytes gives the same values.  Ordinary and awkward values are
+  both checked: characters that need escaping, float extremes and empty
+  containers.  Exits with a non-zero status on any difference, so it
+  runs as a test with ctest or make check.
+
+  Licensed under the GNU General Public License.
+
+*/
+
+/*
+   Usage:
+
+    $ eureqa_check_xml
+ */
+
+#include <iostream>
+#include <eureqa/eureqa.h>
+
+/* Checks one value of a message, returns false on any difference. */
+template<typename T>
+bool check_message(const char* name, const T& val)
+{
+    std::string expected, packet;
+    eureqa::encode_archive(eureqa::encodings::xml, val, name, expected);
+    eureqa::encode_packet(eureqa::encodings::xml, val, name, packet);
+    if (packet != expected) {
+        std::cerr << name << ": encoded packet differs from the archive" << std::endl;
+        std::cerr << "archive:" << std::endl << expected << std::endl;
+        std::cerr << "codec:" << std::endl << packet << std::endl;
+        return false;
+    }
+
+    // compare the decoded objects by their binary encoding
+    T from_archive, decoded;
+    eureqa::decode_archive(expected.data(), expected.size(), name, from_archive);
+    if (!eureqa::fast_decode(expected.data(), expected.size(), name, decoded)) {
+        std::cerr << name << ": packet not recognized by the decoder" << std::endl;
+        return false;
+    }
+    std::string a, b;
+    eureqa::encode_packet(eureqa::encodings::binary, from_archive, name, a);
+    eureqa::encode_packet(eureqa::encodings::binary, decoded, name, b);
+    if (a != b) {
+        std::cerr << name << ": decoded values differ from the archive" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+eureqa::solution_info make_solution(int i)
+{
+    eureqa::solution_info soln("f(x) = 1.2345*x^" + boost::lexical_cast<std::string>(i) + " + sin(2.5*x)");
+    soln.score_ = i;
+    soln.fitness_ = -1.0f / (i + 1);
+    soln.complexity_ = i;
+    soln.age_ = i;
+    return soln;
+}
+
+int main(int argc, char* argv[])
+{
+    std::vector<eureqa::solution_info> individuals;
+    eureqa::solution_frontier front;
+    for (int i = 0; i < 20; i++) {
+        individuals.push_back(make_solution(i));
+        front.add(make_solution(i));
+    }
+
+    eureqa::search_progress progress;
+    progress.solution_ = make_solution(3);
+    progress.generations_ = 1234;
+    progress.generations_per_sec_ = 12.5f;
+    progress.evaluations_ = 9.87e8f;
+    progress.evaluations_per_sec_ = 1.5e6f;
+    progress.total_population_size_ = 1064;
+
+    eureqa::server_info info;
+    info.hostname_ = "eureqa-server";
+    info.operating_system_ = "Linux";
+    info.eureqa_version_ = 1.02;
+    info.cpu_cores_ = 8;
+
+    // awkward values: characters that need escaping, extremes, an empty frontier
+    eureqa::solution_info awkward("f(x) = x<1 && x>'0' ? \"a\" : b");
+    awkward.score_ = 3.4e38f;
+    awkward.fitness_ = -1.17549435e-38f;
+    awkward.complexity_ = 0;
+    awkward.age_ = 4294967295u;
+    eureqa::search_progress awkward_progress;
+    awkward_progress.solution_ = awkward;
+    awkward_progress.total_population_size_ = -1;
+    eureqa::server_info awkward_info;
+    awkward_info.hostname_ = "<&>\"'";
+    std::vector<eureqa::solution_info> awkward_individuals(1, awkward);
+    awkward_individuals.push_back(eureqa::solution_info());
+
+    // every check runs, so one failure does not hide another
+    int failures = 0;
+    failures += !check_message("search_progress", progress);
+    failures += !check_message("search_progress", awkward_progress);
+    failures += !check_message("search_progress", eureqa::search_progress());
+    failures += !check_message("server_info", info);
+    failures += !check_message("server_info", awkward_info);
+    failures += !check_message("solution_frontier", front);
+    failures += !check_message("solution_frontier", eureqa::solution_frontier());
+    failures += !check_message("vector_solution_info", individuals);
+    failures += !check_message("vector_solution_info", awkward_individuals);
+    failures += !check_message("vector_solution_info", std::vector<eureqa::solution_info>());
+
+    if (failures > 0) {
+        std::cerr << failures << " XML codec checks failed" << std::endl;
+        return 1;
+    }
+    std::cout << "The XML codec matches the boost archives" << std::endl;
+    return 0;
+}
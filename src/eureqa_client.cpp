@@ -0,0 +1,35 @@
+/*
+  eureqa_client.cpp
+
+  The compiled part of the Eureqa API, built as libeureqa_client.
+  Programs that link against it define EUREQA_SEPARATE_COMPILATION,
+  so the boost archive code for the protocol's types is compiled here
+  once rather than in every translation unit that includes
+  eureqa/eureqa.h.  When boost is new enough it also holds boost asio,
+  built with BOOST_ASIO_SEPARATE_COMPILATION.
+
+  eureqa::default_io_service is a single io_service per process,
+  shared by every translation unit.
+
+  Licensed under the GNU General Public License.
+
+*/
+
+#include <eureqa/eureqa.h>
+
+#ifdef BOOST_ASIO_SEPARATE_COMPILATION
+#include <boost/asio/impl/src.hpp>
+#endif
+
+namespace eureqa
+{
+template void encode_stream(int, const eureqa::data_set&, const char*, std::ostream&);
+template void encode_stream(int, const eureqa::search_options&, const char*, std::ostream&);
+template void encode_stream(int, const std::vector<eureqa::solution_info>&, const char*, std::ostream&);
+template void decode_archive(const char*, std::size_t, const char*, eureqa::search_progress&);
+template void decode_archive(const char*, std::size_t, const char*, eureqa::server_info&);
+template void decode_archive(const char*, std::size_t, const char*, eureqa::solution_frontier&);
+template void decode_archive(const char*, std::size_t, const char*, eureqa::solution_arena_frontier&);
+template void decode_archive(const char*, std::size_t, const char*, eureqa::solution_arena&);
+template void decode_archive(const char*, std::size_t, const char*, std::vector<eureqa::solution_info>&);
+}
@@ -0,0 +1,309 @@
+/*
+  eureqa_load.cpp
+
+  Finds how many concurrent searches one client host can watch. It runs
+  a number of client sessions at once, each on its own thread with its
+  own eureqa::connection, as eureqaml does for every kernel. Each
+  session repeatedly connects, uploads a data set, sends the options,
+  starts the search, polls its progress and frontier, and ends it.
+
+  The load is stepped through a list of session counts. For each step
+  it reports the sustained polls per second, the p50/p99/p999 latency
+  of every command, and the client CPU time spent per poll. The CPU is
+  measured on the session threads alone where the system can do so
+  (RUSAGE_THREAD), so a server run in the same process is not counted.
+  Once polls per second stop growing with the sessions, or the CPU per
+  poll or the latency climbs, the client is the bottleneck.
+
+  Licensed under the GNU General Public License.
+
+*/
+
+/*
+   Usage:
+
+    $ eureqa_load [-n sessions,...] [-t seconds] [-i interval_ms] [-p polls]
+                  [-r rows] [-m] [server_host[:port]]
+
+   -n  session counts to step through, 1,10,100,200,400 by default
+   -t  seconds each step runs for, 10 by default
+   -i  wait between polls in each session, 100 ms by default, 0 polls flat out
+   -p  polls per search before it is ended and the cycle starts again, 50 by default
+   -r  rows in the uploaded data set, 1000 by default
+   -m  runs against an eureqa::mock_server in this process rather than a server
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <cstdlib>
+#include <cmath>
+#include <eureqa/eureqa.h>
+#include <eureqa/mock_server.h>
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#ifndef WIN32
+#include <sys/time.h>
+#include <sys/resource.h>
+#endif
+
+static boost::posix_time::ptime now()
+{
+    return boost::posix_time::microsec_clock::universal_time();
+}
+
+/* CPU seconds used by the calling thread, or by the process where
+   threads cannot be measured on their own. */
+double cpu_seconds()
+{
+#ifdef RUSAGE_THREAD
+    struct rusage usage;
+    getrusage(RUSAGE_THREAD, &usage);
+#elif !defined(WIN32)
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#endif
+#ifndef WIN32
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+#else
+    return 0.0;
+#endif
+}
+
+/* What the sessions of a step measured, merged as each one finishes. */
+struct step_result {
+    std::map<int, std::vector<double> > latencies; /* ms, by command code */
+    long polls;
+    long cycles;
+    long failures;
+    double cpu;
+    boost::mutex mutex;
+    step_result() : polls(0), cycles(0), failures(0), cpu(0) { }
+};
+
+/* What every session is given. */
+struct load_options {
+    std::string host;
+    int port;
+    eureqa::mock_server* mock; /* connect in-process when set */
+    int interval_ms;
+    int polls;
+    eureqa::data_set data;
+    eureqa::search_options options;
+};
+
+/* One client session, run until the step's deadline. */
+class load_session {
+public:
+    load_session(const load_options& options, int id)
+        : options_(options), id_(id), polls_(0), cycles_(0), failures_(0) { }
+
+    void run(boost::posix_time::ptime deadline, step_result* result);
+
+private:
+    /* Times one command, a failed one is counted and not timed. */
+    template<typename F>
+    bool timed(int cmd, F f) {
+        boost::posix_time::ptime start = now();
+        bool success = f();
+        if (success && conn_.last_result().value() != eureqa::result_success) success = false;
+        if (!success) { failures_++; return false; }
+        latencies_[cmd].push_back((now() - start).total_microseconds() / 1000.0);
+        return true;
+    }
+    bool cycle(boost::posix_time::ptime deadline);
+    bool connect();
+
+    const load_options& options_;
+    int id_;
+    eureqa::connection conn_;
+    std::map<int, std::vector<double> > latencies_;
+    long polls_;
+    long cycles_;
+    long failures_;
+};
+
+bool load_session::connect()
+{
+    boost::posix_time::ptime start = now();
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+    bool success = options_.mock ? options_.mock->connect(conn_) : conn_.connect(options_.host, options_.port);
+#else
+    bool success = conn_.connect(options_.host, options_.port);
+#endif
+    if (!success) { failures_++; return false; }
+    latencies_[0].push_back((now() - start).total_microseconds() / 1000.0);
+    return true;
+}
+
+bool load_session::cycle(boost::posix_time::ptime deadline)
+{
+    using eureqa::connection;
+    eureqa::search_progress progress;
+    eureqa::solution_frontier front;
+
+    if (!conn_.is_connected() && !connect()) return false;
+    if (!timed(eureqa::commands::send_data_set, boost::bind(&connection::send_data_set, &conn_, boost::cref(options_.data)))) return false;
+    if (!timed(eureqa::commands::send_options, boost::bind(&connection::send_options, &conn_, boost::cref(options_.options)))) return false;
+    if (!timed(eureqa::commands::start_search, boost::bind(&connection::start_search, &conn_))) return false;
+
+    bool (connection::*query_frontier)(eureqa::solution_frontier&) = &connection::query_frontier;
+    for (int i = 0; i < options_.polls && now() < deadline; i++) {
+        if (!timed(eureqa::commands::query_progress, boost::bind(&connection::query_progress, &conn_, boost::ref(progress)))) return false;
+        if (!timed(eureqa::commands::query_frontier, boost::bind(query_frontier, &conn_, boost::ref(front)))) return false;
+        polls_++;
+        if (options_.interval_ms > 0) boost::this_thread::sleep(boost::posix_time::milliseconds(options_.interval_ms));
+    }
+
+    if (!timed(eureqa::commands::end_search, boost::bind(&connection::end_search, &conn_))) return false;
+    cycles_++;
+    return true;
+}
+
+void load_session::run(boost::posix_time::ptime deadline, step_result* result)
+{
+    double cpu_start = cpu_seconds();
+
+    // spread the sessions' first connects over one polling interval
+    if (options_.interval_ms > 0) {
+        boost::this_thread::sleep(boost::posix_time::microseconds((id_ * 7919L) % (options_.interval_ms * 1000L)));
+    }
+    while (now() < deadline) {
+        if (!cycle(deadline)) {
+            // start again on a fresh connection after a moment
+            conn_.disconnect();
+            boost::this_thread::sleep(boost::posix_time::milliseconds(100));
+        }
+    }
+    conn_.disconnect();
+    double cpu = cpu_seconds() - cpu_start;
+
+    boost::mutex::scoped_lock lock(result->mutex);
+    for (std::map<int, std::vector<double> >::iterator i = latencies_.begin(); i != latencies_.end(); ++i) {
+        std::vector<double>& all = result->latencies[i->first];
+        all.insert(all.end(), i->second.begin(), i->second.end());
+    }
+    result->polls += polls_;
+    result->cycles += cycles_;
+    result->failures += failures_;
+    result->cpu += cpu;
+}
+
+double percentile(const std::vector<double>& sorted, double p)
+{
+    if (sorted.empty()) return 0.0;
+    return sorted[(std::size_t) (p * (sorted.size() - 1) + 0.5)];
+}
+
+void run_step(const load_options& options, int sessions, int seconds)
+{
+    step_result result;
+    std::vector<boost::shared_ptr<load_session> > clients;
+    std::vector<boost::shared_ptr<boost::thread> > threads;
+    boost::posix_time::ptime start = now();
+    boost::posix_time::ptime deadline = start + boost::posix_time::seconds(seconds);
+    for (int i = 0; i < sessions; i++) {
+        clients.push_back(boost::shared_ptr<load_session>(new load_session(options, i)));
+        threads.push_back(boost::shared_ptr<boost::thread>(
+            new boost::thread(boost::bind(&load_session::run, clients[i], deadline, &result))));
+    }
+    for (int i = 0; i < sessions; i++) threads[i]->join();
+    double elapsed = (now() - start).total_microseconds() / 1e6;
+
+    std::cout << sessions << " sessions: " << std::fixed << std::setprecision(1)
+              << result.polls / elapsed << " polls/s, " << result.cycles << " searches, "
+              << result.failures << " failures, " << std::setprecision(2)
+              << (result.polls > 0 ? result.cpu * 1e6 / result.polls : 0.0) << " us client CPU per poll" << std::endl;
+    for (std::map<int, std::vector<double> >::iterator i = result.latencies.begin(); i != result.latencies.end(); ++i) {
+        std::vector<double>& samples = i->second;
+        std::sort(samples.begin(), samples.end());
+        std::cout << "  " << std::left << std::setw(20) << (i->first == 0 ? "connect" : eureqa::commands::name(i->first))
+                  << std::right << std::setw(10) << samples.size() << std::setprecision(3)
+                  << std::setw(12) << percentile(samples, 0.5) << std::setw(12) << percentile(samples, 0.99)
+                  << std::setw(12) << percentile(samples, 0.999) << std::setw(12) << samples.back() << std::endl;
+    }
+    std::cout << std::endl;
+}
+
+int usage()
+{
+    std::cerr << "usage: eureqa_load [-n sessions,...] [-t seconds] [-i interval_ms] [-p polls]" << std::endl
+              << "                   [-r rows] [-m] [server_host[:port]]" << std::endl;
+    return 1;
+}
+
+int main(int argc, char* argv[])
+{
+    std::vector<int> steps;
+    int seconds = 10, rows = 1000;
+    bool use_mock = false;
+    std::string address;
+    load_options options;
+    options.port = eureqa::default_port_tcp;
+    options.mock = 0;
+    options.interval_ms = 100;
+    options.polls = 50;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-n" && i + 1 < argc) {
+            std::istringstream is(argv[++i]);
+            int n;
+            char comma;
+            while (is >> n) { steps.push_back(n); is >> comma; }
+        }
+        else if (arg == "-t" && i + 1 < argc) seconds = std::atoi(argv[++i]);
+        else if (arg == "-i" && i + 1 < argc) options.interval_ms = std::atoi(argv[++i]);
+        else if (arg == "-p" && i + 1 < argc) options.polls = std::atoi(argv[++i]);
+        else if (arg == "-r" && i + 1 < argc) rows = std::atoi(argv[++i]);
+        else if (arg == "-m") use_mock = true;
+        else if (address.empty() && arg[0] != '-') address = arg;
+        else return usage();
+    }
+    if (steps.empty()) {
+        int defaults[] = { 1, 10, 100, 200, 400 };
+        steps.assign(defaults, defaults + 5);
+    }
+    if (address.empty() == !use_mock || seconds <= 0 || options.polls <= 0 || rows <= 0) return usage();
+
+    // a data set of a few smooth series, like a typical upload
+    options.data = eureqa::data_set(rows, 3);
+    options.data.set_default_symbols();
+    for (int i = 0; i < rows; i++) {
+        options.data.X_(i, 0) = i * 0.01;
+        options.data.X_(i, 1) = std::sin(i * 0.01);
+        options.data.X_(i, 2) = options.data.X_(i, 0) * options.data.X_(i, 1);
+    }
+    options.options = eureqa::search_options("x2 = f(x0, x1)");
+
+    eureqa::mock_server mock;
+    if (use_mock) {
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+        options.mock = &mock;
+        std::cout << "against a mock server in this process" << std::endl;
+#else
+        if (!mock.listen()) { std::cerr << "eureqa_load: unable to start the mock server" << std::endl; return 1; }
+        options.host = "127.0.0.1";
+        options.port = mock.port();
+        std::cout << "against a mock server on 127.0.0.1:" << options.port << std::endl;
+#endif
+    } else {
+        eureqa::connection::parse_address(address, options.host, options.port);
+        std::cout << "against " << options.host << ":" << options.port << std::endl;
+    }
+    std::cout << "each step runs " << seconds << " s, polls every " << options.interval_ms << " ms, "
+              << options.polls << " polls per search, " << rows << " rows uploaded" << std::endl
+              << "  " << std::left << std::setw(20) << "latencies in ms:" << std::right << std::setw(10) << "calls" << std::setw(12) << "p50"
+              << std::setw(12) << "p99" << std::setw(12) << "p999" << std::setw(12) << "max" << std::endl << std::endl;
+
+    for (std::size_t i = 0; i < steps.size(); i++) {
+        run_step(options, steps[i], seconds);
+    }
+    return 0;
+}
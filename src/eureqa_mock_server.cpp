@@ -0,0 +1,88 @@
+/*
+  eureqa_mock_server.cpp
+
+  Runs eureqa::mock_server, a stand-in for the Eureqa server, so the
+  client can be tested and benchmarked without one. It answers every
+  command with the server's framing from a synthetic search, and can
+  be made slow, narrow or unreliable to see how the client copes.
+
+  Programs that want the server in-process, without the tcp stack,
+  include eureqa/mock_server.h and call mock_server::connect() on a
+  connection instead.
+
+  Licensed under the GNU General Public License.
+
+*/
+
+/*
+   Usage:
+
+    $ eureqa_mock_server [-p port] [-a address] [-l latency_ms] [-j jitter_ms]
+                         [-b bytes_per_sec] [-d drop_rate] [-e error_rate]
+                         [-c corrupt_rate] [-s stall_rate] [-S stall_ms]
+                         [-g generations_per_sec] [-k max_complexity] [-r seed]
+
+   It listens on 127.0.0.1 and the Eureqa port by default. Rates are
+   chances per command, from 0 to 1. For example
+
+    $ eureqa_mock_server -p 22200 -l 40 -j 10 -d 0.01
+
+   answers after 30 to 50 ms and drops the connection on about one
+   command in a hundred.
+ */
+
+#include <iostream>
+#include <string>
+#include <cstdlib>
+#include <eureqa/eureqa.h>
+#include <eureqa/mock_server.h>
+#include <boost/thread.hpp>
+
+int usage()
+{
+    std::cerr << "usage: eureqa_mock_server [-p port] [-a address] [-l latency_ms] [-j jitter_ms]" << std::endl
+              << "                          [-b bytes_per_sec] [-d drop_rate] [-e error_rate]" << std::endl
+              << "                          [-c corrupt_rate] [-s stall_rate] [-S stall_ms]" << std::endl
+              << "                          [-g generations_per_sec] [-k max_complexity] [-r seed]" << std::endl;
+    return 1;
+}
+
+int main(int argc, char* argv[])
+{
+    eureqa::mock_server_options options;
+    int port = eureqa::default_port_tcp;
+    std::string address = "127.0.0.1";
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc || arg.size() != 2 || arg[0] != '-') return usage();
+        const char* value = argv[++i];
+        switch (arg[1]) {
+        case 'p': port = std::atoi(value); break;
+        case 'a': address = value; break;
+        case 'l': options.latency_ms_ = std::atoi(value); break;
+        case 'j': options.jitter_ms_ = std::atoi(value); break;
+        case 'b': options.bandwidth_ = std::atoi(value); break;
+        case 'd': options.drop_rate_ = std::atof(value); break;
+        case 'e': options.error_rate_ = std::atof(value); break;
+        case 'c': options.corrupt_rate_ = std::atof(value); break;
+        case 's': options.stall_rate_ = std::atof(value); break;
+        case 'S': options.stall_ms_ = std::atoi(value); break;
+        case 'g': options.generations_per_sec_ = std::atof(value); break;
+        case 'k': options.max_complexity_ = std::atoi(value); break;
+        case 'r': options.seed_ = (unsigned int) std::strtoul(value, 0, 10); break;
+        default: return usage();
+        }
+    }
+
+    eureqa::mock_server server(options);
+    if (!server.listen(port, address)) {
+        std::cerr << "eureqa_mock_server: unable to listen on " << address << ":" << port << std::endl;
+        return 1;
+    }
+    std::cout << "mock Eureqa server listening on " << address << ":" << server.port() << std::endl;
+    for (;;) {
+        boost::this_thread::sleep(boost::posix_time::seconds(60));
+        std::cout << server.sessions() << " sessions, " << server.commands() << " commands" << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,470 @@
+/*
+  eureqa_relay.cpp
+
+  Relays the Eureqa command protocol across a long-haul network link.
+
+  Run one relay next to the Eureqa server ("far") and one next to the
+  analysts ("near"). Clients connect to the near relay exactly as they
+  would to the server, and the far relay connects to the server as an
+  ordinary client, so neither end needs to change. Between the two
+  relays every command and response is compressed with zlib.
+
+  The far relay keeps the data-set packets it has forwarded in a cache
+  keyed by their SHA-1 hash. When a client sends a data set the near
+  relay has already sent in full over the same link, only the hash
+  crosses it; if the far relay has since evicted it, the near relay
+  sends it in full. Each client has a link of its own, so a new
+  connection starts with nothing sent.
+
+  Licensed under the GNU General Public License.
+
+*/
+
+/*
+   Usage:
+
+   Next to the Eureqa server:
+
+    $ eureqa_relay far [-l listen_port] [-c cache_mb] server_host[:port]
+
+   Next to the analysts, who then connect to this host:
+
+    $ eureqa_relay near [-l listen_port] [-z level] far_host[:port]
+
+   The near relay listens on the Eureqa port (22112) by default, the far
+   relay on 22113. The far relay caches up to 1024 MB of data sets.
+ */
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <list>
+#include <map>
+#include <set>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <zlib.h>
+#include <eureqa/eureqa.h>
+#include <boost/array.hpp>
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/version.hpp>
+#include <boost/uuid/detail/sha1.hpp>
+
+using boost::asio::ip::tcp;
+typedef boost::shared_ptr<tcp::socket> socket_ptr;
+
+/* Port the far relay listens on for near relays. */
+static const int default_port_relay = 22113;
+
+/* Kinds of frame sent between the relays. */
+namespace frames {
+static const int message = 1;      /* a command or a response, as the protocol bytes */
+static const int data_set_ref = 2; /* send_data_set by the hash of a packet sent earlier */
+static const int cache_miss = 3;   /* the far relay no longer has the referenced packet */
+}
+
+/* Precedes every frame, stored_size equals raw_size when the payload is not compressed. */
+struct frame_header {
+    int kind;
+    int raw_size;
+    int stored_size;
+};
+
+/* Messages smaller than this are not worth compressing. */
+static const std::size_t min_compress_size = 64;
+
+/* Largest message accepted from the other relay. */
+static const int max_message_size = 1 << 30;
+
+static int compression_level = Z_DEFAULT_COMPRESSION;
+static boost::mutex log_mutex;
+
+void log_line(const std::string& line)
+{
+    boost::mutex::scoped_lock lock(log_mutex);
+    std::cout << line << std::endl;
+}
+
+/* Protocol I/O, the messages are kept as the bytes sent on the wire. */
+
+bool read_bytes(tcp::socket& s, void* data, std::size_t size)
+{
+    boost::system::error_code error;
+    boost::asio::read(s, boost::asio::buffer(data, size), boost::asio::transfer_all(), error);
+    return !error;
+}
+
+bool write_bytes(tcp::socket& s, const std::string& data)
+{
+    boost::system::error_code error;
+    boost::asio::write(s, boost::asio::buffer(data), boost::asio::transfer_all(), error);
+    return !error;
+}
+
+void append_int(std::string& raw, int value)
+{
+    raw.append((const char*) &value, sizeof(int));
+}
+
+int int_at(const std::string& raw, std::size_t offset)
+{
+    int value = 0;
+    if (raw.size() >= offset + sizeof(int)) std::memcpy(&value, raw.data() + offset, sizeof(int));
+    return value;
+}
+
+/* Reads an int and appends it to raw. */
+bool read_int(tcp::socket& s, std::string& raw, int& value)
+{
+    if (!read_bytes(s, &value, sizeof(int))) return false;
+    append_int(raw, value);
+    return true;
+}
+
+/* Reads a size/data packet and appends it to raw. */
+bool read_packet(tcp::socket& s, std::string& raw)
+{
+    int size;
+    if (!read_int(s, raw, size) || size < 0) return false;
+    std::size_t at = raw.size();
+    raw.resize(at + size);
+    return size == 0 || read_bytes(s, &raw[at], size);
+}
+
+/* Reads a command from a client, fails on commands whose layout is not known. */
+bool read_command(tcp::socket& s, std::string& raw, int& cmd)
+{
+    raw.clear();
+    if (!read_int(s, raw, cmd) || !eureqa::commands::is_known(cmd)) return false;
+    int argument;
+    if (eureqa::commands::has_argument(cmd) && !read_int(s, raw, argument)) return false;
+    if (eureqa::commands::has_packet(cmd) && !read_packet(s, raw)) return false;
+    return true;
+}
+
+/* Reads the server's response to a command, or its greeting when cmd is 0. */
+bool read_response(tcp::socket& s, int cmd, std::string& raw)
+{
+    raw.clear();
+    int value;
+    if (!eureqa::commands::returns_packet(cmd) && !read_int(s, raw, value)) return false;
+    return read_packet(s, raw);
+}
+
+/* A command_result as the server would send it. */
+std::string make_result(int value, const std::string& message)
+{
+    std::string raw;
+    append_int(raw, value);
+    append_int(raw, (int) message.size());
+    raw += message;
+    return raw;
+}
+
+bool connect_to(boost::asio::io_service& io_service, tcp::socket& s, const std::string& host, int port)
+{
+    try {
+        tcp::resolver resolver(io_service);
+        tcp::resolver::query query(host, boost::lexical_cast<std::string>(port));
+        tcp::resolver::iterator endpoint_iterator = resolver.resolve(query);
+        tcp::resolver::iterator end;
+        boost::system::error_code error = boost::asio::error::host_not_found;
+        while (error && endpoint_iterator != end) {
+            s.close();
+            s.connect(*endpoint_iterator++, error);
+        }
+        if (error) s.close();
+        else s.set_option(tcp::no_delay(true));
+        return !error;
+    } catch (...) {
+        return false;
+    }
+}
+
+std::string content_hash(const char* data, std::size_t size)
+{
+    boost::uuids::detail::sha1 sha;
+    sha.process_bytes(data, size);
+    char hex[41];
+#if BOOST_VERSION >= 108600
+    unsigned char digest[20];
+    sha.get_digest(digest);
+    for (int i = 0; i < 20; i++) std::sprintf(hex + 2*i, "%02x", digest[i]);
+#else
+    unsigned int digest[5];
+    sha.get_digest(digest);
+    for (int i = 0; i < 5; i++) std::sprintf(hex + 8*i, "%08x", digest[i]);
+#endif
+    return std::string(hex, 40);
+}
+
+/* Hash of the data-set packet in a send_data_set message. */
+std::string data_set_hash(const std::string& raw)
+{
+    std::size_t header = 2 * sizeof(int);
+    return content_hash(raw.data() + header, raw.size() - header);
+}
+
+/* The compressed link between the relays. */
+class relay_link {
+protected:
+    tcp::socket& socket_;
+    std::string stored_;
+
+public:
+    long long raw_bytes_;  /* bytes of protocol messages carried */
+    long long link_bytes_; /* bytes actually sent or received */
+
+    relay_link(tcp::socket& s) : socket_(s), raw_bytes_(0), link_bytes_(0) { }
+    bool write(int kind, const std::string& raw);
+    bool read(int& kind, std::string& raw);
+};
+
+bool relay_link::write(int kind, const std::string& raw)
+{
+    frame_header header = { kind, (int) raw.size(), (int) raw.size() };
+    const char* payload = raw.data();
+    if (raw.size() >= min_compress_size) {
+        uLongf size = compressBound((uLong) raw.size());
+        stored_.resize(size);
+        int status = compress2((Bytef*) &stored_[0], &size, (const Bytef*) raw.data(), (uLong) raw.size(), compression_level);
+        if (status == Z_OK && size < raw.size()) {
+            header.stored_size = (int) size;
+            payload = stored_.data();
+        }
+    }
+    boost::array<boost::asio::const_buffer, 2> frame = {{
+        boost::asio::buffer(&header, sizeof(header)),
+        boost::asio::buffer(payload, header.stored_size) }};
+    boost::system::error_code error;
+    boost::asio::write(socket_, frame, boost::asio::transfer_all(), error);
+    raw_bytes_ += raw.size();
+    link_bytes_ += sizeof(header) + header.stored_size;
+    return !error;
+}
+
+bool relay_link::read(int& kind, std::string& raw)
+{
+    frame_header header;
+    if (!read_bytes(socket_, &header, sizeof(header))) return false;
+    if (header.raw_size < 0 || header.raw_size > max_message_size) return false;
+    if (header.stored_size < 0 || header.stored_size > header.raw_size) return false;
+    kind = header.kind;
+    raw.resize(header.raw_size);
+    raw_bytes_ += header.raw_size;
+    link_bytes_ += sizeof(header) + header.stored_size;
+    if (header.stored_size == header.raw_size) {
+        return header.raw_size == 0 || read_bytes(socket_, &raw[0], header.raw_size);
+    }
+    stored_.resize(header.stored_size);
+    if (header.stored_size > 0 && !read_bytes(socket_, &stored_[0], header.stored_size)) return false;
+    uLongf size = (uLongf) header.raw_size;
+    int status = uncompress((Bytef*) &raw[0], &size, (const Bytef*) stored_.data(), (uLong) stored_.size());
+    return status == Z_OK && size == (uLongf) header.raw_size;
+}
+
+/* Data-set messages the far relay has forwarded, keyed by content hash, least recently used evicted first. */
+class data_set_cache {
+public:
+    typedef boost::shared_ptr<const std::string> message_ptr;
+
+protected:
+    struct entry {
+        message_ptr message;
+        std::list<std::string>::iterator position;
+    };
+    std::map<std::string, entry> entries_;
+    std::list<std::string> order_; /* most recently used first */
+    std::size_t bytes_;
+    std::size_t capacity_;
+    boost::mutex mutex_;
+
+public:
+    data_set_cache(std::size_t capacity) : bytes_(0), capacity_(capacity) { }
+    void insert(const std::string& hash, const std::string& raw);
+    message_ptr find(const std::string& hash);
+};
+
+void data_set_cache::insert(const std::string& hash, const std::string& raw)
+{
+    boost::mutex::scoped_lock lock(mutex_);
+    if (raw.size() > capacity_ || entries_.count(hash)) return;
+    while (bytes_ + raw.size() > capacity_) {
+        std::map<std::string, entry>::iterator oldest = entries_.find(order_.back());
+        bytes_ -= oldest->second.message->size();
+        entries_.erase(oldest);
+        order_.pop_back();
+    }
+    order_.push_front(hash);
+    entry e = { message_ptr(new std::string(raw)), order_.begin() };
+    entries_[hash] = e;
+    bytes_ += raw.size();
+}
+
+data_set_cache::message_ptr data_set_cache::find(const std::string& hash)
+{
+    boost::mutex::scoped_lock lock(mutex_);
+    std::map<std::string, entry>::iterator found = entries_.find(hash);
+    if (found == entries_.end()) return message_ptr();
+    order_.splice(order_.begin(), order_, found->second.position);
+    return found->second.message;
+}
+
+static data_set_cache* far_cache = 0;
+
+std::string peer_name(tcp::socket& s)
+{
+    boost::system::error_code error;
+    tcp::endpoint peer = s.remote_endpoint(error);
+    return error ? std::string("unknown") : peer.address().to_string();
+}
+
+/* Serves one near relay: forwards its commands to the server and compresses the responses. */
+void far_session(socket_ptr link_socket, std::string server_host, int server_port)
+{
+    relay_link link(*link_socket);
+    boost::asio::io_service io_service;
+    tcp::socket server(io_service);
+    std::string raw, response;
+    int commands = 0, hits = 0, misses = 0;
+
+    // pass the server's greeting on, or explain why there is none
+    if (!connect_to(io_service, server, server_host, server_port)) {
+        link.write(frames::message, make_result(eureqa::result_error, "Unable to reach the Eureqa server behind the relay"));
+        return;
+    }
+    if (!read_response(server, 0, response) || !link.write(frames::message, response)) return;
+
+    int kind;
+    while (link.read(kind, raw)) {
+        int cmd = int_at(raw, 0);
+        if (kind == frames::data_set_ref) {
+            data_set_cache::message_ptr cached = far_cache->find(raw);
+            if (!cached) {
+                misses++;
+                if (!link.write(frames::cache_miss, std::string())) break;
+                continue;
+            }
+            hits++;
+            raw = *cached;
+            cmd = eureqa::commands::send_data_set;
+        } else if (kind != frames::message || !eureqa::commands::is_known(cmd)) {
+            break;
+        } else if (cmd == eureqa::commands::send_data_set) {
+            far_cache->insert(data_set_hash(raw), raw);
+        }
+        commands++;
+        if (!write_bytes(server, raw)) break;
+        if (!read_response(server, cmd, response)) break;
+        if (!link.write(frames::message, response)) break;
+    }
+
+    std::ostringstream os;
+    os << "far: relay " << peer_name(*link_socket) << " closed after " << commands << " commands, "
+       << hits << " cached data sets, " << misses << " misses, "
+       << link.raw_bytes_ << " bytes carried in " << link.link_bytes_ << " on the link";
+    log_line(os.str());
+}
+
+/* Serves one client: forwards its commands through the far relay. */
+void near_session(socket_ptr client, std::string far_host, int far_port)
+{
+    boost::asio::io_service io_service;
+    tcp::socket far(io_service);
+    if (!connect_to(io_service, far, far_host, far_port)) {
+        write_bytes(*client, make_result(eureqa::result_error, "Unable to reach the far relay"));
+        return;
+    }
+    relay_link link(far);
+    std::string raw, response;
+    int commands = 0, by_reference = 0;
+
+    /* Hashes of the data sets sent in full over this link, which the far relay may still hold. */
+    std::set<std::string> sent;
+
+    int kind;
+    if (!link.read(kind, response) || kind != frames::message || !write_bytes(*client, response)) return;
+
+    int cmd;
+    while (read_command(*client, raw, cmd)) {
+        commands++;
+        kind = frames::cache_miss;
+
+        // an unchanged data set only needs its hash
+        std::string hash;
+        if (cmd == eureqa::commands::send_data_set) {
+            hash = data_set_hash(raw);
+            if (sent.count(hash)) {
+                if (!link.write(frames::data_set_ref, hash) || !link.read(kind, response)) break;
+                if (kind == frames::cache_miss) sent.erase(hash);
+                else by_reference++;
+            }
+        }
+        if (kind == frames::cache_miss) {
+            if (!link.write(frames::message, raw) || !link.read(kind, response)) break;
+            if (!hash.empty()) sent.insert(hash);
+        }
+        if (kind != frames::message || !write_bytes(*client, response)) break;
+    }
+
+    std::ostringstream os;
+    os << "near: client " << peer_name(*client) << " closed after " << commands << " commands, "
+       << by_reference << " data sets sent by reference, "
+       << link.raw_bytes_ << " bytes carried in " << link.link_bytes_ << " on the link";
+    log_line(os.str());
+}
+
+int usage()
+{
+    std::cerr << "usage: eureqa_relay far [-l listen_port] [-c cache_mb] server_host[:port]" << std::endl;
+    std::cerr << "       eureqa_relay near [-l listen_port] [-z level] far_host[:port]" << std::endl;
+    return 1;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 3) return usage();
+    std::string mode = argv[1];
+    bool is_near = (mode == "near");
+    if (!is_near && mode != "far") return usage();
+
+    int listen_port = is_near ? eureqa::default_port_tcp : default_port_relay;
+    int cache_mb = 1024;
+    std::string address;
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-l" && i + 1 < argc) listen_port = std::atoi(argv[++i]);
+        else if (arg == "-c" && i + 1 < argc) cache_mb = std::atoi(argv[++i]);
+        else if (arg == "-z" && i + 1 < argc) compression_level = std::atoi(argv[++i]);
+        else if (address.empty() && arg[0] != '-') address = arg;
+        else return usage();
+    }
+    if (address.empty()) return usage();
+
+    std::string host;
+    int port = is_near ? default_port_relay : eureqa::default_port_tcp;
+    eureqa::connection::parse_address(address, host, port);
+    far_cache = new data_set_cache((std::size_t) cache_mb * 1024 * 1024);
+
+    try {
+        boost::asio::io_service io_service;
+        tcp::acceptor acceptor(io_service, tcp::endpoint(tcp::v4(), listen_port));
+        std::ostringstream os;
+        os << mode << ": listening on " << listen_port << ", relaying to " << host << ":" << port;
+        log_line(os.str());
+        for (;;) {
+            socket_ptr s(new tcp::socket(io_service));
+            acceptor.accept(*s);
+            s->set_option(tcp::no_delay(true));
+            if (is_near) boost::thread(boost::bind(near_session, s, host, port)).detach();
+            else boost::thread(boost::bind(far_session, s, host, port)).detach();
+        }
+    } catch (std::exception& e) {
+        std::cerr << "eureqa_relay: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
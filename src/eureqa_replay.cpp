@@ -0,0 +1,408 @@
+/*
+  eureqa_replay.cpp
+
+  Plays back a capture of a client's session, as written by
+  eureqa::connection::start_recording() or by eureqaml when
+  EUREQA_CAPTURE names a file, against a Eureqa server or a stand-in.
+
+  The commands are sent exactly as they were recorded, pipelined
+  batches included, and each response is read off the wire according
+  to the protocol. By default the next command goes out as soon as the
+  last response is in; with -r the original gaps between commands are
+  kept, so a slowdown seen in production can be reproduced as it
+  happened. It reports the round trip time of every command, and the
+  bytes received against those in the capture.
+
+  With -d no server is needed: the responses in the capture are decoded
+  in place, each one n times, and the decode times of the progress,
+  frontier and individuals packets are reported. The frontier is
+  decoded both into a solution_frontier and into a solution_arena, as
+  query_frontier does for each. As the packets are the same bytes on
+  every run, this makes a deterministic regression test of the decode
+  paths.
+
+  Licensed under the GNU General Public License.
+
+*/
+
+/*
+   Usage:
+
+    $ eureqa_replay [-r] capture_file [server_host[:port]]
+    $ eureqa_replay -d [-n repeats] capture_file
+
+   Without a server address the capture is played back against the
+   server it was recorded from.
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <eureqa/eureqa.h>
+#include <boost/thread.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+using boost::asio::ip::tcp;
+
+static const int default_repeats = 100;
+
+/* Key of the round trips of pipelined batches, which are timed as one. */
+static const int pipelined = -1;
+
+static boost::posix_time::ptime now()
+{
+    return boost::posix_time::microsec_clock::universal_time();
+}
+
+/* Timings of one kind of command. */
+struct timings {
+    std::vector<double> samples;
+    std::size_t bytes;
+    timings() : bytes(0) { }
+
+    double percentile(double p) {
+        if (samples.empty()) return 0.0;
+        std::sort(samples.begin(), samples.end());
+        std::size_t i = (std::size_t) (p * (samples.size() - 1) + 0.5);
+        return samples[i];
+    }
+    double mean() const {
+        double sum = 0.0;
+        for (std::size_t i = 0; i < samples.size(); i++) sum += samples[i];
+        return samples.empty() ? 0.0 : sum / samples.size();
+    }
+};
+
+void print_header(const char* units)
+{
+    std::cout << std::left << std::setw(28) << "Command:" << std::right << std::setw(8) << "Calls:"
+              << std::setw(12) << "Bytes:" << std::setw(12) << "Mean:" << std::setw(12) << "Median:"
+              << std::setw(12) << "99%:" << std::setw(12) << "Max:" << "  (" << units << ")" << std::endl;
+}
+
+void print_row(const std::string& name, timings& t)
+{
+    std::cout << std::left << std::setw(28) << name << std::right << std::setw(8) << t.samples.size()
+              << std::setw(12) << (t.samples.empty() ? 0 : t.bytes / t.samples.size())
+              << std::fixed << std::setprecision(3)
+              << std::setw(12) << t.mean() << std::setw(12) << t.percentile(0.5)
+              << std::setw(12) << t.percentile(0.99) << std::setw(12) << t.percentile(1.0) << std::endl;
+}
+
+std::string command_name(int cmd)
+{
+    if (cmd == pipelined) return "pipelined batch";
+    if (cmd == 0) return "greeting";
+    return eureqa::commands::name(cmd);
+}
+
+/* Walks the messages in a record's payload. */
+class cursor {
+public:
+    cursor(const std::string& raw) : raw_(raw), at_(0) { }
+
+    bool at_end() const { return at_ >= raw_.size(); }
+    std::size_t at() const { return at_; }
+
+    bool read_int(int& value) {
+        if (raw_.size() - at_ < sizeof(int)) return false;
+        std::memcpy(&value, raw_.data() + at_, sizeof(int));
+        at_ += sizeof(int);
+        return true;
+    }
+    bool read_packet(const char*& data, std::size_t& size) {
+        int n;
+        if (!read_int(n) || n < 0 || raw_.size() - at_ < (std::size_t) n) return false;
+        data = raw_.data() + at_;
+        size = n;
+        at_ += n;
+        return true;
+    }
+
+private:
+    const std::string& raw_;
+    std::size_t at_;
+};
+
+/* The commands in a sent record, fails on commands whose layout is not known. */
+bool split_commands(const std::string& raw, std::vector<int>& cmds)
+{
+    cmds.clear();
+    cursor c(raw);
+    const char* data;
+    std::size_t size;
+    while (!c.at_end()) {
+        int cmd, argument;
+        if (!c.read_int(cmd) || !eureqa::commands::is_known(cmd)) return false;
+        if (eureqa::commands::has_argument(cmd) && !c.read_int(argument)) return false;
+        if (eureqa::commands::has_packet(cmd) && !c.read_packet(data, size)) return false;
+        cmds.push_back(cmd);
+    }
+    return true;
+}
+
+/* Protocol I/O against the server, as in eureqa_broker. */
+
+bool read_bytes(tcp::socket& s, void* data, std::size_t size)
+{
+    boost::system::error_code error;
+    boost::asio::read(s, boost::asio::buffer(data, size), boost::asio::transfer_all(), error);
+    return !error;
+}
+
+/* Reads the response to a command, or the greeting when cmd is 0, and counts its bytes. */
+bool read_response(tcp::socket& s, int cmd, std::vector<char>& buffer, std::size_t& bytes)
+{
+    int value, size;
+    if (!eureqa::commands::returns_packet(cmd)) {
+        if (!read_bytes(s, &value, sizeof(int))) return false;
+        bytes += sizeof(int);
+    }
+    if (!read_bytes(s, &size, sizeof(int)) || size < 0) return false;
+    bytes += sizeof(int) + size;
+    if ((int) buffer.size() < size) buffer.resize(size);
+    return size == 0 || read_bytes(s, &buffer[0], size);
+}
+
+bool connect_to(boost::asio::io_service& io_service, tcp::socket& s, const std::string& host, int port)
+{
+    boost::system::error_code error = boost::asio::error::host_not_found;
+    try {
+        tcp::resolver resolver(io_service);
+        tcp::resolver::query query(host, boost::lexical_cast<std::string>(port));
+        tcp::resolver::iterator endpoint_iterator = resolver.resolve(query);
+        tcp::resolver::iterator end;
+        while (error && endpoint_iterator != end) {
+            s.close();
+            s.connect(*endpoint_iterator++, error);
+        }
+        if (!error) s.set_option(tcp::no_delay(true));
+    } catch (...) {
+        return false;
+    }
+    return !error;
+}
+
+int replay(eureqa::capture_reader& capture, const std::string& address, bool real_time)
+{
+    boost::asio::io_service io_service;
+    tcp::socket s(io_service);
+    std::vector<char> buffer;
+    std::map<int, timings> rounds;
+    std::vector<int> cmds;
+    std::size_t recorded_bytes = 0, received_bytes = 0;
+    int sent = 0;
+
+    eureqa::capture_header header;
+    std::string payload;
+    boost::posix_time::ptime start = now();
+    boost::int64_t first_us = -1, last_us = 0;
+
+    while (capture.next(header, payload)) {
+        if (first_us < 0) first_us = header.time_us_;
+        last_us = header.time_us_;
+        if (real_time) {
+            boost::posix_time::ptime due = start + boost::posix_time::microseconds(header.time_us_ - first_us);
+            if (due > now()) boost::this_thread::sleep(due);
+        }
+
+        if (header.kind_ == eureqa::capture_kinds::received) {
+            recorded_bytes += payload.size();
+        }
+        else if (header.kind_ == eureqa::capture_kinds::connect) {
+            std::string host;
+            int port = eureqa::default_port_tcp;
+            eureqa::connection::parse_address(address.empty() ? payload : address, host, port);
+            boost::system::error_code ignored;
+            s.close(ignored);
+            boost::posix_time::ptime begin = now();
+            std::size_t bytes = 0;
+            if (!connect_to(io_service, s, host, port) || !read_response(s, 0, buffer, bytes)) {
+                std::cerr << "eureqa_replay: unable to connect to " << host << ":" << port << std::endl;
+                return 1;
+            }
+            timings& t = rounds[0];
+            t.samples.push_back((now() - begin).total_microseconds() / 1000.0);
+            t.bytes += bytes;
+            received_bytes += bytes;
+        }
+        else if (header.kind_ == eureqa::capture_kinds::sent) {
+            if (!s.is_open()) {
+                std::cerr << "eureqa_replay: the capture sends a command before connecting" << std::endl;
+                return 1;
+            }
+            if (!split_commands(payload, cmds)) {
+                std::cerr << "eureqa_replay: unknown command in the capture at " << header.time_us_ << " us" << std::endl;
+                return 1;
+            }
+            boost::posix_time::ptime begin = now();
+            boost::system::error_code error;
+            boost::asio::write(s, boost::asio::buffer(payload), boost::asio::transfer_all(), error);
+            std::size_t bytes = 0;
+            for (std::size_t i = 0; !error && i < cmds.size(); i++) {
+                if (!read_response(s, cmds[i], buffer, bytes)) error = boost::asio::error::connection_reset;
+            }
+            if (error) {
+                std::cerr << "eureqa_replay: the server dropped the connection during "
+                          << command_name(cmds.empty() ? 0 : cmds[0]) << std::endl;
+                return 1;
+            }
+            timings& t = rounds[cmds.size() == 1 ? cmds[0] : pipelined];
+            t.samples.push_back((now() - begin).total_microseconds() / 1000.0);
+            t.bytes += bytes;
+            received_bytes += bytes;
+            sent += (int) cmds.size();
+        }
+    }
+
+    double elapsed_ms = (now() - start).total_microseconds() / 1000.0;
+    print_header("ms");
+    for (std::map<int, timings>::iterator i = rounds.begin(); i != rounds.end(); ++i) {
+        print_row(command_name(i->first), i->second);
+    }
+    std::cout << std::endl << sent << " commands replayed in " << std::fixed << std::setprecision(1) << elapsed_ms
+              << " ms, recorded over " << (last_us - first_us) / 1000.0 << " ms" << std::endl
+              << received_bytes << " bytes received, " << recorded_bytes << " in the capture" << std::endl;
+    return 0;
+}
+
+/* Microseconds taken to decode a packet, averaged over n decodes into the same value. */
+template<typename T>
+double time_decode(const char* data, std::size_t size, const char* name, T& val, int n)
+{
+    boost::posix_time::ptime begin = now();
+    for (int i = 0; i < n; i++) {
+        eureqa::decode_packet(data, size, name, val);
+    }
+    return (now() - begin).total_microseconds() / (double) n;
+}
+
+/* Decodes a response packet to cmd as the connection would, and adds the times to rows. */
+void decode_response(int cmd, const char* data, std::size_t size, int n, std::map<std::string, timings>& rows)
+{
+    std::string name = eureqa::commands::name(cmd);
+    double us = 0.0;
+    switch (cmd) {
+    case eureqa::commands::query_progress: {
+        eureqa::search_progress progress;
+        us = time_decode(data, size, "search_progress", progress, n);
+        break;
+    }
+    case eureqa::commands::query_server_info: {
+        eureqa::server_info info;
+        us = time_decode(data, size, "server_info", info, n);
+        break;
+    }
+    case eureqa::commands::query_individuals:
+    case eureqa::commands::calc_solution_info: {
+        std::vector<eureqa::solution_info> individuals;
+        us = time_decode(data, size, "vector_solution_info", individuals, n);
+        break;
+    }
+    case eureqa::commands::query_frontier: {
+        eureqa::solution_frontier front;
+        us = time_decode(data, size, "solution_frontier", front, n);
+
+        eureqa::solution_arena arena;
+        eureqa::solution_arena_frontier arena_front(arena);
+        timings& t = rows[name + " (arena)"];
+        t.samples.push_back(time_decode(data, size, "solution_frontier", arena_front, n));
+        t.bytes += size;
+        break;
+    }
+    default:
+        return;
+    }
+    timings& t = rows[name];
+    t.samples.push_back(us);
+    t.bytes += size;
+}
+
+int decode(eureqa::capture_reader& capture, int n)
+{
+    std::map<std::string, timings> rows;
+    std::deque<int> pending; /* commands sent and not yet answered in the capture */
+    std::vector<int> cmds;
+    eureqa::capture_header header;
+    std::string payload;
+    int responses = 0;
+
+    while (capture.next(header, payload)) {
+        if (header.kind_ == eureqa::capture_kinds::connect) {
+            pending.clear();
+            pending.push_back(0);
+        }
+        else if (header.kind_ == eureqa::capture_kinds::sent) {
+            if (!split_commands(payload, cmds)) {
+                std::cerr << "eureqa_replay: unknown command in the capture at " << header.time_us_ << " us" << std::endl;
+                return 1;
+            }
+            pending.insert(pending.end(), cmds.begin(), cmds.end());
+        }
+        else if (header.kind_ == eureqa::capture_kinds::received) {
+            cursor c(payload);
+            while (!c.at_end() && !pending.empty()) {
+                int cmd = pending.front(), value;
+                const char* data;
+                std::size_t size;
+                pending.pop_front();
+                if (!eureqa::commands::returns_packet(cmd) && !c.read_int(value)) break;
+                if (!c.read_packet(data, size)) break;
+                try {
+                    if (eureqa::commands::returns_packet(cmd)) decode_response(cmd, data, size, n, rows);
+                } catch (std::exception& e) {
+                    std::cerr << "eureqa_replay: unable to decode the " << command_name(cmd)
+                              << " response at " << header.time_us_ << " us: " << e.what() << std::endl;
+                    return 1;
+                }
+                responses++;
+            }
+        }
+    }
+
+    print_header("us per decode");
+    for (std::map<std::string, timings>::iterator i = rows.begin(); i != rows.end(); ++i) {
+        print_row(i->first, i->second);
+    }
+    std::cout << std::endl << responses << " responses in the capture, each packet decoded " << n << " times" << std::endl;
+    return 0;
+}
+
+int usage()
+{
+    std::cerr << "usage: eureqa_replay [-r] capture_file [server_host[:port]]" << std::endl
+              << "       eureqa_replay -d [-n repeats] capture_file" << std::endl;
+    return 1;
+}
+
+int main(int argc, char* argv[])
+{
+    bool real_time = false, decode_only = false;
+    int repeats = default_repeats;
+    std::string path, address;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-r") real_time = true;
+        else if (arg == "-d") decode_only = true;
+        else if (arg == "-n" && i + 1 < argc) repeats = std::max(1, std::atoi(argv[++i]));
+        else if (path.empty() && arg[0] != '-') path = arg;
+        else if (address.empty() && arg[0] != '-') address = arg;
+        else return usage();
+    }
+    if (path.empty() || (decode_only && !address.empty())) return usage();
+
+    eureqa::capture_reader capture(path);
+    if (!capture.is_open()) {
+        std::cerr << "eureqa_replay: " << path << " is not a capture file" << std::endl;
+        return 1;
+    }
+    return decode_only ? decode(capture, repeats) : replay(capture, address, real_time);
+}
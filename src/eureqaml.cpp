@@ -27,7 +27,11 @@
 #include <iostream>
 #include <eureqa/eureqa.h>
 #include <boost/unordered_map.hpp>
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
+#include <boost/thread.hpp>
 #include <cstring>
+#include <cstdlib>
 
 #if WIN32
 #define snprintf sprintf_s
@@ -39,11 +43,15 @@ extern "C" {
 
 extern "C" {
 void _connect(char const* host);
+void _connect_cluster();
 void _is_connected();
 void _disconnect();
+void _set_reconnect(int attempts);
 void _send_data_set_maybe_labels(bool labels);
 void _send_data_set();
 void _send_data_set_labels();
+void _send_data_location(char const* path);
+void _set_shared_directory(char const* dir);
 void _send_options(char const* model);
 void _send_options_explicit(int);
 void _start_search();
@@ -56,6 +64,17 @@ void _add_to_solution_frontier_helper(const char* text, double score,
                                        double fitness, double complexity,
                                        int    age);
 void _clear_solution_frontier();
+void _discover_servers(int window_ms);
+void _sweep_clear();
+void _sweep_data_set();
+void _sweep_data_set_labels();
+void _sweep_relationship(char const* model);
+void _sweep_options(int n);
+void _sweep_run(double max_generations, double max_seconds);
+void _cross_validate(int folds, double max_generations, double max_seconds);
+void _launch_servers(int count, char const* program, int pinning);
+void _stop_servers();
+void _connection_statistics();
 }
 
 const char * resolve_mltkenum(int mltk);
@@ -68,7 +87,7 @@ const char * resolve_mltkenum(int mltk);
         MLNewPacket(stdlink); \
         MLPutSymbol(stdlink, (char *) "$Failed")
 
-void failed_with_message0(char *msg) {
+void failed_with_message0(const char *msg) {
     char buf[255];
     MLClearError(stdlink); 
     MLNewPacket(stdlink); 
@@ -103,118 +122,193 @@ void failed_with_message2(const char *msg, const char *arg1, const char *arg2) {
     MLPutSymbol(stdlink, (char *) "$Failed");
 }
 
+/* The message name tag::name, for messages shared by several functions. */
+std::string message_name(const char *tag, const char *name) {
+    return std::string(tag) + "::" + name;
+}
+
 eureqa::connection conn;
+eureqa::session sess(conn, eureqa::reconnect_policy(0)); // reconnects only after SetReconnect[]
+eureqa::cluster servers(sess); // sess alone, or with the others of ConnectTo[{hosts}]
 static int next_conn_id = 1;
-eureqa::solution_frontier front;
+eureqa::solution_frontier& front = sess.frontier(); // merged from every server, seeds them after a reconnect
 eureqa::search_options options; // holds the search options
+eureqa::solution_arena frontier_arena; // reused by every QueryFrontier[] poll
+eureqa::sweep sweeps; // the searches SweepRun[] runs, independent of the session
+eureqa::cross_validation validations; // of the sweep's first data set, model and option set, by CrossValidate[]
+eureqa::supervisor local_servers; // the eureqa_server instances LaunchServers[] runs on this machine
+
+/*
+  Network calls run on a worker thread while the MathLink thread
+  yields to the kernel and watches for an abort.  Aborting cancels the
+  socket operation in flight, or a wait to reconnect, so the call
+  returns within milliseconds and ends the session.
+ */
+enum call_status { call_failed, call_succeeded, call_archive_error, call_aborted };
+
+void run_call(boost::function<bool ()> call, call_status *status)
+{
+    try {
+        *status = call() ? call_succeeded : call_failed;
+    } catch (const boost::archive::archive_exception& ae) {
+        *status = call_archive_error;
+    } catch (const std::exception& e) {
+        /* Anything else, such as bad_alloc, fails the call rather than
+           ending the worker thread and with it the kernel link. */
+        *status = call_failed;
+    } catch (...) {
+        *status = call_failed;
+    }
+}
+
+/* Runs a network call, putting $Aborted on the link if it is aborted.
+   An abort calls cancel until the call returns, then cleanup. */
+call_status run_abortable(boost::function<bool ()> call, 
+                          boost::function<void ()> cancel,
+                          boost::function<void ()> cleanup)
+{
+    call_status status = call_failed;
+    bool aborted = false;
+    boost::thread worker(boost::bind(run_call, call, &status));
+    while (! worker.timed_join(boost::posix_time::milliseconds(5))) {
+        MLCallYieldFunction(MLYieldFunction(stdlink), stdlink, (MLYieldParameters) 0);
+        if (MLAbort) {
+            // Keep cancelling until the worker returns, in case it was
+            // between socket operations the first time.
+            aborted = true;
+            cancel();
+        }
+    }
+    if (! aborted) 
+        return status;
+    cleanup();
+    MLAbort = 0;
+    MLPutSymbol(stdlink, (char *) "$Aborted");
+    return call_aborted;
+}
+
+/* Runs a call on the session, an abort ends the session. */
+call_status run_abortable(boost::function<bool ()> call)
+{
+    return run_abortable(call, 
+                         boost::bind(&eureqa::cluster::cancel, &servers),
+                         boost::bind(&eureqa::cluster::disconnect, &servers));
+}
+
+bool query_frontier_call()
+{
+    return servers.query_frontier(frontier_arena);
+}
 
 /*
   Let's use a generic set of classes to handle getting and setting
   integer, real, and string properties on the Eureqa members.  It'll
-  make the maintenance easier.
+  make the maintenance easier.  Each holds a pointer to the member it
+  sets, so the same properties fill any search_options, and reports
+  errors as messages of the function given by tag.
  */
 class GetSet;
 boost::unordered_map<std::string, GetSet*> option_properties;
 
 class GetSet {
     public:
-    virtual int update_data(const char* sym) = 0;
+    virtual int update_data(eureqa::search_options& options, const char* tag, const char* sym) = 0;
 };
 
 class StringGetSet : public GetSet {
-    std::string& data;
+    std::string eureqa::search_options::* data;
     public:
-    StringGetSet(std::string& astr) : data(astr) { }
-    virtual int update_data(const char* sym) {
+    StringGetSet(std::string eureqa::search_options::* astr) : data(astr) { }
+    virtual int update_data(eureqa::search_options& options, const char* tag, const char* sym) {
         const char *str;
         int mltk = MLGetNext(stdlink);
         if (mltk != MLTKSTR) {
-            failed_with_message2("SendOptions::expstr2", sym, 
+            failed_with_message2(message_name(tag, "expstr2").c_str(), sym, 
                                  resolve_mltkenum(mltk));
             return 1;
         }
         if (! MLGetString(stdlink, &str)) {
-            FAILED_WITH_MESSAGE("SendOptions::failstr");
+            failed_with_message0(message_name(tag, "failstr").c_str());
             return 2;
         }
-        data = str;
+        options.*data = str;
         MLReleaseString(stdlink, str);
         return 0;
     }
 };
 
 class IntegerGetSet : public GetSet {
-    int &data;
+    int eureqa::search_options::* data;
     public:
-    IntegerGetSet(int &i) : data(i) { }
-    virtual int update_data(const char* sym) {
+    IntegerGetSet(int eureqa::search_options::* i) : data(i) { }
+    virtual int update_data(eureqa::search_options& options, const char* tag, const char* sym) {
         int i;
         if (MLGetNext(stdlink) != MLTKINT) {
-            failed_with_message1("SendOptions::expint1", sym);
+            failed_with_message1(message_name(tag, "expint1").c_str(), sym);
             return 1;
         }
         if (! MLGetInteger(stdlink, &i)) {
-            FAILED_WITH_MESSAGE("SendOptions::failint");
+            failed_with_message0(message_name(tag, "failint").c_str());
             return 2;
         }
-        data = i;
+        options.*data = i;
         return 0;
     }
 };
 
 class RealGetSet : public GetSet {
-    float &data;
+    float eureqa::search_options::* data;
     public:
-    RealGetSet(float &f) : data(f) { }
-    virtual int update_data(const char* sym) {
+    RealGetSet(float eureqa::search_options::* f) : data(f) { }
+    virtual int update_data(eureqa::search_options& options, const char* tag, const char* sym) {
         float f;
         if (MLGetNext(stdlink) != MLTKREAL && MLGetNext(stdlink) != MLTKINT) {
-            failed_with_message1("SendOptions::expreal", sym);
+            failed_with_message1(message_name(tag, "expreal").c_str(), sym);
             return 1;
         }
 
         if (! MLGetFloat(stdlink, &f)) {
-            FAILED_WITH_MESSAGE("SendOptions::failreal");
+            failed_with_message0(message_name(tag, "failreal").c_str());
             return 2;
         }
-        data = f;
+        options.*data = f;
         return 0;
     }
 };
 
 class StringListGetSet : public GetSet {
-    std::vector<std::string> &data;
+    std::vector<std::string> eureqa::search_options::* data;
     public:
-    StringListGetSet(std::vector<std::string> &l) : data(l) { }
-    virtual int update_data(const char* sym) {
+    StringListGetSet(std::vector<std::string> eureqa::search_options::* l) : data(l) { }
+    virtual int update_data(eureqa::search_options& options, const char* tag, const char* sym) {
         long n;
-        data.clear();
+        (options.*data).clear();
         if (! MLCheckFunction(stdlink, (char *) "List", &n)) {
-            failed_with_message1("SendOptions::explist", sym);
+            failed_with_message1(message_name(tag, "explist").c_str(), sym);
             return 1;
         } 
         for (int i = 0; i < n; i++) {
             long m;
             const char *str;
             if (MLGetNext(stdlink) != MLTKSTR) {
-                failed_with_message1("SendOptions::expstr", sym);
+                failed_with_message1(message_name(tag, "expstr").c_str(), sym);
                 return 2;
             }
             if (! MLGetString(stdlink, &str)) {
-                FAILED_WITH_MESSAGE("SendOptions::failstr");
+                failed_with_message0(message_name(tag, "failstr").c_str());
                 return 3;
             }
-            data.push_back(str);
+            (options.*data).push_back(str);
             MLReleaseString(stdlink, str);
         }
     }
 };
 
 class MetricGetSet : public GetSet {
-    int &data;
+    int eureqa::search_options::* data;
     boost::unordered_map<std::string, int> enum_values;
     public:
-    MetricGetSet(int &i) : data(i) { 
+    MetricGetSet(int eureqa::search_options::* i) : data(i) { 
         enum_values["AbsoluteError"] = eureqa::fitness_types::absolute_error;
         enum_values["SquaredError"] = eureqa::fitness_types::squared_error;
         enum_values["RootSquaredError"] = eureqa::fitness_types::root_squared_error;
@@ -230,22 +324,22 @@ class MetricGetSet : public GetSet {
         enum_values["SlopeError"] = eureqa::fitness_types::slope_error;
         enum_values["Count"] = eureqa::fitness_types::count;
     }
-    virtual int update_data(const char* sym) {
+    virtual int update_data(eureqa::search_options& options, const char* tag, const char* sym) {
         const char *symbol;
         if (MLGetNext(stdlink) != MLTKSYM) {
-            failed_with_message1("SendOptions::expsym1", sym);
+            failed_with_message1(message_name(tag, "expsym1").c_str(), sym);
             return 1;
         }
         if (! MLGetSymbol(stdlink, &symbol)) {
-            failed_with_message1("SendOptions::failsym1", sym);
+            failed_with_message1(message_name(tag, "failsym1").c_str(), sym);
             return 2;
         }
         if (enum_values.find(symbol) == enum_values.end()) {
-            failed_with_message1("SendOptions::invsym1", sym);
+            failed_with_message1(message_name(tag, "invsym1").c_str(), sym);
             MLReleaseSymbol(stdlink, symbol);
             return 3;
         }
-        data = enum_values[symbol];
+        options.*data = enum_values[symbol];
         MLReleaseSymbol(stdlink, symbol);
         return 0;
     }
@@ -268,23 +362,23 @@ int initialize_option_properties()
     if (option_properties.size() != 0) {
         return 0;
     }
-    option_properties["SearchRelationship"] = new StringGetSet(options.search_relationship_);
-    option_properties["BuildingBlocks"] = new StringListGetSet(options.building_blocks_);
-    option_properties["NormalizeFitnessBy"] = new RealGetSet(options.normalize_fitness_by_);
-    option_properties["FitnessMetric"] = new MetricGetSet(options.fitness_metric_);
-    option_properties["SolutionPopulationSize"] = new IntegerGetSet(options.solution_population_size_);
-    option_properties["PredictorPopulationSize"] = new IntegerGetSet(options.predictor_population_size_);
-    option_properties["TrainerPopulationSize"] = new IntegerGetSet(options.trainer_population_size_);
-    option_properties["SolutionCrossoverProbability"] = new RealGetSet(options.solution_crossover_probability_);
-    option_properties["SolutionMutationProbability"] = new RealGetSet(options.solution_mutation_probability_);
-    option_properties["PredictorCrossoverProbability"] = new RealGetSet(options.predictor_crossover_probability_);
-    option_properties["PredictorMutationProbability"] = new RealGetSet(options.predictor_mutation_probability_);
+    option_properties["SearchRelationship"] = new StringGetSet(&eureqa::search_options::search_relationship_);
+    option_properties["BuildingBlocks"] = new StringListGetSet(&eureqa::search_options::building_blocks_);
+    option_properties["NormalizeFitnessBy"] = new RealGetSet(&eureqa::search_options::normalize_fitness_by_);
+    option_properties["FitnessMetric"] = new MetricGetSet(&eureqa::search_options::fitness_metric_);
+    option_properties["SolutionPopulationSize"] = new IntegerGetSet(&eureqa::search_options::solution_population_size_);
+    option_properties["PredictorPopulationSize"] = new IntegerGetSet(&eureqa::search_options::predictor_population_size_);
+    option_properties["TrainerPopulationSize"] = new IntegerGetSet(&eureqa::search_options::trainer_population_size_);
+    option_properties["SolutionCrossoverProbability"] = new RealGetSet(&eureqa::search_options::solution_crossover_probability_);
+    option_properties["SolutionMutationProbability"] = new RealGetSet(&eureqa::search_options::solution_mutation_probability_);
+    option_properties["PredictorCrossoverProbability"] = new RealGetSet(&eureqa::search_options::predictor_crossover_probability_);
+    option_properties["PredictorMutationProbability"] = new RealGetSet(&eureqa::search_options::predictor_mutation_probability_);
 }
 
-int update_option(const char* sym) {
+int update_option(eureqa::search_options& options, const char* tag, const char* sym) {
     if (option_properties.find(sym) == option_properties.end()) {
         // No such property
-        failed_with_message1("SendOptions::invopt1", sym);
+        failed_with_message1(message_name(tag, "invopt1").c_str(), sym);
         return 1;
     }
     // We'll deal with Automatic values by just not doing anything.
@@ -293,7 +387,7 @@ int update_option(const char* sym) {
     if (MLGetNext(stdlink) == MLTKSYM) {
         const char* symbol;
         if (! MLGetSymbol(stdlink, &symbol)) {
-            failed_with_message1("SendOptions::failmsym1", sym);
+            failed_with_message1(message_name(tag, "failmsym1").c_str(), sym);
             return 2;
         }
         if (strcmp(symbol, "Automatic") == 0) {
@@ -307,12 +401,12 @@ int update_option(const char* sym) {
     MLSeekToMark(stdlink, mark, 0);
     MLDestroyMark(stdlink, mark);
     
-    return option_properties[sym]->update_data(sym);
+    return option_properties[sym]->update_data(options, tag, sym);
 }
 
 int ensure_connected(const char *s)
 {
-    if (! conn.is_connected()) {
+    if (! servers.is_connected()) {
         char msg[256];
         snprintf(msg, 256, "Message[%s::noconn]",s); 
         MLClearError(stdlink); 
@@ -327,15 +421,27 @@ int ensure_connected(const char *s)
     
 }
 
-void _connect(char const* host)
+bool connect_call(const std::vector<std::string>& hosts)
+{
+    return servers.connect(hosts, eureqa::default_port_tcp);
+}
+
+void connect_hosts(const std::vector<std::string>& hosts)
 {
-    if (conn.is_connected()) {
+    if (servers.is_connected()) {
         FAILED_WITH_MESSAGE("ConnectTo::conn");
         return;
     }
 
-    // It would be nice if we respect abort requests.
-    if (conn.connect(host)) {
+    conn.set_instrumented(true); // for ConnectionStatistics[]
+    // EUREQA_CAPTURE names a file to record the session to, for eureqa_replay
+    const char* capture = std::getenv("EUREQA_CAPTURE");
+    if (capture && *capture && !conn.is_recording()) 
+        conn.start_recording(capture);
+    call_status status = run_abortable(boost::bind(connect_call, boost::cref(hosts)));
+    if (status == call_aborted) 
+        return;
+    if (status == call_succeeded) {
         // We connected.
         MLPutFunction(stdlink, (char *) "ConnectionInfo", 1); 
           MLPutInteger(stdlink, next_conn_id);
@@ -345,9 +451,47 @@ void _connect(char const* host)
     }
 }
 
+void _connect(char const* host)
+{
+    connect_hosts(std::vector<std::string>(1, host));
+}
+
+/* Reads a list of strings, returns 0 on success. */
+int get_string_list(std::vector<std::string>& strings)
+{
+    long n;
+    strings.clear();
+    if (! MLCheckFunction(stdlink, (char *) "List", &n)) 
+        return 1;
+    for (long i = 0; i < n; i++) {
+        const char *str;
+        if (MLGetNext(stdlink) != MLTKSTR || ! MLGetString(stdlink, &str)) 
+            return 2;
+        strings.push_back(str);
+        MLReleaseString(stdlink, str);
+    }
+    return 0;
+}
+
+void _connect_cluster()
+{
+    /*
+      Connects to every host in the list and runs one search across
+      them: the commands go to all of them at once, QueryProgress[]
+      sums their speeds and the solution frontier merges what they
+      all find.  A host that fails is dropped and the others go on.
+     */
+    std::vector<std::string> hosts;
+    if (get_string_list(hosts)) {
+        FAILED_WITH_MESSAGE("ConnectTo::hosts");
+        return;
+    }
+    connect_hosts(hosts);
+}
+
 void _is_connected()
 {
-    if (conn.is_connected()) {
+    if (servers.is_connected()) {
         MLPutSymbol(stdlink, (char *) "True");
     } else {
         MLPutSymbol(stdlink, (char *) "False");
@@ -356,55 +500,135 @@ void _is_connected()
 
 void _disconnect()
 {
-    if (! conn.is_connected()) {
+    if (! servers.is_connected()) {
         FAILED_WITH_MESSAGE("Disconnect::noconn");
         return;
     }
 
-    // It would be nice if we respect any requests to abort.
-    conn.disconnect();
+    // Closing the sockets does not block.
+    servers.disconnect();
     MLPutSymbol(stdlink, (char *) "Null");
 }
 
-void _send_data_set_maybe_labels(bool labels) {
-    if (ensure_connected((char *) "SendDataSet")) return;
-    double *data;
-    long *dims;                 // dimensions
-    char **heads;
-    long d; /* Stores the rank of the array. */
-    long i,j;
+bool wait_ready_call()
+{
+    return local_servers.wait_ready(local_servers.options().startup_ms_);
+}
 
-    if(! MLGetRealArray(stdlink, &data, &dims, &heads, &d)) {
-        FAILED_WITH_MESSAGE("SendDataSet::readerr");
+void put_string_list(const std::vector<std::string>& strings)
+{
+    MLPutFunction(stdlink, (char *) "List", (int) strings.size());
+    for (int i = 0; i < (int) strings.size(); i++) 
+        MLPutString(stdlink, strings[i].c_str());
+}
+
+void _launch_servers(int count, char const* program, int pinning)
+{
+    /*
+      Starts count eureqa_server instances on this machine, or one per
+      NUMA node if count is 0, on consecutive ports and each pinned to
+      its share of the cpus, and returns their hosts for ConnectTo[] or
+      the Host option.  They are checked every few seconds and one that
+      exits or stops answering is restarted on the same port, where a
+      session with reconnecting on picks its search back up.  Asked
+      again for the same servers, the running ones are returned.
+     */
+    eureqa::supervisor_options opts = local_servers.options();
+    if (local_servers.is_running() && opts.program_ == program && opts.pinning_ == pinning
+        && local_servers.size() == (count > 0 ? count : (int) eureqa::supervisor::numa_nodes().size())) {
+        put_string_list(local_servers.hostnames());
+        return;
+    }
+    opts.program_ = program;
+    opts.pinning_ = pinning;
+    local_servers.set_options(opts);
+
+    // Launched from the MathLink thread, which they are tied to, so
+    // they do not outlive this program.
+    if (! local_servers.start(count)) {
+        local_servers.stop();
+        FAILED_WITH_MESSAGE("LaunchServers::launch");
+        return;
+    }
+    call_status status = run_abortable(wait_ready_call, 
+                                       boost::bind(&eureqa::supervisor::stop, &local_servers),
+                                       boost::bind(&eureqa::supervisor::stop, &local_servers));
+    if (status == call_aborted) 
+        return;
+    if (status != call_succeeded) {
+        local_servers.stop();
+        FAILED_WITH_MESSAGE("LaunchServers::start");
         return;
     }
-    eureqa::data_set dataset(dims[0], dims[1]); // Holds the data.
-    for(i=0; i<dims[0]; i++) 
-        for(j=0; j<dims[1]; j++)
-            dataset(i,j) = data[j + i * dims[1]];
+    put_string_list(local_servers.hostnames());
+}
+
+void _stop_servers()
+{
+    // A session still connected to them sees its servers drop.
+    local_servers.stop();
+    MLPutSymbol(stdlink, (char *) "Null");
+}
+
+void _set_reconnect(int attempts)
+{
+    /*
+      With attempts > 0 a dropped connection is restored on the next
+      call: reconnect with backoff, resend the data set and options,
+      seed the population from the solution frontier and restart the
+      search if it was running.  Zero turns this off.
+     */
+    eureqa::reconnect_policy policy(attempts < 0 ? 0 : attempts);
+    servers.set_policy(policy);
+    MLPutSymbol(stdlink, (char *) "Null");
+}
+
+/* 
+   Reads a matrix, and with labels a list of variable names, into
+   dataset.  On success the caller disowns the array; on failure a
+   message from symbol sym has been put on the link.
+ */
+int get_data_set(eureqa::data_set& dataset, bool labels, const char* sym,
+                 double **data, long **dims, char ***heads, long *d)
+{
+    char msg[256];
+    long i,j;
+
+    if(! MLGetRealArray(stdlink, data, dims, heads, d)) {
+        snprintf(msg, 256, "%s::readerr", sym);
+        failed_with_message0(msg);
+        return 1;
+    }
+    dataset = eureqa::data_set((*dims)[0], (*dims)[1]);
+    for(i=0; i<(*dims)[0]; i++) 
+        for(j=0; j<(*dims)[1]; j++)
+            dataset(i,j) = (*data)[j + i * (*dims)[1]];
 
     if (labels) {
         const char *lhead;
         int n;
         if (! MLGetFunction(stdlink, &lhead, &n)) {
-            MLDisownRealArray(stdlink, data, dims, heads, d);
-            FAILED_WITH_MESSAGE("SendDataSet::invarg");
-            return;
+            MLDisownRealArray(stdlink, *data, *dims, *heads, *d);
+            snprintf(msg, 256, "%s::invarg", sym);
+            failed_with_message0(msg);
+            return 2;
         }
-        if (n != dims[1]) {
+        if (n != (*dims)[1]) {
             MLReleaseSymbol(stdlink, lhead);
-            MLDisownRealArray(stdlink, data, dims, heads, d);
-            FAILED_WITH_MESSAGE("SendDataSet::colmis");
-            return;
+            MLDisownRealArray(stdlink, *data, *dims, *heads, *d);
+            snprintf(msg, 256, "%s::colmis", sym);
+            failed_with_message0(msg);
+            return 3;
         }
         for (int i = 0; i < n; i++) {
             const char *label;
             if (!MLGetString(stdlink, &label)) {
                 MLReleaseSymbol(stdlink, lhead);
-                MLDisownRealArray(stdlink, data, dims, heads, d);
+                MLDisownRealArray(stdlink, *data, *dims, *heads, *d);
 
-                FAILED_WITH_MESSAGE("SendDataSet::invarg");
-                return;
+                snprintf(msg, 256, "%s::invarg", sym);
+                failed_with_message0(msg);
+                return 4;
             }
             dataset.X_symbols_[i] = label;
             MLReleaseString(stdlink, label);
@@ -412,8 +636,26 @@ void _send_data_set_maybe_labels(bool labels) {
 
         MLReleaseSymbol(stdlink, lhead);
     }
+    return 0;
+}
+
+void _send_data_set_maybe_labels(bool labels) {
+    if (ensure_connected((char *) "SendDataSet")) return;
+    double *data;
+    long *dims;                 // dimensions
+    char **heads;
+    long d; /* Stores the rank of the array. */
+    eureqa::data_set dataset; // Holds the data.
 
-    if (conn.send_data_set(dataset)) {
+    if (get_data_set(dataset, labels, "SendDataSet", &data, &dims, &heads, &d))
+        return;
+
+    call_status status = run_abortable(boost::bind(&eureqa::cluster::send_data_set, &servers, boost::cref(dataset)));
+    if (status == call_aborted) {
+        MLDisownRealArray(stdlink, data, dims, heads, d);
+        return;
+    }
+    if (status == call_succeeded) {
         // Everything went well.  Send through the data we received.
         MLPutDoubleArray(stdlink, data, dims, heads, d);
         MLDisownRealArray(stdlink, data, dims, heads, d);
@@ -434,22 +676,59 @@ void _send_data_set_labels()
     _send_data_set_maybe_labels(true);
 }
 
+void _send_data_location(char const* path)
+{
+    if (ensure_connected((char *) "SendDataLocation")) return;
+    call_status status = run_abortable(boost::bind(&eureqa::cluster::send_data_location, &servers, std::string(path)));
+    if (status == call_aborted) 
+        return;
+    /* Every server still in the search must have read the file. */
+    bool loaded = true;
+    for (int i = 0; i < servers.size(); i++) {
+        if (servers.is_active(i) && servers.last_result(i).value() != eureqa::result_success)
+            loaded = false;
+    }
+    if (status != call_succeeded) {
+        FAILED_WITH_MESSAGE("SendDataLocation::err");
+    } else if (! loaded) {
+        // A server could not read the file.
+        FAILED_WITH_MESSAGE("SendDataLocation::load");
+    } else {
+        MLPutString(stdlink, path);
+    }
+}
+
+void _set_shared_directory(char const* dir)
+{
+    /*
+      With a directory the server can also read, SendDataSet[] writes
+      the data there and sends only the file's path.  If the server
+      cannot load it the data goes over the network as before.  An
+      empty string sends all data over the network.
+     */
+    servers.set_shared_directory(dir);
+    MLPutSymbol(stdlink, (char *) "Null");
+}
+
 void _send_options(char const* model)
 {
     if (ensure_connected("SendOptions")) return;
     eureqa::search_options options(model); // holds the search options
     //std::cerr << options.summary() << std::endl;
-    if (conn.send_options(options)) {
+    call_status status = run_abortable(boost::bind(&eureqa::cluster::send_options, &servers, boost::cref(options)));
+    if (status == call_aborted) 
+        return;
+    if (status == call_succeeded) {
         MLPutSymbol(stdlink, (char *) "Null");        
     } else {
         FAILED_WITH_MESSAGE("SendOptions::err");
     }
 }
 
-void _send_options_explicit(int n)
+/* Reads n option rules into options, returns 0 on success.  Errors
+   are reported as messages of the function given by tag. */
+int get_option_rules(int n, eureqa::search_options& options, const char* tag)
 {
-    if (ensure_connected("SendOptions")) return;
-    
     initialize_option_properties();
     options.set_default_options();
     options.set_default_building_blocks();
@@ -457,33 +736,45 @@ void _send_options_explicit(int n)
         long m;
         const char *head;
         if (! MLCheckFunction(stdlink, "Rule", &m)) {
-            FAILED_WITH_MESSAGE("SendOptions::exprule");
-            return;
+            failed_with_message0(message_name(tag, "exprule").c_str());
+            return 1;
         } 
         if (m != 2) {
-            FAILED_WITH_MESSAGE("SendOptions::expruletwo");
-            return;
+            failed_with_message0(message_name(tag, "expruletwo").c_str());
+            return 2;
         }
 
         int o;
         const char *sym;
         if (! MLGetSymbol(stdlink, &sym)) {
-            FAILED_WITH_MESSAGE("SendOptions::exprsym");
-            return;
+            failed_with_message0(message_name(tag, "exprsym").c_str());
+            return 3;
         } 
-        int err = update_option(sym);
+        int err = update_option(options, tag, sym);
         MLReleaseSymbol(stdlink, sym);
+        if (err)
+            return 4;
     }
     if (! options.is_valid()) {
-        FAILED_WITH_MESSAGE("SendOptions::inv");
-        return;
+        failed_with_message0(message_name(tag, "inv").c_str());
+        return 5;
     }
+    return 0;
+}
+
+void _send_options_explicit(int n)
+{
+    if (ensure_connected("SendOptions")) return;
+    if (get_option_rules(n, options, "SendOptions")) return;
     
     /*
       XXX - This should report back if it has an error parsing the
       search relationship.  Or there should be a way to check.
      */
-    if (conn.send_options(options)) {
+    call_status status = run_abortable(boost::bind(&eureqa::cluster::send_options, &servers, boost::cref(options)));
+    if (status == call_aborted) 
+        return;
+    if (status == call_succeeded) {
         MLPutSymbol(stdlink, (char *) "Null");        
     } else {
         FAILED_WITH_MESSAGE("SendOptions::senderr");
@@ -494,7 +785,10 @@ void _send_options_explicit(int n)
 void _start_search()
 {
     if (ensure_connected("StartSearch")) return;
-    if (conn.start_search()) {
+    call_status status = run_abortable(boost::bind(&eureqa::cluster::start_search, &servers));
+    if (status == call_aborted) 
+        return;
+    if (status == call_succeeded) {
         MLPutSymbol(stdlink, (char *) "Null");
     } else { 
         FAILED_WITH_MESSAGE("StartSearch::err");
@@ -504,7 +798,10 @@ void _start_search()
 void _pause_search()
 {
     if (ensure_connected("PauseSearch")) return;
-    if (conn.pause_search()) {
+    call_status status = run_abortable(boost::bind(&eureqa::cluster::pause_search, &servers));
+    if (status == call_aborted) 
+        return;
+    if (status == call_succeeded) {
         MLPutSymbol(stdlink, (char *) "Null");
     } else { 
         FAILED_WITH_MESSAGE("PauseSearch::err");
@@ -514,14 +811,17 @@ void _pause_search()
 void _end_search()
 {
     if (ensure_connected("EndSearch")) return;
-    if (conn.end_search()) {
+    call_status status = run_abortable(boost::bind(&eureqa::cluster::end_search, &servers));
+    if (status == call_aborted) 
+        return;
+    if (status == call_succeeded) {
         MLPutSymbol(stdlink, (char *) "Null");
     } else { 
         FAILED_WITH_MESSAGE("EndSearch::err");
     }
 }
 
-void put_solution_info(eureqa::solution_info solution)
+void put_solution_info(const eureqa::solution_info& solution)
 {
 
     // SolutionInfo[FormulaText -> "", Score -> .1, Fitness -> .1, Complexity -> .1, Age -> 1]
@@ -591,14 +891,14 @@ void _query_progress()
 {
     if (ensure_connected("QueryProgress")) return;
     eureqa::search_progress progress; // recieves the progress and new solutions
-    int res;
-    try {
-        res = conn.query_progress(progress);
-    } catch(const boost::archive::archive_exception& ae ) {
+    call_status status = run_abortable(boost::bind(&eureqa::cluster::query_progress, &servers, boost::ref(progress)));
+    if (status == call_aborted) 
+        return;
+    if (status == call_archive_error) {
         FAILED_WITH_MESSAGE("QueryProgress::arcerr");        
         return;
     }
-    if (res) {
+    if (status == call_succeeded) {
         // SearchProgress[Solution -> soln, Generations -> g, GenerationsPerSec -> gps, Evaluations -> e, EvaluationsPerSec -> eps, TotalPopulationSize -> s]
         MLPutFunction(stdlink, (char *) "SearchProgress", 6); 
           MLPutFunction(stdlink, (char *) "Rule", 2);
@@ -625,11 +925,13 @@ void _query_progress()
 }
 
 void _query_frontier() {
-    eureqa::solution_frontier front;
-    if (conn.query_frontier(front)) {
-        MLPutFunction(stdlink, (char *) "SolutionFrontier", front.size()); 
-        for (int i = 0; i < front.size(); i++) {
-            put_solution_info(front[i]);
+    call_status status = run_abortable(query_frontier_call);
+    if (status == call_aborted) 
+        return;
+    if (status == call_succeeded) {
+        MLPutFunction(stdlink, (char *) "SolutionFrontier", frontier_arena.size()); 
+        for (int i = 0; i < frontier_arena.size(); i++) {
+            put_solution_info(frontier_arena[i]);
         }
     } else {
         FAILED_WITH_MESSAGE("QueryFrontier::err");
@@ -698,3 +1000,275 @@ int main(int argc, char* argv[])
 }
 
 #endif
+
+void _discover_servers(int window_ms)
+{
+    // Look on the LAN and on this machine; a server seen at both
+    // addresses is only reported once.
+    eureqa::server_discovery discovery(window_ms);
+    discovery.add_host("localhost");
+    std::vector<eureqa::discovered_server> servers;
+    discovery.discover(servers);
+
+    // {ServerInfo[Host -> "10.0.0.2", Port -> 22112, Hostname -> "", OperatingSystem -> "", EureqaVersion -> 1.0, CPUCores -> 8, Searching -> False, ResponseTime -> 1.5], ...}
+    MLPutFunction(stdlink, (char *) "List", (int) servers.size());
+    for (int i = 0; i < (int) servers.size(); i++) {
+        const eureqa::discovered_server& server = servers[i];
+        MLPutFunction(stdlink, (char *) "ServerInfo", 8); 
+          MLPutFunction(stdlink, (char *) "Rule", 2);
+            MLPutSymbol(stdlink, (char *) "Host");
+            MLPutString(stdlink, server.address_.c_str());
+          MLPutFunction(stdlink, (char *) "Rule", 2);
+            MLPutSymbol(stdlink, (char *) "Port");
+            MLPutInteger(stdlink, server.port_);
+          MLPutFunction(stdlink, (char *) "Rule", 2);
+            MLPutSymbol(stdlink, (char *) "Hostname");
+            MLPutString(stdlink, server.info_.hostname_.c_str());
+          MLPutFunction(stdlink, (char *) "Rule", 2);
+            MLPutSymbol(stdlink, (char *) "OperatingSystem");
+            MLPutString(stdlink, server.info_.operating_system_.c_str());
+          MLPutFunction(stdlink, (char *) "Rule", 2);
+            MLPutSymbol(stdlink, (char *) "EureqaVersion");
+            MLPutDouble(stdlink, server.info_.eureqa_version_);
+          MLPutFunction(stdlink, (char *) "Rule", 2);
+            MLPutSymbol(stdlink, (char *) "CPUCores");
+            MLPutInteger(stdlink, server.info_.cpu_cores_);
+          MLPutFunction(stdlink, (char *) "Rule", 2);
+            MLPutSymbol(stdlink, (char *) "Searching");
+            MLPutSymbol(stdlink, (char *) (server.is_searching() ? "True" : "False"));
+          MLPutFunction(stdlink, (char *) "Rule", 2);
+            MLPutSymbol(stdlink, (char *) "ResponseTime");
+            MLPutDouble(stdlink, server.response_ms_);
+    }
+}
+
+/* Puts field -> {Mean -> m, Median -> m, Percentile99 -> p, Max -> m}, scaled into the reported unit. */
+void put_histogram(const char *field, const eureqa::log2_histogram& h, double scale)
+{
+    MLPutFunction(stdlink, (char *) "Rule", 2);
+      MLPutSymbol(stdlink, (char *) field);
+      MLPutFunction(stdlink, (char *) "List", 4);
+        MLPutFunction(stdlink, (char *) "Rule", 2);
+          MLPutSymbol(stdlink, (char *) "Mean");
+          MLPutDouble(stdlink, h.mean() * scale);
+        MLPutFunction(stdlink, (char *) "Rule", 2);
+          MLPutSymbol(stdlink, (char *) "Median");
+          MLPutDouble(stdlink, h.percentile(0.5) * scale);
+        MLPutFunction(stdlink, (char *) "Rule", 2);
+          MLPutSymbol(stdlink, (char *) "Percentile99");
+          MLPutDouble(stdlink, h.percentile(0.99) * scale);
+        MLPutFunction(stdlink, (char *) "Rule", 2);
+          MLPutSymbol(stdlink, (char *) "Max");
+          MLPutDouble(stdlink, h.max_ * scale);
+}
+
+void _connection_statistics()
+{
+    /*
+      ConnectionStatistics[Connects -> n, ..., Commands -> {CommandStatistics[Command -> "query_progress", Calls -> n, SerializeTime -> {...}, ...], ...}]
+      Times are in milliseconds.  The per-command figures cover every
+      command since the first ConnectTo[], summed over the servers of
+      ConnectTo[{hosts}], whose extra servers count from the ConnectTo[]
+      that added them.
+     */
+    eureqa::connection_statistics stats = conn.statistics();
+    for (int i = 1; i < servers.size(); i++)
+        stats.add(servers.member_session(i).conn().statistics());
+    const double ms = 0.001;
+    MLPutFunction(stdlink, (char *) "ConnectionStatistics", 7);
+      MLPutFunction(stdlink, (char *) "Rule", 2);
+        MLPutSymbol(stdlink, (char *) "Connects");
+        MLPutInteger(stdlink, stats.connects_);
+      MLPutFunction(stdlink, (char *) "Rule", 2);
+        MLPutSymbol(stdlink, (char *) "ConnectFailures");
+        MLPutInteger(stdlink, stats.connect_failures_);
+      MLPutFunction(stdlink, (char *) "Rule", 2);
+        MLPutSymbol(stdlink, (char *) "MeanConnectTime");
+        MLPutDouble(stdlink, stats.mean_connect_ms());
+      MLPutFunction(stdlink, (char *) "Rule", 2);
+        MLPutSymbol(stdlink, (char *) "ConnectTimeouts");
+        MLPutInteger(stdlink, stats.connect_timeouts_);
+      MLPutFunction(stdlink, (char *) "Rule", 2);
+        MLPutSymbol(stdlink, (char *) "WriteTimeouts");
+        MLPutInteger(stdlink, stats.write_timeouts_);
+      MLPutFunction(stdlink, (char *) "Rule", 2);
+        MLPutSymbol(stdlink, (char *) "ReadTimeouts");
+        MLPutInteger(stdlink, stats.read_timeouts_);
+      MLPutFunction(stdlink, (char *) "Rule", 2);
+        MLPutSymbol(stdlink, (char *) "Commands");
+        MLPutFunction(stdlink, (char *) "List", stats.commands_.size());
+        std::map<int, eureqa::command_statistics>::const_iterator i;
+        for (i = stats.commands_.begin(); i != stats.commands_.end(); ++i) {
+            const eureqa::command_statistics& c = i->second;
+            MLPutFunction(stdlink, (char *) "CommandStatistics", 8);
+              MLPutFunction(stdlink, (char *) "Rule", 2);
+                MLPutSymbol(stdlink, (char *) "Command");
+                MLPutString(stdlink, eureqa::commands::name(i->first));
+              MLPutFunction(stdlink, (char *) "Rule", 2);
+                MLPutSymbol(stdlink, (char *) "Calls");
+                MLPutInteger(stdlink, (int) c.calls());
+              put_histogram("SerializeTime", c.serialize_us_, ms);
+              put_histogram("WriteTime", c.write_us_, ms);
+              put_histogram("FirstByteTime", c.first_byte_us_, ms);
+              put_histogram("DecodeTime", c.decode_us_, ms);
+              put_histogram("BytesOut", c.bytes_out_, 1);
+              put_histogram("BytesIn", c.bytes_in_, 1);
+        }
+}
+
+/*
+  A sweep runs every combination of the data sets, search
+  relationships and option sets given since SweepClear[] across a
+  list of hosts, each host taking one search at a time.  It uses
+  connections of its own, so it does not touch the ConnectTo[]
+  session.
+ */
+void _sweep_clear()
+{
+    sweeps.clear();
+    MLPutSymbol(stdlink, (char *) "Null");
+}
+
+void sweep_data_set_maybe_labels(bool labels)
+{
+    double *data;
+    long *dims;
+    char **heads;
+    long d;
+    eureqa::data_set dataset;
+
+    if (get_data_set(dataset, labels, "SweepDataSet", &data, &dims, &heads, &d))
+        return;
+    MLDisownRealArray(stdlink, data, dims, heads, d);
+    MLPutInteger(stdlink, sweeps.add_data_set(dataset) + 1);
+}
+
+void _sweep_data_set()
+{
+    sweep_data_set_maybe_labels(false);
+}
+
+void _sweep_data_set_labels()
+{
+    sweep_data_set_maybe_labels(true);
+}
+
+void _sweep_relationship(char const* model)
+{
+    MLPutInteger(stdlink, sweeps.add_relationship(model) + 1);
+}
+
+void _sweep_options(int n)
+{
+    eureqa::search_options option_set;
+    if (get_option_rules(n, option_set, "SweepOptions")) return;
+    MLPutInteger(stdlink, sweeps.add_options(option_set) + 1);
+}
+
+void sweep_cleanup()
+{
+    // Nothing to end, the sweep's connections close as it returns.
+}
+
+void _sweep_run(double max_generations, double max_seconds)
+{
+    std::vector<std::string> hosts;
+    if (get_string_list(hosts) || hosts.empty()) {
+        FAILED_WITH_MESSAGE("SweepRun::hosts");
+        return;
+    }
+    if (sweeps.data_sets() == 0 || sweeps.relationships() == 0) {
+        FAILED_WITH_MESSAGE("SweepRun::empty");
+        return;
+    }
+    if (max_generations <= 0 && max_seconds <= 0) {
+        FAILED_WITH_MESSAGE("SweepRun::nolimit");
+        return;
+    }
+    eureqa::sweep_options sopts;
+    sopts.max_generations_ = max_generations;
+    sopts.max_seconds_ = max_seconds;
+    sweeps.set_options(sopts);
+
+    call_status status = run_abortable(boost::bind(&eureqa::sweep::run, &sweeps, boost::cref(hosts), eureqa::default_port_tcp), 
+                                       boost::bind(&eureqa::sweep::cancel, &sweeps),
+                                       sweep_cleanup);
+    if (status == call_aborted) 
+        return;
+    if (status == call_archive_error) {
+        FAILED_WITH_MESSAGE("SweepRun::arcerr");
+        return;
+    }
+
+    // {{{frontier per option set} per relationship} per data set}, $Failed for a search that did not finish
+    MLPutFunction(stdlink, (char *) "List", sweeps.data_sets());
+    for (int d = 0; d < sweeps.data_sets(); d++) {
+        MLPutFunction(stdlink, (char *) "List", sweeps.relationships());
+        for (int r = 0; r < sweeps.relationships(); r++) {
+            MLPutFunction(stdlink, (char *) "List", sweeps.option_sets());
+            for (int o = 0; o < sweeps.option_sets(); o++) {
+                const eureqa::sweep_result& result = sweeps.result(d, r, o);
+                if (result.done_) {
+                    eureqa::solution_frontier front = result.frontier_;
+                    put_solution_frontier(front);
+                } else {
+                    MLPutSymbol(stdlink, (char *) "$Failed");
+                }
+            }
+        }
+    }
+}
+
+void _cross_validate(int folds, double max_generations, double max_seconds)
+{
+    /*
+      Cross-validates the first data set, relationship and option set
+      given to the sweep: the data set is split into folds, keeping
+      each series together, the searches on all but one fold each run
+      across the hosts, and every formula they find is scored on the
+      fold its search left out.  Returns the formulas as a
+      SolutionFrontier ranked by that validation fitness.
+     */
+    std::vector<std::string> hosts;
+    if (get_string_list(hosts) || hosts.empty()) {
+        FAILED_WITH_MESSAGE("CrossValidate::hosts");
+        return;
+    }
+    if (sweeps.data_sets() == 0 || sweeps.relationships() == 0) {
+        FAILED_WITH_MESSAGE("CrossValidate::empty");
+        return;
+    }
+    if (folds < 2) {
+        FAILED_WITH_MESSAGE("CrossValidate::folds");
+        return;
+    }
+    if (max_generations <= 0 && max_seconds <= 0) {
+        FAILED_WITH_MESSAGE("CrossValidate::nolimit");
+        return;
+    }
+    eureqa::cross_validation_options copts;
+    copts.folds_ = folds;
+    copts.search_.max_generations_ = max_generations;
+    copts.search_.max_seconds_ = max_seconds;
+    validations.set_options(copts);
+    eureqa::search_options sopts = sweeps.option_set(0);
+    sopts.search_relationship_ = sweeps.relationship(0);
+
+    call_status status = run_abortable(boost::bind(&eureqa::cross_validation::run, &validations, boost::cref(sweeps.data(0)), boost::cref(sopts), boost::cref(hosts), eureqa::default_port_tcp), 
+                                       boost::bind(&eureqa::cross_validation::cancel, &validations),
+                                       sweep_cleanup);
+    if (status == call_aborted) 
+        return;
+    if (status == call_archive_error) {
+        FAILED_WITH_MESSAGE("CrossValidate::arcerr");
+        return;
+    }
+    const std::vector<eureqa::validated_solution>& ranked = validations.ranked();
+    if (ranked.empty()) {
+        FAILED_WITH_MESSAGE("CrossValidate::novalid");
+        return;
+    }
+    MLPutFunction(stdlink, (char *) "SolutionFrontier", (int) ranked.size());
+    for (int i = 0; i < (int) ranked.size(); i++) 
+        put_solution_info(ranked[i].solution_);
+}
@@ -9,6 +9,16 @@
 :ReturnType:     Manual
 :End:
 
+// void _connect_cluster P((void));
+
+:Begin:
+:Function:       _connect_cluster
+:Pattern:        ConnectTo[EureqaClient`Private`hosts:{__String}]
+:Arguments:      { EureqaClient`Private`hosts }
+:ArgumentTypes:  { Manual }
+:ReturnType:     Manual
+:End:
+
 // void _is_connected P(());
 
 :Begin:
@@ -30,6 +40,32 @@
 :ReturnType:     Manual
 :End:
 
+// void _set_reconnect P((int attempts));
+
+:Begin:
+:Function:       _set_reconnect
+:Pattern:        SetReconnect[EureqaClient`Private`attempts_Integer]
+:Arguments:      { EureqaClient`Private`attempts }
+:ArgumentTypes:  { Integer }
+:ReturnType:     Manual
+:End:
+
+:Begin:
+:Function:       _set_reconnect
+:Pattern:        SetReconnect[True]
+:Arguments:      { 8 }
+:ArgumentTypes:  { Integer }
+:ReturnType:     Manual
+:End:
+
+:Begin:
+:Function:       _set_reconnect
+:Pattern:        SetReconnect[False]
+:Arguments:      { 0 }
+:ArgumentTypes:  { Integer }
+:ReturnType:     Manual
+:End:
+
 // void _send_data_set P((void));
 
 :Begin:
@@ -51,6 +87,34 @@
 :End:
 
 
+// void _send_data_location P((const char *));
+
+:Begin:
+:Function:       _send_data_location
+:Pattern:        SendDataLocation[EureqaClient`Private`path_String]
+:Arguments:      { EureqaClient`Private`path }
+:ArgumentTypes:  { String }
+:ReturnType:     Manual
+:End:
+
+// void _set_shared_directory P((const char *));
+
+:Begin:
+:Function:       _set_shared_directory
+:Pattern:        SetSharedDirectory[EureqaClient`Private`dir_String]
+:Arguments:      { EureqaClient`Private`dir }
+:ArgumentTypes:  { String }
+:ReturnType:     Manual
+:End:
+
+:Begin:
+:Function:       _set_shared_directory
+:Pattern:        SetSharedDirectory[None]
+:Arguments:      { "" }
+:ArgumentTypes:  { String }
+:ReturnType:     Manual
+:End:
+
 // void _send_options P((char *));
 
 :Begin:
@@ -155,3 +219,120 @@
 :ReturnType:     Manual
 :End:
 
+// void _discover_servers P((int));
+
+:Begin:
+:Function:       _discover_servers
+:Pattern:        DiscoverServers[]
+:Arguments:      { 2000 }
+:ArgumentTypes:  { Integer }
+:ReturnType:     Manual
+:End:
+
+:Begin:
+:Function:       _discover_servers
+:Pattern:        DiscoverServers[EureqaClient`Private`window_Integer]
+:Arguments:      { EureqaClient`Private`window }
+:ArgumentTypes:  { Integer }
+:ReturnType:     Manual
+:End:
+
+// void _connection_statistics P(());
+
+:Begin:
+:Function:       _connection_statistics
+:Pattern:        ConnectionStatistics[]
+:Arguments:      { }
+:ArgumentTypes:  { }
+:ReturnType:     Manual
+:End:
+
+// void _sweep_clear P(());
+
+:Begin:
+:Function:       _sweep_clear
+:Pattern:        SweepClear[]
+:Arguments:      { }
+:ArgumentTypes:  { }
+:ReturnType:     Manual
+:End:
+
+// void _sweep_data_set P((void));
+
+:Begin:
+:Function:       _sweep_data_set
+:Pattern:        SweepDataSet[EureqaClient`Private`data_?MatrixQ]
+:Arguments:      {EureqaClient`Private`data}
+:ArgumentTypes:  {Manual}
+:ReturnType:     Manual
+:End:
+
+// void _sweep_data_set_labels P((void));
+
+:Begin:
+:Function:       _sweep_data_set_labels
+:Pattern:        SweepDataSet[EureqaClient`Private`data_?MatrixQ, EureqaClient`Private`labels_List]
+:Arguments:      {EureqaClient`Private`data, EureqaClient`Private`labels}
+:ArgumentTypes:  {Manual}
+:ReturnType:     Manual
+:End:
+
+// void _sweep_relationship P((char *));
+
+:Begin:
+:Function:       _sweep_relationship
+:Pattern:        SweepRelationship[EureqaClient`Private`model_String]
+:Arguments:      {EureqaClient`Private`model}
+:ArgumentTypes:  {String}
+:ReturnType:     Manual
+:End:
+
+// void _sweep_options P((int));
+
+:Begin:
+:Function:       _sweep_options
+:Pattern:        SweepOptions[EureqaClient`Private`options___Rule]
+:Arguments:      {Length[List[EureqaClient`Private`options]], EureqaClient`Private`options}
+:ArgumentTypes:  {Integer, Manual}
+:ReturnType:     Manual
+:End:
+
+// void _sweep_run P((double, double));
+
+:Begin:
+:Function:       _sweep_run
+:Pattern:        SweepRun[EureqaClient`Private`hosts:{__String}, EureqaClient`Private`maxGenerations_?NumericQ, EureqaClient`Private`maxSeconds_?NumericQ]
+:Arguments:      {N[EureqaClient`Private`maxGenerations], N[EureqaClient`Private`maxSeconds], EureqaClient`Private`hosts}
+:ArgumentTypes:  {Real64, Real64, Manual}
+:ReturnType:     Manual
+:End:
+
+// void _cross_validate P((int, double, double));
+
+:Begin:
+:Function:       _cross_validate
+:Pattern:        CrossValidate[EureqaClient`Private`hosts:{__String}, EureqaClient`Private`folds_Integer, EureqaClient`Private`maxGenerations_?NumericQ, EureqaClient`Private`maxSeconds_?NumericQ]
+:Arguments:      {EureqaClient`Private`folds, N[EureqaClient`Private`maxGenerations], N[EureqaClient`Private`maxSeconds], EureqaClient`Private`hosts}
+:ArgumentTypes:  {Integer, Real64, Real64, Manual}
+:ReturnType:     Manual
+:End:
+
+// void _launch_servers P((int, const char*, int));
+
+:Begin:
+:Function:       _launch_servers
+:Pattern:        LaunchServers[EureqaClient`Private`count_Integer, EureqaClient`Private`program_String, EureqaClient`Private`pinning_Integer]
+:Arguments:      {EureqaClient`Private`count, EureqaClient`Private`program, EureqaClient`Private`pinning}
+:ArgumentTypes:  {Integer, String, Integer}
+:ReturnType:     Manual
+:End:
+
+// void _stop_servers P(());
+
+:Begin:
+:Function:       _stop_servers
+:Pattern:        StopServers[]
+:Arguments:      { }
+:ArgumentTypes:  { }
+:ReturnType:     Manual
+:End: